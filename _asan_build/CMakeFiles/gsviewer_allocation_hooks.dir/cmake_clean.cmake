@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/gsviewer_allocation_hooks.dir/src/allocation_hooks.cpp.o"
+  "CMakeFiles/gsviewer_allocation_hooks.dir/src/allocation_hooks.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/gsviewer_allocation_hooks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/gsviewer_benchmark.dir/bench/benchmark.cpp.o"
+  "CMakeFiles/gsviewer_benchmark.dir/bench/benchmark.cpp.o.d"
+  "gsviewer_benchmark"
+  "gsviewer_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/gsviewer_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/load_pipeline_test.dir/tests/load_pipeline_test.cpp.o"
+  "CMakeFiles/load_pipeline_test.dir/tests/load_pipeline_test.cpp.o.d"
+  "load_pipeline_test"
+  "load_pipeline_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/load_pipeline_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/packed_view_test.dir/tests/packed_view_test.cpp.o"
+  "CMakeFiles/packed_view_test.dir/tests/packed_view_test.cpp.o.d"
+  "packed_view_test"
+  "packed_view_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/packed_view_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
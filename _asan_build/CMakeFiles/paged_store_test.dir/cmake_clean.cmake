@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/paged_store_test.dir/tests/paged_store_test.cpp.o"
+  "CMakeFiles/paged_store_test.dir/tests/paged_store_test.cpp.o.d"
+  "paged_store_test"
+  "paged_store_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/paged_store_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
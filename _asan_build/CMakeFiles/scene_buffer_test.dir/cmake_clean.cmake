@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scene_buffer_test.dir/tests/scene_buffer_test.cpp.o"
+  "CMakeFiles/scene_buffer_test.dir/tests/scene_buffer_test.cpp.o.d"
+  "scene_buffer_test"
+  "scene_buffer_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/scene_buffer_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scene_cache_test.dir/tests/scene_cache_test.cpp.o"
+  "CMakeFiles/scene_cache_test.dir/tests/scene_cache_test.cpp.o.d"
+  "scene_cache_test"
+  "scene_cache_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/scene_cache_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
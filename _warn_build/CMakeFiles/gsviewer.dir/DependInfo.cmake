@@ -0,0 +1,38 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/bvh.cpp" "CMakeFiles/gsviewer.dir/src/bvh.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/bvh.cpp.o.d"
+  "/root/repo/src/compact.cpp" "CMakeFiles/gsviewer.dir/src/compact.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/compact.cpp.o.d"
+  "/root/repo/src/covariance.cpp" "CMakeFiles/gsviewer.dir/src/covariance.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/covariance.cpp.o.d"
+  "/root/repo/src/load_pipeline.cpp" "CMakeFiles/gsviewer.dir/src/load_pipeline.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/load_pipeline.cpp.o.d"
+  "/root/repo/src/lod.cpp" "CMakeFiles/gsviewer.dir/src/lod.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/lod.cpp.o.d"
+  "/root/repo/src/mapped_file.cpp" "CMakeFiles/gsviewer.dir/src/mapped_file.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/mapped_file.cpp.o.d"
+  "/root/repo/src/packing.cpp" "CMakeFiles/gsviewer.dir/src/packing.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/packing.cpp.o.d"
+  "/root/repo/src/paged_store.cpp" "CMakeFiles/gsviewer.dir/src/paged_store.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/paged_store.cpp.o.d"
+  "/root/repo/src/ply.cpp" "CMakeFiles/gsviewer.dir/src/ply.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/ply.cpp.o.d"
+  "/root/repo/src/rasterizer.cpp" "CMakeFiles/gsviewer.dir/src/rasterizer.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/rasterizer.cpp.o.d"
+  "/root/repo/src/scene_buffer.cpp" "CMakeFiles/gsviewer.dir/src/scene_buffer.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/scene_buffer.cpp.o.d"
+  "/root/repo/src/scene_cache.cpp" "CMakeFiles/gsviewer.dir/src/scene_cache.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/scene_cache.cpp.o.d"
+  "/root/repo/src/sequence.cpp" "CMakeFiles/gsviewer.dir/src/sequence.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/sequence.cpp.o.d"
+  "/root/repo/src/sh.cpp" "CMakeFiles/gsviewer.dir/src/sh.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/sh.cpp.o.d"
+  "/root/repo/src/sh_codebook.cpp" "CMakeFiles/gsviewer.dir/src/sh_codebook.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/sh_codebook.cpp.o.d"
+  "/root/repo/src/simd.cpp" "CMakeFiles/gsviewer.dir/src/simd.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/simd.cpp.o.d"
+  "/root/repo/src/sorting.cpp" "CMakeFiles/gsviewer.dir/src/sorting.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/sorting.cpp.o.d"
+  "/root/repo/src/streaming.cpp" "CMakeFiles/gsviewer.dir/src/streaming.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/streaming.cpp.o.d"
+  "/root/repo/src/synthetic_ply.cpp" "CMakeFiles/gsviewer.dir/src/synthetic_ply.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/synthetic_ply.cpp.o.d"
+  "/root/repo/src/trace.cpp" "CMakeFiles/gsviewer.dir/src/trace.cpp.o" "gcc" "CMakeFiles/gsviewer.dir/src/trace.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,49 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/gsviewer.dir/src/bvh.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/bvh.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/compact.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/compact.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/covariance.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/covariance.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/load_pipeline.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/load_pipeline.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/lod.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/lod.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/mapped_file.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/mapped_file.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/packing.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/packing.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/paged_store.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/paged_store.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/ply.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/ply.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/rasterizer.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/rasterizer.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/scene_buffer.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/scene_buffer.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/scene_cache.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/scene_cache.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/sequence.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/sequence.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/sh.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/sh.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/sh_codebook.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/sh_codebook.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/simd.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/simd.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/sorting.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/sorting.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/streaming.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/streaming.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/synthetic_ply.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/synthetic_ply.cpp.o.d"
+  "CMakeFiles/gsviewer.dir/src/trace.cpp.o"
+  "CMakeFiles/gsviewer.dir/src/trace.cpp.o.d"
+  "libgsviewer.a"
+  "libgsviewer.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/gsviewer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ply_test.dir/tests/ply_test.cpp.o"
+  "CMakeFiles/ply_test.dir/tests/ply_test.cpp.o.d"
+  "ply_test"
+  "ply_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ply_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,20 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_warn_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(packing_test "/root/repo/_warn_build/packing_test")
+set_tests_properties(packing_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(layout_test "/root/repo/_warn_build/layout_test")
+set_tests_properties(layout_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(rasterizer_test "/root/repo/_warn_build/rasterizer_test")
+set_tests_properties(rasterizer_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(paged_store_test "/root/repo/_warn_build/paged_store_test")
+set_tests_properties(paged_store_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(compact_test "/root/repo/_warn_build/compact_test")
+set_tests_properties(compact_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(packed_view_test "/root/repo/_warn_build/packed_view_test")
+set_tests_properties(packed_view_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(ply_test "/root/repo/_warn_build/ply_test")
+set_tests_properties(ply_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
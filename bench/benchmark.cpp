@@ -0,0 +1,449 @@
+// Benchmarks the loading, packing and rendering stages on a synthetic scene
+// and reports throughput, peak resident memory and heap allocations per
+// stage, as a table and optionally as JSON for tracking results over time.
+#include "synthetic_ply.h"
+#include "ply.h"
+#include "load_pipeline.h"
+#include "packing.h"
+#include "sorting.h"
+#include "covariance.h"
+#include "sh.h"
+#include "rasterizer.h"
+#include "parallel.h"
+#include "simd.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+struct BenchmarkOptions {
+    int splats = 1000000;
+    int shDegree = 3;
+    int extraProperties = 3;
+    int threads = 0;
+    int repeat = 5;
+    // Comma-separated stage names; empty runs them all.
+    std::string stages;
+    std::string jsonPath;
+    // Directory the synthetic PLY is written to for the file loaders.
+    std::string workDirectory = "/tmp";
+    uint32_t seed = 1;
+};
+
+struct StageResult {
+    std::string name;
+    // What `items` counts.
+    std::string unit;
+    uint64_t items;
+    uint64_t bytes;
+    int runs;
+    double minSeconds;
+    double medianSeconds;
+    double meanSeconds;
+    uint64_t rssBeforeBytes;
+    uint64_t peakRssBytes;
+    uint64_t allocationsPerRun;
+};
+
+// Value of a "Name:   123 kB" line of /proc/self/status, in bytes.
+static uint64_t statusBytes(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const size_t length = std::char_traits<char>::length(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':') {
+            return std::strtoull(line.c_str() + length + 1, nullptr, 10) * 1024;
+        }
+    }
+    return 0;
+}
+
+// Starts a new peak resident set measurement. Linux resets VmHWM to the
+// current resident set when 5 is written to clear_refs.
+static void resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+// Stream the results table is printed to. It moves to stderr when the JSON
+// report goes to stdout, so stdout stays parseable.
+static FILE* tableStream(const BenchmarkOptions& options) {
+    return options.jsonPath == "-" ? stderr : stdout;
+}
+
+class Benchmark {
+public:
+    explicit Benchmark(const BenchmarkOptions& options) : options(options), table(tableStream(options)) {}
+
+    bool enabled(const std::string& name) const {
+        if (options.stages.empty()) {
+            return true;
+        }
+        std::stringstream list(options.stages);
+        std::string stage;
+        while (std::getline(list, stage, ',')) {
+            if (stage == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs `run` once to warm up and then options.repeat times. items and
+    // bytes are what one run processes.
+    void stage(const std::string& name, const std::string& unit, uint64_t items, uint64_t bytes, const std::function<void()>& run) {
+        if (!enabled(name)) {
+            return;
+        }
+        StageResult result;
+        result.name = name;
+        result.unit = unit;
+        result.items = items;
+        result.bytes = bytes;
+        result.runs = options.repeat;
+        resetPeakRss();
+        result.rssBeforeBytes = statusBytes("VmRSS");
+        const uint64_t allocationsBefore = processAllocationCount();
+        run();
+
+        std::vector<double> seconds;
+        for (int i = 0; i < options.repeat; ++i) {
+            const auto begin = std::chrono::steady_clock::now();
+            run();
+            seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+        }
+        result.allocationsPerRun = (processAllocationCount() - allocationsBefore) / (options.repeat + 1);
+        result.peakRssBytes = statusBytes("VmHWM");
+
+        std::sort(seconds.begin(), seconds.end());
+        result.minSeconds = seconds.front();
+        result.medianSeconds = seconds[seconds.size() / 2];
+        result.meanSeconds = 0.0;
+        for (double s : seconds) {
+            result.meanSeconds += s / seconds.size();
+        }
+        printResult(table, result);
+        results.push_back(result);
+    }
+
+    const std::vector<StageResult>& stageResults() const {
+        return results;
+    }
+
+private:
+    const BenchmarkOptions& options;
+    FILE* table;
+    std::vector<StageResult> results;
+
+    static void printResult(FILE* stream, const StageResult& result) {
+        const double seconds = result.medianSeconds;
+        std::fprintf(stream, "%-22s %10.3f ms %12.3g %s/s %10.1f MB/s %10.1f MB peak %10llu allocs\n", result.name.c_str(), seconds * 1e3,
+            result.items / seconds, result.unit.c_str(), result.bytes / seconds / 1e6, result.peakRssBytes / 1e6,
+            static_cast<unsigned long long>(result.allocationsPerRun));
+        std::fflush(stream);
+    }
+};
+
+static void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+static std::string formatJson(const BenchmarkOptions& options, size_t fileBytes, const std::vector<StageResult>& results) {
+    char buffer[512];
+    const std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::string out = "{\n  \"timestamp\": ";
+    appendJsonString(out, timestamp);
+    out += ",\n  \"system\": {\"hardwareThreads\": " + std::to_string(std::thread::hardware_concurrency()) + ", \"simd\": ";
+    appendJsonString(out, simdLevelName(detectSimdLevel()));
+    out += ", \"compiler\": ";
+    appendJsonString(out, __VERSION__);
+    out += std::string(", \"tracing\": ") + (ENABLE_TRACING ? "true" : "false") + "},\n";
+    std::snprintf(buffer, sizeof(buffer), "  \"scene\": {\"splats\": %d, \"shDegree\": %d, \"extraProperties\": %d, \"seed\": %u, \"fileBytes\": %zu},\n",
+        options.splats, options.shDegree, options.extraProperties, options.seed, fileBytes);
+    out += buffer;
+    std::snprintf(buffer, sizeof(buffer), "  \"options\": {\"threads\": %d, \"repeat\": %d},\n  \"stages\": [", resolveThreadCount(options.threads), options.repeat);
+    out += buffer;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StageResult& result = results[i];
+        out += i ? ",\n    {\"name\": " : "\n    {\"name\": ";
+        appendJsonString(out, result.name);
+        out += ", \"unit\": ";
+        appendJsonString(out, result.unit);
+        std::snprintf(buffer, sizeof(buffer),
+            ", \"items\": %llu, \"bytes\": %llu, \"runs\": %d, \"minSeconds\": %.9g, \"medianSeconds\": %.9g, \"meanSeconds\": %.9g, "
+            "\"itemsPerSecond\": %.6g, \"bytesPerSecond\": %.6g, \"rssBeforeBytes\": %llu, \"peakRssBytes\": %llu, \"allocationsPerRun\": %llu}",
+            static_cast<unsigned long long>(result.items), static_cast<unsigned long long>(result.bytes), result.runs,
+            result.minSeconds, result.medianSeconds, result.meanSeconds, result.items / result.medianSeconds, result.bytes / result.medianSeconds,
+            static_cast<unsigned long long>(result.rssBeforeBytes), static_cast<unsigned long long>(result.peakRssBytes),
+            static_cast<unsigned long long>(result.allocationsPerRun));
+        out += buffer;
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+static const char* usage =
+    "usage: gsviewer_benchmark [options]\n"
+    "  --splats N            splats in the synthetic scene (1000000)\n"
+    "  --sh-degree D         SH degree 0-3 (3)\n"
+    "  --extra-properties K  unused float properties per splat (3)\n"
+    "  --threads T           worker threads, 0 for all hardware threads (0)\n"
+    "  --repeat R            measured runs per stage, after one warm-up run (5)\n"
+    "  --stages a,b,...      stages to run (all)\n"
+    "  --json PATH           write the results as JSON, - for stdout\n"
+    "  --work-dir DIR        where the synthetic PLY is written (/tmp)\n"
+    "  --seed S              scene seed (1)\n"
+    "stages: decodeHeader packedGaussians loadMapped loadPipelined packStruct\n"
+    "        packStaticArray packMat4x4 depthSort covariances shColors render\n";
+
+static BenchmarkOptions parseOptions(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag == "--help" || flag == "-h") {
+            std::fputs(usage, stdout);
+            std::exit(0);
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + flag);
+        }
+        const std::string value = argv[++i];
+        if (flag == "--splats") {
+            options.splats = std::stoi(value);
+        }
+        else if (flag == "--sh-degree") {
+            options.shDegree = std::stoi(value);
+        }
+        else if (flag == "--extra-properties") {
+            options.extraProperties = std::stoi(value);
+        }
+        else if (flag == "--threads") {
+            options.threads = std::stoi(value);
+        }
+        else if (flag == "--repeat") {
+            options.repeat = std::stoi(value);
+        }
+        else if (flag == "--stages") {
+            options.stages = value;
+        }
+        else if (flag == "--json") {
+            options.jsonPath = value;
+        }
+        else if (flag == "--work-dir") {
+            options.workDirectory = value;
+        }
+        else if (flag == "--seed") {
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        }
+        else {
+            throw std::invalid_argument("Unknown option " + flag);
+        }
+    }
+    if (options.splats < 1 || options.repeat < 1 || options.extraProperties < 0) {
+        throw std::invalid_argument("--splats and --repeat must be positive and --extra-properties not negative");
+    }
+    return options;
+}
+
+// Camera 1.5 scene extents back from the center, looking at it along -z.
+static Camera benchmarkCamera(float extent) {
+    Camera camera;
+    camera.width = 1280;
+    camera.height = 720;
+    camera.fx = camera.fy = 1000.0f;
+    camera.cx = camera.width * 0.5f;
+    camera.cy = camera.height * 0.5f;
+    camera.view = { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -2.5f * extent, 1.0f } } };
+    return camera;
+}
+
+static int runBenchmark(const BenchmarkOptions& options) {
+    const int nThreads = resolveThreadCount(options.threads);
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = options.splats;
+    sceneOptions.shDegree = options.shDegree;
+    sceneOptions.seed = options.seed;
+    sceneOptions.extraProperties.clear();
+    for (int i = 0; i < options.extraProperties; ++i) {
+        sceneOptions.extraProperties.emplace_back("extra_" + std::to_string(i), PlyScalarType::Float);
+    }
+    const std::vector<uint8_t> ply = makeSyntheticPly(sceneOptions);
+    const PlyHeader header = PackedGaussians::decodeHeader(ply);
+    const size_t headerBytes = ply.size() - header.vertexData.size();
+    const size_t n = options.splats;
+    std::fprintf(tableStream(options), "%d splats, SH degree %d, %zu-byte records, %.1f MB, %d threads, %s\n", options.splats, options.shDegree, header.layout.stride,
+        ply.size() / 1e6, nThreads, simdLevelName(detectSimdLevel()));
+
+    Benchmark benchmark(options);
+    LoadOptions loadOptions;
+    loadOptions.nThreads = nThreads;
+    loadOptions.maxShDegree = options.shDegree;
+
+    const int headerCalls = 1000;
+    benchmark.stage("decodeHeader", "headers", headerCalls, headerCalls * headerBytes, [&] {
+        for (int i = 0; i < headerCalls; ++i) {
+            PackedGaussians::decodeHeader(std::span<const uint8_t>(ply.data(), headerBytes + header.layout.stride));
+        }
+    });
+
+    PackedGaussians gaussians;
+    benchmark.stage("packedGaussians", "splats", n, ply.size(), [&] {
+        gaussians = PackedGaussians(ply, loadOptions);
+    });
+    if (gaussians.numGaussians == 0) {
+        gaussians = PackedGaussians(ply, loadOptions);
+    }
+
+    const bool needsFile = benchmark.enabled("loadMapped") || benchmark.enabled("loadPipelined");
+    const std::string plyPath = options.workDirectory + "/gsviewer_benchmark_" + std::to_string(getpid()) + ".ply";
+    if (needsFile) {
+        std::ofstream file(plyPath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(ply.data()), static_cast<std::streamsize>(ply.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to write " + plyPath);
+        }
+    }
+    benchmark.stage("loadMapped", "splats", n, ply.size(), [&] {
+        loadPackedGaussians(plyPath, loadOptions);
+    });
+    benchmark.stage("loadPipelined", "splats", n, ply.size(), [&] {
+        LoadPool pool(nThreads);
+        PipelineOptions pipelineOptions;
+        pipelineOptions.maxShDegree = options.shDegree;
+        pool.load(plyPath, pipelineOptions)->wait();
+    });
+    if (needsFile) {
+        std::remove(plyPath.c_str());
+    }
+
+    // Per-splat record of a typical vertex buffer.
+    vec3 position(f32), logScale(f32);
+    vec4 rotation(f32);
+    f32Type opacity;
+    Struct splatType({ { "position", &position }, { "logScale", &logScale }, { "rotation", &rotation }, { "opacity", &opacity } });
+    const PackingPlan splatPlan = compilePackingPlan(splatType);
+    std::vector<uint8_t> packed(n * splatPlan.stride);
+    benchmark.stage("packStruct", "splats", n, packed.size(), [&] {
+        packArray(splatPlan, { { "position", makeColumn(gaussians.positions) }, { "logScale", makeColumn(gaussians.logScales) },
+            { "rotation", makeColumn(gaussians.rotQuats) }, { "opacity", makeColumn(gaussians.opacityLogits) } },
+            n, packed, nThreads);
+    });
+
+    // The generic path packs NestedData value by value, so it gets a smaller array.
+    const int arraySplats = static_cast<int>(std::min<size_t>(n, 1 << 16));
+    if (benchmark.enabled("packStaticArray")) {
+        StaticArray arrayType(splatType, arraySplats);
+        std::vector<NestedData> elements;
+        elements.reserve(arraySplats);
+        auto values = [](const auto& array) {
+            std::vector<NestedData> list;
+            for (float value : array) {
+                list.emplace_back(value);
+            }
+            return NestedData(std::move(list));
+        };
+        for (int i = 0; i < arraySplats; ++i) {
+            elements.emplace_back(std::unordered_map<std::string, NestedData> { { "position", values(gaussians.positions[i]) },
+                { "logScale", values(gaussians.logScales[i]) }, { "rotation", values(gaussians.rotQuats[i]) },
+                { "opacity", NestedData(gaussians.opacityLogits[i]) } });
+        }
+        const NestedData array(std::move(elements));
+        std::vector<uint8_t> buffer(arrayType.size);
+        benchmark.stage("packStaticArray", "splats", arraySplats, arrayType.size, [&] {
+            arrayType.pack(0, array, buffer);
+        });
+    }
+
+    if (benchmark.enabled("packMat4x4")) {
+        const int matrixCalls = 100000;
+        mat4x4 matrixType(f32);
+        std::vector<NestedData> columns;
+        for (int column = 0; column < 4; ++column) {
+            std::vector<NestedData> rows;
+            for (int row = 0; row < 4; ++row) {
+                rows.emplace_back(static_cast<float>(column * 4 + row));
+            }
+            columns.emplace_back(std::move(rows));
+        }
+        const NestedData matrix(std::move(columns));
+        std::vector<uint8_t> buffer(matrixType.size);
+        benchmark.stage("packMat4x4", "matrices", matrixCalls, static_cast<uint64_t>(matrixCalls) * matrixType.size, [&] {
+            for (int i = 0; i < matrixCalls; ++i) {
+                matrixType.pack(0, matrix, buffer);
+            }
+        });
+    }
+
+    const Camera camera = benchmarkCamera(sceneOptions.extent);
+    DepthSorter sorter({ .nThreads = nThreads });
+    benchmark.stage("depthSort", "splats", n, n * sizeof(std::array<float, 3>), [&] {
+        sorter.sort(gaussians, camera.view);
+    });
+
+    std::vector<Covariance> covariances(n);
+    benchmark.stage("covariances", "splats", n, n * (sizeof(std::array<float, 3>) + sizeof(std::array<float, 4>)), [&] {
+        parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+            computeCovariances(gaussians, begin, end, covariances.data() + begin);
+        });
+    });
+
+    std::vector<Color> colors(n);
+    const auto cameraPosition = camera.position();
+    benchmark.stage("shColors", "splats", n, gaussians.shCoeffs.size() * sizeof(float), [&] {
+        parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+            evaluateShColors(gaussians, cameraPosition, begin, end, colors.data() + begin);
+        });
+    });
+
+    benchmark.stage("render", "splats", n, static_cast<uint64_t>(camera.width) * camera.height * 4, [&] {
+        SplatRasterizer rasterizer({ .nThreads = nThreads });
+        rasterizer.render(gaussians, camera);
+    });
+
+    if (!options.jsonPath.empty()) {
+        const std::string json = formatJson(options, ply.size(), benchmark.stageResults());
+        if (options.jsonPath == "-") {
+            std::fputs(json.c_str(), stdout);
+        }
+        else {
+            std::ofstream file(options.jsonPath);
+            file << json;
+            if (!file) {
+                throw std::runtime_error("Failed to write " + options.jsonPath);
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    try {
+        return runBenchmark(parseOptions(argc, argv));
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n%s", e.what(), usage);
+        return 1;
+    }
+}
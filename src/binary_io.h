@@ -0,0 +1,25 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <cstddef>
+
+// Raw reads and writes of arrays in host byte order, shared by the binary
+// file formats. Write errors are left on the stream for the caller to check.
+template <typename T>
+void writeValues(std::ofstream& file, const T* values, size_t count) {
+    file.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+// Throws std::runtime_error naming `fileKind` ("LOD file") when the file
+// ends before `count` values.
+template <typename T>
+void readValues(std::ifstream& file, T* values, size_t count, const char* fileKind) {
+    if (!file.read(reinterpret_cast<char*>(values), count * sizeof(T))) {
+        throw std::runtime_error(std::string(fileKind) + " is truncated");
+    }
+}
+
+#endif // BINARY_IO_H
@@ -0,0 +1,280 @@
+#include "bvh.h"
+#include "parallel.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+
+std::array<std::array<float, 3>, 3> quaternionToMatrix(const std::array<float, 4>& quat) {
+    const float norm = std::sqrt(quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+    if (norm == 0.0f) {
+        return { { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } } };
+    }
+    const float w = quat[0] / norm;
+    const float x = quat[1] / norm;
+    const float y = quat[2] / norm;
+    const float z = quat[3] / norm;
+    return { {
+        { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+        { 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+        { 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) },
+    } };
+}
+
+Aabb splatAabb(const std::array<float, 3>& position, const std::array<float, 3>& logScale, const std::array<float, 4>& rotQuat, float sigmas) {
+    const auto rotation = quaternionToMatrix(rotQuat);
+    const std::array<float, 3> scale = { std::exp(logScale[0]), std::exp(logScale[1]), std::exp(logScale[2]) };
+    Aabb box;
+    for (int axis = 0; axis < 3; ++axis) {
+        // Standard deviation along a world axis is the norm of that row of R * S.
+        float variance = 0.0f;
+        for (int j = 0; j < 3; ++j) {
+            const float component = rotation[axis][j] * scale[j];
+            variance += component * component;
+        }
+        const float extent = sigmas * std::sqrt(variance);
+        box.min[axis] = position[axis] - extent;
+        box.max[axis] = position[axis] + extent;
+    }
+    return box;
+}
+
+static Aabb emptyAabb() {
+    const float inf = std::numeric_limits<float>::infinity();
+    return { { inf, inf, inf }, { -inf, -inf, -inf } };
+}
+
+static void mergeAabb(Aabb& box, const Aabb& other) {
+    for (int axis = 0; axis < 3; ++axis) {
+        box.min[axis] = std::min(box.min[axis], other.min[axis]);
+        box.max[axis] = std::max(box.max[axis], other.max[axis]);
+    }
+}
+
+static uint32_t expandBits10(uint32_t value) {
+    value &= 0x3ffu;
+    value = (value | (value << 16)) & 0x030000ffu;
+    value = (value | (value << 8)) & 0x0300f00fu;
+    value = (value | (value << 4)) & 0x030c30c3u;
+    value = (value | (value << 2)) & 0x09249249u;
+    return value;
+}
+
+Frustum Frustum::fromViewProjection(const ViewMatrix& viewProjection) {
+    auto row = [&](int r) {
+        return std::array<float, 4>{ viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r] };
+    };
+    const auto x = row(0), y = row(1), z = row(2), w = row(3);
+    Frustum frustum;
+    for (int k = 0; k < 4; ++k) {
+        frustum.planes[0][k] = w[k] + x[k];
+        frustum.planes[1][k] = w[k] - x[k];
+        frustum.planes[2][k] = w[k] + y[k];
+        frustum.planes[3][k] = w[k] - y[k];
+        frustum.planes[4][k] = w[k] + z[k];
+        frustum.planes[5][k] = w[k] - z[k];
+    }
+    return frustum;
+}
+
+SplatBvh::SplatBvh(const PackedGaussians& gaussians, const SpatialIndexOptions& options) : leafSize(std::max(1, options.leafSize)) {
+    const size_t n = gaussians.numGaussians;
+    const int nThreads = options.nThreads;
+    const int nSlices = parallelSlices(n, nThreads);
+
+    std::vector<Aabb> bounds(n);
+    std::vector<Aabb> sliceCenters(nSlices, emptyAabb());
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        Aabb& centers = sliceCenters[slice];
+        for (size_t i = begin; i < end; ++i) {
+            bounds[i] = splatAabb(gaussians.positions[i], gaussians.logScales[i], gaussians.rotQuats[i], options.extentSigmas);
+            mergeAabb(centers, { gaussians.positions[i], gaussians.positions[i] });
+        }
+    });
+    Aabb centers = emptyAabb();
+    for (const auto& slice : sliceCenters) {
+        mergeAabb(centers, slice);
+    }
+
+    std::vector<uint32_t> keys(n);
+    order.resize(n);
+    parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+        std::array<float, 3> scale;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float extent = centers.max[axis] - centers.min[axis];
+            scale[axis] = extent > 0.0f ? 1023.0f / extent : 0.0f;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t code = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const float cell = (gaussians.positions[i][axis] - centers.min[axis]) * scale[axis];
+                code |= expandBits10(static_cast<uint32_t>(std::clamp(cell, 0.0f, 1023.0f))) << (2 - axis);
+            }
+            keys[i] = code;
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+    std::vector<uint32_t> scratchKeys, scratchOrder;
+    radixSortPairs(keys, order, scratchKeys, scratchOrder, 30, nThreads);
+
+    splatBounds.resize(n);
+    parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            splatBounds[i] = bounds[order[i]];
+        }
+    });
+
+    levelOffsets = { 0 };
+    size_t levelSize = std::max<size_t>(1, (n + leafSize - 1) / leafSize);
+    size_t totalNodes = levelSize;
+    while (levelSize > 1) {
+        levelOffsets.push_back(totalNodes);
+        levelSize = (levelSize + 1) / 2;
+        totalNodes += levelSize;
+    }
+    levelOffsets.push_back(totalNodes);
+    nodeBounds.resize(totalNodes);
+
+    const size_t nLeaves = levelOffsets[1];
+    parallelFor(nLeaves, nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t leaf = begin; leaf < end; ++leaf) {
+            Aabb box = emptyAabb();
+            const size_t last = std::min(n, (leaf + 1) * leafSize);
+            for (size_t i = leaf * leafSize; i < last; ++i) {
+                mergeAabb(box, splatBounds[i]);
+            }
+            nodeBounds[leaf] = box;
+        }
+    });
+    for (size_t level = 1; level + 1 < levelOffsets.size(); ++level) {
+        const size_t childBase = levelOffsets[level - 1];
+        const size_t childCount = levelOffsets[level] - childBase;
+        const size_t base = levelOffsets[level];
+        parallelFor(levelOffsets[level + 1] - base, nThreads, [&](int, size_t begin, size_t end) {
+            for (size_t node = begin; node < end; ++node) {
+                Aabb box = nodeBounds[childBase + 2 * node];
+                if (2 * node + 1 < childCount) {
+                    mergeAabb(box, nodeBounds[childBase + 2 * node + 1]);
+                }
+                nodeBounds[base + node] = box;
+            }
+        });
+    }
+    // The sentinel offset only marks the end of the last level.
+    levelOffsets.pop_back();
+}
+
+const Aabb& SplatBvh::bounds() const {
+    return nodeBounds.back();
+}
+
+enum class Overlap { Outside, Intersects, Inside };
+
+template <typename Classify>
+static std::vector<IndexRange> collectRanges(const SplatBvh& bvh, Classify classify) {
+    std::vector<IndexRange> ranges;
+    auto emit = [&](size_t begin, size_t end) {
+        if (!ranges.empty() && ranges.back().end == begin) {
+            ranges.back().end = static_cast<uint32_t>(end);
+        }
+        else {
+            ranges.push_back({ static_cast<uint32_t>(begin), static_cast<uint32_t>(end) });
+        }
+    };
+
+    const size_t n = bvh.order.size();
+    std::vector<std::pair<int, size_t>> stack = { { static_cast<int>(bvh.levelOffsets.size()) - 1, 0 } };
+    while (!stack.empty()) {
+        const auto [level, index] = stack.back();
+        stack.pop_back();
+
+        const Overlap overlap = classify(bvh.nodeBounds[bvh.levelOffsets[level] + index]);
+        if (overlap == Overlap::Outside) {
+            continue;
+        }
+        const size_t span = static_cast<size_t>(bvh.leafSize) << level;
+        const size_t begin = index * span;
+        const size_t end = std::min(n, begin + span);
+        if (overlap == Overlap::Inside) {
+            emit(begin, end);
+        }
+        else if (level == 0) {
+            for (size_t i = begin; i < end; ++i) {
+                if (classify(bvh.splatBounds[i]) != Overlap::Outside) {
+                    emit(i, i + 1);
+                }
+            }
+        }
+        else {
+            // Right child first so ranges come out in ascending order.
+            const size_t childCount = bvh.levelOffsets[level] - bvh.levelOffsets[level - 1];
+            if (2 * index + 1 < childCount) {
+                stack.push_back({ level - 1, 2 * index + 1 });
+            }
+            stack.push_back({ level - 1, 2 * index });
+        }
+    }
+    return ranges;
+}
+
+std::vector<IndexRange> SplatBvh::queryFrustum(const Frustum& frustum) const {
+    return collectRanges(*this, [&](const Aabb& box) {
+        Overlap overlap = Overlap::Inside;
+        for (const auto& plane : frustum.planes) {
+            float farthest = plane[3];
+            float nearest = plane[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                farthest += plane[axis] * (plane[axis] >= 0.0f ? box.max[axis] : box.min[axis]);
+                nearest += plane[axis] * (plane[axis] >= 0.0f ? box.min[axis] : box.max[axis]);
+            }
+            if (farthest < 0.0f) {
+                return Overlap::Outside;
+            }
+            if (nearest < 0.0f) {
+                overlap = Overlap::Intersects;
+            }
+        }
+        return overlap;
+    });
+}
+
+std::vector<IndexRange> SplatBvh::queryBox(const Aabb& query) const {
+    return collectRanges(*this, [&](const Aabb& box) {
+        bool inside = true;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (box.max[axis] < query.min[axis] || box.min[axis] > query.max[axis]) {
+                return Overlap::Outside;
+            }
+            inside = inside && box.min[axis] >= query.min[axis] && box.max[axis] <= query.max[axis];
+        }
+        return inside ? Overlap::Inside : Overlap::Intersects;
+    });
+}
+
+std::vector<IndexRange> SplatBvh::queryRadius(const std::array<float, 3>& center, float radius) const {
+    const float radiusSquared = radius * radius;
+    return collectRanges(*this, [&](const Aabb& box) {
+        float nearestSquared = 0.0f;
+        float farthestSquared = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float below = box.min[axis] - center[axis];
+            const float above = center[axis] - box.max[axis];
+            const float gap = std::max({ below, above, 0.0f });
+            nearestSquared += gap * gap;
+            const float reach = std::max(std::abs(below), std::abs(above));
+            farthestSquared += reach * reach;
+        }
+        if (nearestSquared > radiusSquared) {
+            return Overlap::Outside;
+        }
+        return farthestSquared <= radiusSquared ? Overlap::Inside : Overlap::Intersects;
+    });
+}
+
+size_t SplatBvh::rangeSize(const std::vector<IndexRange>& ranges) {
+    size_t total = 0;
+    for (const auto& range : ranges) {
+        total += range.end - range.begin;
+    }
+    return total;
+}
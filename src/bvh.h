@@ -0,0 +1,69 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "ply.h"
+#include "sorting.h"
+#include <vector>
+#include <array>
+#include <cstdint>
+
+struct Aabb {
+    std::array<float, 3> min;
+    std::array<float, 3> max;
+};
+
+// Six planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 on the inside.
+struct Frustum {
+    std::array<std::array<float, 4>, 6> planes;
+
+    // Planes of the clip volume of a column-major projection * view matrix
+    // with OpenGL depth range.
+    static Frustum fromViewProjection(const ViewMatrix& viewProjection);
+};
+
+// Half-open range of positions in SplatBvh::order.
+struct IndexRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct SpatialIndexOptions {
+    int nThreads = 0;
+    int leafSize = 32;
+    // Splat bounds extend this many standard deviations along each axis.
+    float extentSigmas = 3.0f;
+};
+
+// Linear BVH over splats. Splats are sorted by the 30-bit Morton code of their
+// center, so every node covers a contiguous range of `order`. Leaves hold
+// leafSize consecutive splats and the tree above them is a complete binary
+// tree built bottom-up, one level at a time.
+class SplatBvh {
+public:
+    // Splat indices in Morton order; query results index into this.
+    std::vector<uint32_t> order;
+    // Bounds of splat order[i], from its position, scales and rotation.
+    std::vector<Aabb> splatBounds;
+    // Node bounds, level by level from the leaves up to the single root.
+    std::vector<Aabb> nodeBounds;
+    std::vector<size_t> levelOffsets;
+    int leafSize;
+
+    SplatBvh(const PackedGaussians& gaussians, const SpatialIndexOptions& options = {});
+
+    const Aabb& bounds() const;
+
+    std::vector<IndexRange> queryFrustum(const Frustum& frustum) const;
+    std::vector<IndexRange> queryBox(const Aabb& box) const;
+    std::vector<IndexRange> queryRadius(const std::array<float, 3>& center, float radius) const;
+
+    static size_t rangeSize(const std::vector<IndexRange>& ranges);
+};
+
+// Rotation matrix (row-major) of a possibly unnormalized (w, x, y, z) quaternion.
+std::array<std::array<float, 3>, 3> quaternionToMatrix(const std::array<float, 4>& quat);
+
+// Axis-aligned bounds of the given number of standard deviations of a splat.
+Aabb splatAabb(const std::array<float, 3>& position, const std::array<float, 3>& logScale, const std::array<float, 4>& rotQuat, float sigmas);
+
+#endif // BVH_H
@@ -0,0 +1,388 @@
+#include "compact.h"
+#include "binary_io.h"
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t absBits = bits & 0x7fffffffu;
+
+    if (absBits >= 0x7f800000u) {
+        return sign | 0x7c00u | (absBits > 0x7f800000u ? 0x200u : 0u);
+    }
+    if (absBits >= 0x477ff000u) {
+        return sign | 0x7c00u;
+    }
+    if (absBits < 0x38800000u) {
+        if (absBits < 0x33000000u) {
+            return sign;
+        }
+        const uint32_t mantissa = (absBits & 0x7fffffu) | 0x800000u;
+        const uint32_t shift = 126 - (absBits >> 23);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+
+    uint32_t half = (absBits - 0x38000000u) >> 13;
+    const uint32_t remainder = absBits & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1))) {
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+float halfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign;
+    }
+    else {
+        uint32_t normalizedExponent = 113;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            normalizedExponent--;
+        }
+        bits = sign | (normalizedExponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+static const float quaternionComponentBound = 0.70710678f;
+
+uint32_t packQuaternion(const std::array<float, 4>& quat) {
+    const float norm = std::sqrt(quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+    std::array<float, 4> q = { 1.0f, 0.0f, 0.0f, 0.0f };
+    if (norm > 0.0f) {
+        for (int i = 0; i < 4; ++i) {
+            q[i] = quat[i] / norm;
+        }
+    }
+
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (std::abs(q[i]) > std::abs(q[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so the dropped component can be kept positive.
+    const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint32_t packed = static_cast<uint32_t>(largest) << 30;
+    int shift = 20;
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        const float unit = (q[i] * sign / quaternionComponentBound + 1.0f) * 0.5f;
+        const uint32_t quantized = static_cast<uint32_t>(std::lround(std::clamp(unit, 0.0f, 1.0f) * 1023.0f));
+        packed |= quantized << shift;
+        shift -= 10;
+    }
+    return packed;
+}
+
+std::array<float, 4> unpackQuaternion(uint32_t packed) {
+    const int largest = static_cast<int>(packed >> 30);
+    std::array<float, 4> q;
+    float sumSquares = 0.0f;
+    int shift = 20;
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        const float unit = ((packed >> shift) & 0x3ffu) / 1023.0f;
+        q[i] = (unit * 2.0f - 1.0f) * quaternionComponentBound;
+        sumSquares += q[i] * q[i];
+        shift -= 10;
+    }
+    q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+    return q;
+}
+
+static uint8_t quantize8(float value, const QuantizationRange& range) {
+    if (range.max <= range.min) {
+        return 0;
+    }
+    const float unit = std::clamp((value - range.min) / (range.max - range.min), 0.0f, 1.0f);
+    return static_cast<uint8_t>(std::lround(unit * 255.0f));
+}
+
+static float dequantize8(uint8_t value, const QuantizationRange& range) {
+    return range.min + (range.max - range.min) * (value / 255.0f);
+}
+
+static QuantizationRange emptyRange() {
+    return { std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+}
+
+static void extendRange(QuantizationRange& range, float value) {
+    range.min = std::min(range.min, value);
+    range.max = std::max(range.max, value);
+}
+
+CompactGaussians::CompactGaussians()
+    : numGaussians(0), sphericalHarmonicsDegree(0), shEncoding(ShEncoding::Float16),
+      positionOrigin({ 0.0f, 0.0f, 0.0f }), logScaleRange({ 0.0f, 0.0f }), opacityRange({ 0.0f, 0.0f }) {}
+
+CompactGaussians::CompactGaussians(const PackedGaussians& gaussians, ShEncoding shEncoding)
+    : numGaussians(gaussians.numGaussians), sphericalHarmonicsDegree(gaussians.sphericalHarmonicsDegree), shEncoding(shEncoding),
+      positionOrigin({ 0.0f, 0.0f, 0.0f }), logScaleRange(emptyRange()), opacityRange(emptyRange()) {
+    const int nCoeffs = nShCoeffs();
+
+    std::array<QuantizationRange, 3> bounds = { emptyRange(), emptyRange(), emptyRange() };
+    shRanges.assign(nCoeffs, emptyRange());
+    for (int i = 0; i < numGaussians; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            extendRange(bounds[axis], gaussians.positions[i][axis]);
+            extendRange(logScaleRange, gaussians.logScales[i][axis]);
+        }
+        extendRange(opacityRange, gaussians.opacityLogits[i]);
+        for (int coeff = 0; coeff < nCoeffs; ++coeff) {
+            for (int rgb = 0; rgb < 3; ++rgb) {
+                extendRange(shRanges[coeff], gaussians.shCoeff(i, coeff, rgb));
+            }
+        }
+    }
+    // Positions are stored relative to the scene center, where fp16 is most precise.
+    if (numGaussians > 0) {
+        for (int axis = 0; axis < 3; ++axis) {
+            positionOrigin[axis] = (bounds[axis].min + bounds[axis].max) * 0.5f;
+        }
+    }
+
+    const size_t shValueSize = shEncoding == ShEncoding::Float16 ? sizeof(uint16_t) : sizeof(uint8_t);
+    positions.resize(numGaussians);
+    logScales.resize(numGaussians);
+    rotQuats.resize(numGaussians);
+    opacities.resize(numGaussians);
+    shCoeffs.resize(static_cast<size_t>(numGaussians) * nCoeffs * 3 * shValueSize);
+
+    for (int i = 0; i < numGaussians; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            positions[i][axis] = floatToHalf(gaussians.positions[i][axis] - positionOrigin[axis]);
+            logScales[i][axis] = quantize8(gaussians.logScales[i][axis], logScaleRange);
+        }
+        rotQuats[i] = packQuaternion(gaussians.rotQuats[i]);
+        opacities[i] = quantize8(gaussians.opacityLogits[i], opacityRange);
+
+        for (int coeff = 0; coeff < nCoeffs; ++coeff) {
+            for (int rgb = 0; rgb < 3; ++rgb) {
+                const size_t index = (static_cast<size_t>(i) * nCoeffs + coeff) * 3 + rgb;
+                const float value = gaussians.shCoeff(i, coeff, rgb);
+                if (shEncoding == ShEncoding::Float16) {
+                    const uint16_t half = floatToHalf(value);
+                    std::memcpy(&shCoeffs[index * 2], &half, sizeof(uint16_t));
+                }
+                else {
+                    shCoeffs[index] = quantize8(value, shRanges[coeff]);
+                }
+            }
+        }
+    }
+}
+
+int CompactGaussians::nShCoeffs() const {
+    return (sphericalHarmonicsDegree + 1) * (sphericalHarmonicsDegree + 1);
+}
+
+size_t CompactGaussians::byteSize() const {
+    return positions.size() * sizeof(positions[0]) + logScales.size() * sizeof(logScales[0])
+        + rotQuats.size() * sizeof(rotQuats[0]) + opacities.size() + shCoeffs.size()
+        + shRanges.size() * sizeof(QuantizationRange);
+}
+
+PackedGaussians CompactGaussians::decode(ShLayout shLayout) const {
+    PackedGaussians gaussians;
+    gaussians.numGaussians = numGaussians;
+    gaussians.sphericalHarmonicsDegree = sphericalHarmonicsDegree;
+    gaussians.shLayout = ShLayout::Interleaved;
+
+    const int nCoeffs = nShCoeffs();
+    gaussians.positions.resize(numGaussians);
+    gaussians.logScales.resize(numGaussians);
+    gaussians.rotQuats.resize(numGaussians);
+    gaussians.opacityLogits.resize(numGaussians);
+    gaussians.shCoeffs.resize(static_cast<size_t>(numGaussians) * nCoeffs * 3);
+
+    for (int i = 0; i < numGaussians; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            gaussians.positions[i][axis] = halfToFloat(positions[i][axis]) + positionOrigin[axis];
+            gaussians.logScales[i][axis] = dequantize8(logScales[i][axis], logScaleRange);
+        }
+        gaussians.rotQuats[i] = unpackQuaternion(rotQuats[i]);
+        gaussians.opacityLogits[i] = dequantize8(opacities[i], opacityRange);
+    }
+
+    const size_t nValues = gaussians.shCoeffs.size();
+    if (shEncoding == ShEncoding::Float16) {
+        for (size_t index = 0; index < nValues; ++index) {
+            uint16_t half;
+            std::memcpy(&half, &shCoeffs[index * 2], sizeof(uint16_t));
+            gaussians.shCoeffs[index] = halfToFloat(half);
+        }
+    }
+    else {
+        for (size_t index = 0; index < nValues; ++index) {
+            gaussians.shCoeffs[index] = dequantize8(shCoeffs[index], shRanges[(index / 3) % nCoeffs]);
+        }
+    }
+
+    gaussians.setShLayout(shLayout);
+    return gaussians;
+}
+
+static const char compactMagic[4] = { 'C', 'G', 'S', 'P' };
+static const uint32_t compactVersion = 1;
+static const char compactFileKind[] = "Compact splat file";
+
+void CompactGaussians::save(const std::string& filePath) const {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+
+    const int32_t header[3] = { numGaussians, sphericalHarmonicsDegree, static_cast<int32_t>(shEncoding) };
+    writeValues(file, compactMagic, 4);
+    writeValues(file, &compactVersion, 1);
+    writeValues(file, header, 3);
+    writeValues(file, positionOrigin.data(), 3);
+    writeValues(file, &logScaleRange, 1);
+    writeValues(file, &opacityRange, 1);
+    writeValues(file, shRanges.data(), shRanges.size());
+    writeValues(file, positions.data(), positions.size());
+    writeValues(file, logScales.data(), logScales.size());
+    writeValues(file, rotQuats.data(), rotQuats.size());
+    writeValues(file, opacities.data(), opacities.size());
+    writeValues(file, shCoeffs.data(), shCoeffs.size());
+
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
+
+CompactGaussians CompactGaussians::load(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to load file");
+    }
+
+    char magic[4];
+    uint32_t version;
+    int32_t header[3];
+    readValues(file, magic, 4, compactFileKind);
+    readValues(file, &version, 1, compactFileKind);
+    if (std::memcmp(magic, compactMagic, 4) != 0 || version != compactVersion) {
+        throw std::runtime_error("Not a compact splat file, or unsupported version");
+    }
+    readValues(file, header, 3, compactFileKind);
+
+    CompactGaussians compact;
+    compact.numGaussians = header[0];
+    compact.sphericalHarmonicsDegree = header[1];
+    compact.shEncoding = static_cast<ShEncoding>(header[2]);
+    if (compact.numGaussians < 0 || compact.sphericalHarmonicsDegree < 0 || compact.sphericalHarmonicsDegree > 3
+        || (compact.shEncoding != ShEncoding::Float16 && compact.shEncoding != ShEncoding::Uint8)) {
+        throw std::runtime_error("Invalid compact splat file header");
+    }
+
+    const size_t n = compact.numGaussians;
+    const int nCoeffs = compact.nShCoeffs();
+    const size_t shValueSize = compact.shEncoding == ShEncoding::Float16 ? sizeof(uint16_t) : sizeof(uint8_t);
+    compact.shRanges.resize(nCoeffs);
+    compact.positions.resize(n);
+    compact.logScales.resize(n);
+    compact.rotQuats.resize(n);
+    compact.opacities.resize(n);
+    compact.shCoeffs.resize(n * nCoeffs * 3 * shValueSize);
+
+    readValues(file, compact.positionOrigin.data(), 3, compactFileKind);
+    readValues(file, &compact.logScaleRange, 1, compactFileKind);
+    readValues(file, &compact.opacityRange, 1, compactFileKind);
+    readValues(file, compact.shRanges.data(), compact.shRanges.size(), compactFileKind);
+    readValues(file, compact.positions.data(), n, compactFileKind);
+    readValues(file, compact.logScales.data(), n, compactFileKind);
+    readValues(file, compact.rotQuats.data(), n, compactFileKind);
+    readValues(file, compact.opacities.data(), n, compactFileKind);
+    readValues(file, compact.shCoeffs.data(), compact.shCoeffs.size(), compactFileKind);
+    return compact;
+}
+
+namespace {
+
+struct ErrorAccumulator {
+    double sumSquares = 0.0;
+    double max = 0.0;
+    size_t count = 0;
+
+    void add(double error) {
+        sumSquares += error * error;
+        max = std::max(max, std::abs(error));
+        count++;
+    }
+
+    AttributeError result() const {
+        return { count ? std::sqrt(sumSquares / count) : 0.0, max };
+    }
+};
+
+}
+
+QuantizationReport measureQuantizationError(const PackedGaussians& reference, const PackedGaussians& decoded) {
+    if (reference.numGaussians != decoded.numGaussians || reference.sphericalHarmonicsDegree != decoded.sphericalHarmonicsDegree) {
+        throw std::invalid_argument("Cannot compare splat sets of different size or SH degree");
+    }
+
+    ErrorAccumulator position, logScale, rotation, opacity, shDc, shRest;
+    for (int i = 0; i < reference.numGaussians; ++i) {
+        double distanceSquared = 0.0;
+        for (int axis = 0; axis < 3; ++axis) {
+            const double delta = reference.positions[i][axis] - decoded.positions[i][axis];
+            distanceSquared += delta * delta;
+            logScale.add(reference.logScales[i][axis] - decoded.logScales[i][axis]);
+        }
+        position.add(std::sqrt(distanceSquared));
+
+        double dot = 0.0, normA = 0.0, normB = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            dot += reference.rotQuats[i][k] * decoded.rotQuats[i][k];
+            normA += reference.rotQuats[i][k] * reference.rotQuats[i][k];
+            normB += decoded.rotQuats[i][k] * decoded.rotQuats[i][k];
+        }
+        const double cosine = normA > 0.0 && normB > 0.0 ? std::abs(dot) / std::sqrt(normA * normB) : 1.0;
+        rotation.add(2.0 * std::acos(std::min(1.0, cosine)));
+
+        opacity.add(reference.opacityLogits[i] - decoded.opacityLogits[i]);
+
+        for (int coeff = 0; coeff < reference.nShCoeffs(); ++coeff) {
+            for (int rgb = 0; rgb < 3; ++rgb) {
+                const double delta = reference.shCoeff(i, coeff, rgb) - decoded.shCoeff(i, coeff, rgb);
+                (coeff == 0 ? shDc : shRest).add(delta);
+            }
+        }
+    }
+
+    return { position.result(), logScale.result(), rotation.result(), opacity.result(), shDc.result(), shRest.result() };
+}
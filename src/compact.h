@@ -0,0 +1,76 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "ply.h"
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// Smallest-three quaternion packing: the index of the largest component in
+// the top 2 bits, the other three components as 10-bit values in
+// [-1/sqrt(2), 1/sqrt(2)]. The quaternion is normalized on the way in.
+uint32_t packQuaternion(const std::array<float, 4>& quat);
+std::array<float, 4> unpackQuaternion(uint32_t packed);
+
+enum class ShEncoding { Float16, Uint8 };
+
+struct QuantizationRange {
+    float min;
+    float max;
+};
+
+// Compact in-memory splat representation, 2-4x smaller than PackedGaussians:
+// fp16 positions relative to positionOrigin, 8-bit log-scales and opacity
+// over per-scene ranges, smallest-three quaternions and fp16 or 8-bit SH.
+class CompactGaussians {
+public:
+    int numGaussians;
+    int sphericalHarmonicsDegree;
+    ShEncoding shEncoding;
+
+    std::array<float, 3> positionOrigin;
+    QuantizationRange logScaleRange;
+    QuantizationRange opacityRange;
+    // One range per SH coefficient index, shared by the three channels (Uint8 only).
+    std::vector<QuantizationRange> shRanges;
+
+    std::vector<std::array<uint16_t, 3>> positions;
+    std::vector<std::array<uint8_t, 3>> logScales;
+    std::vector<uint32_t> rotQuats;
+    std::vector<uint8_t> opacities;
+    // Interleaved per splat, 2 bytes per value for Float16 and 1 for Uint8.
+    std::vector<uint8_t> shCoeffs;
+
+    CompactGaussians();
+    CompactGaussians(const PackedGaussians& gaussians, ShEncoding shEncoding = ShEncoding::Float16);
+
+    int nShCoeffs() const;
+    size_t byteSize() const;
+
+    PackedGaussians decode(ShLayout shLayout = ShLayout::Interleaved) const;
+
+    void save(const std::string& filePath) const;
+    static CompactGaussians load(const std::string& filePath);
+};
+
+struct AttributeError {
+    double rms;
+    double max;
+};
+
+struct QuantizationReport {
+    AttributeError position;
+    AttributeError logScale;
+    AttributeError rotationRadians;
+    AttributeError opacityLogit;
+    AttributeError shDc;
+    AttributeError shRest;
+};
+
+QuantizationReport measureQuantizationError(const PackedGaussians& reference, const PackedGaussians& decoded);
+
+#endif // COMPACT_H
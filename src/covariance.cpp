@@ -0,0 +1,238 @@
+#include "covariance.h"
+#include "parallel.h"
+#include <cmath>
+#include <algorithm>
+
+#if HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+static void computeCovariancesScalar(const PackedGaussians& gaussians, size_t begin, size_t end, Covariance* out) {
+    for (size_t i = begin; i < end; ++i) {
+        const auto& quat = gaussians.rotQuats[i];
+        const auto& logScale = gaussians.logScales[i];
+        // Scaling the products by 2 / |q|^2 normalizes the quaternion without a
+        // square root; a zero quaternion gives k = 0 and so the identity.
+        const float norm2 = quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3];
+        const float k = norm2 > 0.0f ? 2.0f / norm2 : 0.0f;
+        const float w = quat[0], x = quat[1], y = quat[2], z = quat[3];
+        const float xx = k * x * x, yy = k * y * y, zz = k * z * z;
+        const float xy = k * x * y, xz = k * x * z, yz = k * y * z;
+        const float wx = k * w * x, wy = k * w * y, wz = k * w * z;
+        const float r[3][3] = {
+            { 1.0f - (yy + zz), xy - wz, xz + wy },
+            { xy + wz, 1.0f - (xx + zz), yz - wx },
+            { xz - wy, yz + wx, 1.0f - (xx + yy) },
+        };
+        const float s[3] = { std::exp(2.0f * logScale[0]), std::exp(2.0f * logScale[1]), std::exp(2.0f * logScale[2]) };
+
+        Covariance& covariance = out[i - begin];
+        int index = 0;
+        for (int row = 0; row < 3; ++row) {
+            for (int column = row; column < 3; ++column) {
+                covariance[index++] = r[row][0] * r[column][0] * s[0] + r[row][1] * r[column][1] * s[1] + r[row][2] * r[column][2] * s[2];
+            }
+        }
+    }
+}
+
+#if HAS_X86_SIMD
+
+// exp(x) as 2^n * 2^f with f in [-0.5, 0.5] and a degree 5 polynomial for 2^f.
+// Inputs are clamped to the normal float range.
+__attribute__((target("avx2,fma")))
+static __m256 exp256(__m256 x) {
+    __m256 t = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504f));
+    t = _mm256_min_ps(_mm256_max_ps(t, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+    const __m256 n = _mm256_round_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m256 f = _mm256_sub_ps(t, n);
+    __m256 p = _mm256_set1_ps(1.3333558e-3f);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(9.6181291e-3f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(5.5504109e-2f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.4022651e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(6.9314718e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+    const __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(exponent));
+}
+
+// Eight splats per iteration; the AoS columns are read with gathers and the
+// results transposed through the stack.
+__attribute__((target("avx2,fma")))
+static size_t computeCovariancesAvx2(const PackedGaussians& gaussians, size_t begin, size_t end, Covariance* out) {
+    const __m256i scaleIndex = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i quatIndex = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    alignas(32) float lanes[6][8];
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const float* quat = gaussians.rotQuats[i].data();
+        const float* logScale = gaussians.logScales[i].data();
+        const __m256 w = _mm256_i32gather_ps(quat, quatIndex, 4);
+        const __m256 x = _mm256_i32gather_ps(quat + 1, quatIndex, 4);
+        const __m256 y = _mm256_i32gather_ps(quat + 2, quatIndex, 4);
+        const __m256 z = _mm256_i32gather_ps(quat + 3, quatIndex, 4);
+
+        const __m256 norm2 = _mm256_fmadd_ps(w, w, _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z))));
+        const __m256 k = _mm256_and_ps(_mm256_div_ps(two, norm2), _mm256_cmp_ps(norm2, _mm256_setzero_ps(), _CMP_GT_OQ));
+        const __m256 kx = _mm256_mul_ps(k, x), ky = _mm256_mul_ps(k, y), kz = _mm256_mul_ps(k, z);
+        const __m256 xx = _mm256_mul_ps(kx, x), yy = _mm256_mul_ps(ky, y), zz = _mm256_mul_ps(kz, z);
+        const __m256 xy = _mm256_mul_ps(kx, y), xz = _mm256_mul_ps(kx, z), yz = _mm256_mul_ps(ky, z);
+        const __m256 wx = _mm256_mul_ps(kx, w), wy = _mm256_mul_ps(ky, w), wz = _mm256_mul_ps(kz, w);
+        const __m256 r[3][3] = {
+            { _mm256_sub_ps(one, _mm256_add_ps(yy, zz)), _mm256_sub_ps(xy, wz), _mm256_add_ps(xz, wy) },
+            { _mm256_add_ps(xy, wz), _mm256_sub_ps(one, _mm256_add_ps(xx, zz)), _mm256_sub_ps(yz, wx) },
+            { _mm256_sub_ps(xz, wy), _mm256_add_ps(yz, wx), _mm256_sub_ps(one, _mm256_add_ps(xx, yy)) },
+        };
+        __m256 s[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            s[axis] = exp256(_mm256_mul_ps(two, _mm256_i32gather_ps(logScale + axis, scaleIndex, 4)));
+        }
+
+        int index = 0;
+        for (int row = 0; row < 3; ++row) {
+            for (int column = row; column < 3; ++column) {
+                __m256 sum = _mm256_mul_ps(_mm256_mul_ps(r[row][0], r[column][0]), s[0]);
+                sum = _mm256_fmadd_ps(_mm256_mul_ps(r[row][1], r[column][1]), s[1], sum);
+                sum = _mm256_fmadd_ps(_mm256_mul_ps(r[row][2], r[column][2]), s[2], sum);
+                _mm256_store_ps(lanes[index++], sum);
+            }
+        }
+        for (int lane = 0; lane < 8; ++lane) {
+            for (int component = 0; component < 6; ++component) {
+                out[i - begin + lane][component] = lanes[component][lane];
+            }
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static __m512 exp512(__m512 x) {
+    __m512 t = _mm512_mul_ps(x, _mm512_set1_ps(1.44269504f));
+    t = _mm512_min_ps(_mm512_max_ps(t, _mm512_set1_ps(-126.0f)), _mm512_set1_ps(127.0f));
+    const __m512 n = _mm512_roundscale_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m512 f = _mm512_sub_ps(t, n);
+    __m512 p = _mm512_set1_ps(1.3333558e-3f);
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(9.6181291e-3f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(5.5504109e-2f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(2.4022651e-1f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(6.9314718e-1f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.0f));
+    return _mm512_scalef_ps(p, n);
+}
+
+// Sixteen splats per iteration, with gathers in and scatters out.
+__attribute__((target("avx512f")))
+static size_t computeCovariancesAvx512(const PackedGaussians& gaussians, size_t begin, size_t end, Covariance* out) {
+    const __m512i scaleIndex = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    const __m512i quatIndex = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60);
+    const __m512i outIndex = _mm512_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42, 48, 54, 60, 66, 72, 78, 84, 90);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        const float* quat = gaussians.rotQuats[i].data();
+        const float* logScale = gaussians.logScales[i].data();
+        const __m512 w = _mm512_i32gather_ps(quatIndex, quat, 4);
+        const __m512 x = _mm512_i32gather_ps(quatIndex, quat + 1, 4);
+        const __m512 y = _mm512_i32gather_ps(quatIndex, quat + 2, 4);
+        const __m512 z = _mm512_i32gather_ps(quatIndex, quat + 3, 4);
+
+        const __m512 norm2 = _mm512_fmadd_ps(w, w, _mm512_fmadd_ps(x, x, _mm512_fmadd_ps(y, y, _mm512_mul_ps(z, z))));
+        const __mmask16 nonZero = _mm512_cmp_ps_mask(norm2, _mm512_setzero_ps(), _CMP_GT_OQ);
+        const __m512 k = _mm512_maskz_div_ps(nonZero, two, norm2);
+        const __m512 kx = _mm512_mul_ps(k, x), ky = _mm512_mul_ps(k, y), kz = _mm512_mul_ps(k, z);
+        const __m512 xx = _mm512_mul_ps(kx, x), yy = _mm512_mul_ps(ky, y), zz = _mm512_mul_ps(kz, z);
+        const __m512 xy = _mm512_mul_ps(kx, y), xz = _mm512_mul_ps(kx, z), yz = _mm512_mul_ps(ky, z);
+        const __m512 wx = _mm512_mul_ps(kx, w), wy = _mm512_mul_ps(ky, w), wz = _mm512_mul_ps(kz, w);
+        const __m512 r[3][3] = {
+            { _mm512_sub_ps(one, _mm512_add_ps(yy, zz)), _mm512_sub_ps(xy, wz), _mm512_add_ps(xz, wy) },
+            { _mm512_add_ps(xy, wz), _mm512_sub_ps(one, _mm512_add_ps(xx, zz)), _mm512_sub_ps(yz, wx) },
+            { _mm512_sub_ps(xz, wy), _mm512_add_ps(yz, wx), _mm512_sub_ps(one, _mm512_add_ps(xx, yy)) },
+        };
+        __m512 s[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            s[axis] = exp512(_mm512_mul_ps(two, _mm512_i32gather_ps(scaleIndex, logScale + axis, 4)));
+        }
+
+        float* target = out[i - begin].data();
+        int index = 0;
+        for (int row = 0; row < 3; ++row) {
+            for (int column = row; column < 3; ++column) {
+                __m512 sum = _mm512_mul_ps(_mm512_mul_ps(r[row][0], r[column][0]), s[0]);
+                sum = _mm512_fmadd_ps(_mm512_mul_ps(r[row][1], r[column][1]), s[1], sum);
+                sum = _mm512_fmadd_ps(_mm512_mul_ps(r[row][2], r[column][2]), s[2], sum);
+                _mm512_i32scatter_ps(target + index++, outIndex, sum, 4);
+            }
+        }
+    }
+    return i;
+}
+
+#endif
+
+void computeCovariances(const PackedGaussians& gaussians, size_t begin, size_t end, Covariance* out, SimdLevel level) {
+    size_t done = begin;
+#if HAS_X86_SIMD
+    if (level == SimdLevel::Avx512) {
+        done = computeCovariancesAvx512(gaussians, begin, end, out);
+    }
+    else if (level == SimdLevel::Avx2) {
+        done = computeCovariancesAvx2(gaussians, begin, end, out);
+    }
+#endif
+    computeCovariancesScalar(gaussians, done, end, out + (done - begin));
+}
+
+CovarianceCache::CovarianceCache(const CovarianceOptions& options) : options(options) {}
+
+const std::vector<Covariance>& CovarianceCache::update(const PackedGaussians& gaussians) {
+    const size_t n = gaussians.numGaussians;
+    if (gaussians.logScales.data() != logScalesSource || gaussians.rotQuats.data() != rotQuatsSource || cache.size() != n) {
+        allDirty = true;
+    }
+    if (allDirty) {
+        dirtyRanges.assign(1, { 0, n });
+    }
+    cache.resize(n);
+
+    recomputed = 0;
+    for (const auto& [begin, end] : dirtyRanges) {
+        const size_t first = std::min(begin, n), last = std::min(end, n);
+        if (first >= last) {
+            continue;
+        }
+        parallelFor(last - first, options.nThreads, [&](int, size_t sliceBegin, size_t sliceEnd) {
+            computeCovariances(gaussians, first + sliceBegin, first + sliceEnd, cache.data() + first + sliceBegin, options.simdLevel);
+        });
+        recomputed += last - first;
+    }
+
+    logScalesSource = gaussians.logScales.data();
+    rotQuatsSource = gaussians.rotQuats.data();
+    allDirty = false;
+    dirtyRanges.clear();
+    return cache;
+}
+
+void CovarianceCache::invalidate() {
+    allDirty = true;
+}
+
+void CovarianceCache::invalidate(size_t begin, size_t end) {
+    if (begin < end) {
+        dirtyRanges.push_back({ begin, end });
+    }
+}
+
+const std::vector<Covariance>& CovarianceCache::covariances() const {
+    return cache;
+}
+
+size_t CovarianceCache::lastRecomputed() const {
+    return recomputed;
+}
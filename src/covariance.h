@@ -0,0 +1,53 @@
+#ifndef COVARIANCE_H
+#define COVARIANCE_H
+
+#include "ply.h"
+#include "simd.h"
+#include <vector>
+#include <array>
+#include <utility>
+#include <cstddef>
+
+// Upper triangle of the 3D covariance R * S * S^T * R^T of a splat, in the
+// order xx, xy, xz, yy, yz, zz.
+using Covariance = std::array<float, 6>;
+
+// Covariances of splats [begin, end) into out[0, end - begin). Rotations are
+// normalized first and a zero quaternion is treated as the identity, as in
+// quaternionToMatrix. The SIMD paths use a polynomial exp, so they differ
+// from the scalar path by a few ulps.
+void computeCovariances(const PackedGaussians& gaussians, size_t begin, size_t end, Covariance* out, SimdLevel level = detectSimdLevel());
+
+struct CovarianceOptions {
+    int nThreads = 0;
+    SimdLevel simdLevel = detectSimdLevel();
+};
+
+// Per-splat covariances kept across calls. update() recomputes everything
+// when the logScales or rotQuats columns of the scene were reallocated or
+// resized since the previous call, and otherwise only the ranges passed to
+// invalidate(). Edits made in place must be reported through invalidate().
+class CovarianceCache {
+public:
+    explicit CovarianceCache(const CovarianceOptions& options = {});
+
+    const std::vector<Covariance>& update(const PackedGaussians& gaussians);
+
+    void invalidate();
+    void invalidate(size_t begin, size_t end);
+
+    const std::vector<Covariance>& covariances() const;
+    // Number of splats recomputed by the last update().
+    size_t lastRecomputed() const;
+
+private:
+    CovarianceOptions options;
+    std::vector<Covariance> cache;
+    const void* logScalesSource = nullptr;
+    const void* rotQuatsSource = nullptr;
+    bool allDirty = true;
+    std::vector<std::pair<size_t, size_t>> dirtyRanges;
+    size_t recomputed = 0;
+};
+
+#endif // COVARIANCE_H
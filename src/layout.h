@@ -0,0 +1,266 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <array>
+#include <tuple>
+#include <span>
+#include <string_view>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Compile-time counterparts of the runtime PackingType classes in packing.h.
+// A layout is declared as a type, e.g.
+//
+//     using Record = layout::Std140Struct<layout::Field<"pos", layout::vec3<layout::f32>>,
+//                                         layout::Field<"opacity", layout::f32>>;
+//
+// and its offsets, size and alignment are constants that follow the same
+// rules as Struct, StaticArray, VectorType and MatrixType, so both produce
+// identical bytes. pack/unpack copy each scalar with a fixed offset.
+namespace layout {
+
+constexpr int alignUp(int n, int multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+template <size_t N>
+struct FixedString {
+    char value[N];
+
+    constexpr FixedString(const char (&text)[N]) {
+        std::copy_n(text, N, value);
+    }
+
+    constexpr std::string_view view() const {
+        return { value, N - 1 };
+    }
+};
+
+template <typename T>
+struct Scalar {
+    using value_type = T;
+    static constexpr int size = 4;
+    static constexpr int alignment = 4;
+
+    static void pack(const value_type& value, uint8_t* destination) {
+        std::memcpy(destination, &value, sizeof(T));
+    }
+
+    static value_type unpack(const uint8_t* source) {
+        value_type value;
+        std::memcpy(&value, source, sizeof(T));
+        return value;
+    }
+};
+
+using i32 = Scalar<int32_t>;
+using u32 = Scalar<uint32_t>;
+using f32 = Scalar<float>;
+
+template <typename T, int N, int Alignment>
+struct Vector {
+    using value_type = std::array<typename T::value_type, N>;
+    static constexpr int size = T::size * N;
+    static constexpr int alignment = Alignment;
+
+    static void pack(const value_type& value, uint8_t* destination) {
+        for (int i = 0; i < N; ++i) {
+            T::pack(value[i], destination + i * T::size);
+        }
+    }
+
+    static value_type unpack(const uint8_t* source) {
+        value_type value;
+        for (int i = 0; i < N; ++i) {
+            value[i] = T::unpack(source + i * T::size);
+        }
+        return value;
+    }
+};
+
+template <typename T> using vec2 = Vector<T, 2, 8>;
+template <typename T> using vec3 = Vector<T, 3, 16>;
+template <typename T> using vec4 = Vector<T, 4, 16>;
+
+template <typename T, int N>
+struct StaticArray {
+    using value_type = std::array<typename T::value_type, N>;
+    static constexpr int stride = alignUp(T::size, T::alignment);
+    static constexpr int size = stride * N;
+    static constexpr int alignment = T::alignment;
+
+    static void pack(const value_type& value, uint8_t* destination) {
+        for (int i = 0; i < N; ++i) {
+            T::pack(value[i], destination + i * stride);
+        }
+    }
+
+    static value_type unpack(const uint8_t* source) {
+        value_type value;
+        for (int i = 0; i < N; ++i) {
+            value[i] = T::unpack(source + i * stride);
+        }
+        return value;
+    }
+};
+
+// Column-major matrix. Size and alignment are those of an array of column
+// vectors, and the columns are written back to back like MatrixType::pack does.
+template <typename T, int Rows, int Columns>
+struct Matrix {
+    static_assert(Rows >= 2 && Rows <= 4, "Invalid number of rows");
+    using value_type = std::array<std::array<typename T::value_type, Rows>, Columns>;
+    static constexpr int alignment = Rows == 2 ? 8 : 16;
+    static constexpr int size = Columns * alignUp(T::size * Rows, alignment);
+
+    static void pack(const value_type& value, uint8_t* destination) {
+        for (int i = 0; i < Columns; ++i) {
+            for (int j = 0; j < Rows; ++j) {
+                T::pack(value[i][j], destination + (i * Rows + j) * T::size);
+            }
+        }
+    }
+
+    static value_type unpack(const uint8_t* source) {
+        value_type value;
+        for (int i = 0; i < Columns; ++i) {
+            for (int j = 0; j < Rows; ++j) {
+                value[i][j] = T::unpack(source + (i * Rows + j) * T::size);
+            }
+        }
+        return value;
+    }
+};
+
+template <typename T> using mat4x4 = Matrix<T, 4, 4>;
+
+template <FixedString Name, typename T>
+struct Field {
+    static constexpr std::string_view name = Name.view();
+    using type = T;
+};
+
+template <typename... Fields>
+struct Std140Struct {
+    static_assert(sizeof...(Fields) > 0, "A struct needs at least one field");
+
+    static constexpr size_t nFields = sizeof...(Fields);
+    using value_type = std::tuple<typename Fields::type::value_type...>;
+
+    template <size_t I>
+    using field_type = typename std::tuple_element_t<I, std::tuple<Fields...>>::type;
+
+    static constexpr std::array<std::string_view, nFields> names = { Fields::name... };
+    static constexpr int alignment = std::max({ Fields::type::alignment... });
+
+private:
+    static constexpr std::array<int, nFields> computeOffsets() {
+        constexpr int sizes[] = { Fields::type::size... };
+        constexpr int alignments[] = { Fields::type::alignment... };
+        std::array<int, nFields> result{};
+        int offset = 0;
+        for (size_t i = 0; i < nFields; ++i) {
+            offset = alignUp(offset, alignments[i]);
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }
+
+    template <size_t... I>
+    static void packFields(const value_type& value, uint8_t* destination, std::index_sequence<I...>) {
+        (field_type<I>::pack(std::get<I>(value), destination + offsets[I]), ...);
+    }
+
+    template <size_t... I>
+    static value_type unpackFields(const uint8_t* source, std::index_sequence<I...>) {
+        return { field_type<I>::unpack(source + offsets[I])... };
+    }
+
+public:
+    static constexpr std::array<int, nFields> offsets = computeOffsets();
+    static constexpr int size = alignUp(offsets[nFields - 1] + field_type<nFields - 1>::size, alignment);
+
+    template <FixedString Name>
+    static constexpr size_t indexOf() {
+        for (size_t i = 0; i < nFields; ++i) {
+            if (names[i] == Name.view()) {
+                return i;
+            }
+        }
+        return nFields;
+    }
+
+    template <FixedString Name>
+    static constexpr int offsetOf() {
+        constexpr size_t index = indexOf<Name>();
+        static_assert(index < nFields, "No field with this name");
+        return offsets[index];
+    }
+
+    template <FixedString Name>
+    static auto& get(value_type& value) {
+        return std::get<indexOf<Name>()>(value);
+    }
+
+    template <FixedString Name>
+    static const auto& get(const value_type& value) {
+        return std::get<indexOf<Name>()>(value);
+    }
+
+    static void pack(const value_type& value, uint8_t* destination) {
+        packFields(value, destination, std::index_sequence_for<Fields...>{});
+    }
+
+    static value_type unpack(const uint8_t* source) {
+        return unpackFields(source, std::index_sequence_for<Fields...>{});
+    }
+};
+
+// Array-of-records packing with the stride a StaticArray of T would use.
+template <typename T>
+constexpr int arrayStride() {
+    return alignUp(T::size, T::alignment);
+}
+
+template <typename T>
+void packArray(std::span<const typename T::value_type> values, std::span<uint8_t> buffer) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        T::pack(values[i], buffer.data() + i * arrayStride<T>());
+    }
+}
+
+template <typename T>
+void unpackArray(std::span<const uint8_t> buffer, std::span<typename T::value_type> values) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = T::unpack(buffer.data() + i * arrayStride<T>());
+    }
+}
+
+using SplatRecord = Std140Struct<
+    Field<"position", vec3<f32>>,
+    Field<"logScale", vec3<f32>>,
+    Field<"rotQuat", vec4<f32>>,
+    Field<"opacityLogit", f32>>;
+
+static_assert(SplatRecord::offsetOf<"logScale">() == 16);
+static_assert(SplatRecord::offsetOf<"opacityLogit">() == 48);
+static_assert(SplatRecord::size == 64 && SplatRecord::alignment == 16);
+
+using CameraUniform = Std140Struct<
+    Field<"view", mat4x4<f32>>,
+    Field<"projection", mat4x4<f32>>,
+    Field<"position", vec3<f32>>,
+    Field<"viewport", vec2<f32>>,
+    Field<"focal", vec2<f32>>>;
+
+static_assert(CameraUniform::offsetOf<"position">() == 128);
+static_assert(CameraUniform::offsetOf<"viewport">() == 144);
+static_assert(CameraUniform::size == 160);
+
+}
+
+#endif // LAYOUT_H
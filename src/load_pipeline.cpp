@@ -0,0 +1,327 @@
+#include "load_pipeline.h"
+#include "scene_buffer.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+
+PipelinedLoad::PipelinedLoad(const std::string& filePath, const PipelineOptions& options)
+    : filePath(filePath), options(options), freeChunks(options.chunkBuffers), decodeQueue(options.chunkBuffers), packQueue(options.chunkBuffers) {
+    if (options.chunkVertices <= 0 || options.chunkBuffers <= 0) {
+        throw std::invalid_argument("chunkVertices and chunkBuffers must be positive");
+    }
+}
+
+void PipelinedLoad::cancel() {
+    ++activeSteps;
+    stopped = true;
+    leave();
+}
+
+bool PipelinedLoad::finished() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state != State::Running;
+}
+
+LoadedScene PipelinedLoad::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return state != State::Running; });
+    switch (state) {
+    case State::Completed: return std::move(result);
+    case State::Failed: std::rethrow_exception(error);
+    default: throw LoadCancelled("Load of " + filePath + " was cancelled");
+    }
+}
+
+size_t PipelinedLoad::total() const {
+    return vertexCount;
+}
+
+size_t PipelinedLoad::decoded() const {
+    return decodedCount;
+}
+
+size_t PipelinedLoad::packed() const {
+    return packedCount;
+}
+
+bool PipelinedLoad::step() {
+    ++activeSteps;
+    bool worked = false;
+    if (!stopped) {
+        try {
+            worked = readChunk() || packChunk() || decodeChunk();
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            stopped = true;
+        }
+    }
+    leave();
+    return worked;
+}
+
+// The last step to leave a stopped load finishes it, so no worker is still
+// writing into the result when wait() returns.
+void PipelinedLoad::leave() {
+    if (--activeSteps == 0 && stopped) {
+        bool failed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = error != nullptr;
+        }
+        finish(failed ? State::Failed : State::Cancelled);
+    }
+}
+
+void PipelinedLoad::finish(State finalState) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state != State::Running) {
+            return;
+        }
+        state = finalState;
+        // Nothing is handed out after a failure, so release the memory now.
+        if (finalState != State::Completed) {
+            result = LoadedScene();
+        }
+        chunks.clear();
+        file.close();
+    }
+    done.notify_all();
+}
+
+void PipelinedLoad::open() {
+    ScopedTimer timer("pipelineOpen");
+    file.open(filePath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Failed to load file");
+    }
+    const size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    // Read a prefix that grows until it holds the whole header and the
+    // elements stored before the vertices, up to 64 MiB.
+    std::vector<uint8_t> prefix;
+    size_t dataOffset;
+    for (size_t prefixSize = 1 << 16;; prefixSize *= 4) {
+        prefix.resize(std::min(prefixSize, fileSize));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(prefix.data()), static_cast<std::streamsize>(prefix.size()))) {
+            throw std::runtime_error("Failed to read " + filePath);
+        }
+        try {
+            header = PackedGaussians::decodeHeader(prefix, options.maxShDegree);
+            dataOffset = header.vertexData.data() - prefix.data();
+            header.vertexData = {};
+            break;
+        }
+        catch (const std::runtime_error&) {
+            if (prefix.size() == fileSize || prefixSize >= (1 << 26)) {
+                throw;
+            }
+        }
+    }
+
+    auto& gaussians = result.gaussians;
+    if (header.format == PlyFormat::Ascii) {
+        // Text lines have no fixed size to cut chunks at.
+        LoadOptions asciiOptions;
+        asciiOptions.maxShDegree = options.maxShDegree;
+        prefix = loadFileAsArrayBuffer(filePath);
+        gaussians = PackedGaussians(prefix, asciiOptions);
+    }
+    else {
+        if (fileSize - dataOffset < static_cast<size_t>(header.vertexCount) * header.layout.stride) {
+            throw std::runtime_error("Vertex data is shorter than the header declares");
+        }
+        file.seekg(static_cast<std::streamoff>(dataOffset));
+        gaussians.numGaussians = header.vertexCount;
+        gaussians.sphericalHarmonicsDegree = header.layout.sphericalHarmonicsDegree;
+        gaussians.shLayout = ShLayout::Interleaved;
+        gaussians.positions.resize(header.vertexCount);
+        gaussians.logScales.resize(header.vertexCount);
+        gaussians.rotQuats.resize(header.vertexCount);
+        gaussians.opacityLogits.resize(header.vertexCount);
+        gaussians.shCoeffs.resize(static_cast<size_t>(header.vertexCount) * gaussians.nShCoeffs() * 3);
+    }
+
+    if (options.recordType) {
+        result.plan = compilePackingPlan(*options.recordType);
+        planFields = bindVertexFields(result.plan, options.fields, gaussians);
+        fieldColumns = vertexFieldColumns(gaussians, planFields);
+        result.packed.assign(static_cast<size_t>(gaussians.numGaussians) * result.plan.stride, 0);
+    }
+    vertexCount = gaussians.numGaussians;
+    timer.addBytes(dataOffset);
+
+    if (header.format == PlyFormat::Ascii) {
+        nextRead = gaussians.numGaussians;
+        decodedCount = gaussians.numGaussians;
+        if (options.recordType) {
+            packRecords(result.plan, result.plan.entries, fieldColumns, 0, gaussians.numGaussians, result.packed);
+            packedCount = gaussians.numGaussians;
+        }
+        chunkDone(gaussians.numGaussians);
+        return;
+    }
+
+    const size_t nChunks = std::min<size_t>(options.chunkBuffers, (header.vertexCount + options.chunkVertices - 1) / options.chunkVertices);
+    chunks.resize(nChunks);
+    for (auto& chunk : chunks) {
+        chunk.bytes.resize(static_cast<size_t>(options.chunkVertices) * header.layout.stride);
+        freeChunks.tryPush(&chunk);
+    }
+    if (header.vertexCount == 0) {
+        chunkDone(0);
+    }
+}
+
+bool PipelinedLoad::readChunk() {
+    if (reading.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+    struct Release {
+        std::atomic<bool>& flag;
+        ~Release() { flag.store(false, std::memory_order_release); }
+    } release{ reading };
+
+    if (!opened) {
+        opened = true;
+        open();
+        return true;
+    }
+    Chunk* chunk;
+    if (nextRead >= header.vertexCount || !freeChunks.tryPop(chunk)) {
+        return false;
+    }
+
+    ScopedTimer timer("pipelineRead");
+    chunk->begin = nextRead;
+    chunk->end = std::min(nextRead + options.chunkVertices, header.vertexCount);
+    const size_t bytes = static_cast<size_t>(chunk->end - chunk->begin) * header.layout.stride;
+    if (!file.read(reinterpret_cast<char*>(chunk->bytes.data()), static_cast<std::streamsize>(bytes))) {
+        throw std::runtime_error("Failed to read " + filePath);
+    }
+    timer.addBytes(bytes);
+    nextRead = chunk->end;
+    decodeQueue.tryPush(chunk);
+    return true;
+}
+
+bool PipelinedLoad::decodeChunk() {
+    Chunk* chunk;
+    if (!decodeQueue.tryPop(chunk)) {
+        return false;
+    }
+    const size_t count = chunk->end - chunk->begin;
+    result.gaussians.decodeVertexBlock(header.layout, std::span<const uint8_t>(chunk->bytes.data(), count * header.layout.stride), chunk->begin);
+    const size_t finishedCount = decodedCount += count;
+    // Every queue has room for all chunkBuffers chunks, so pushes never fail.
+    if (options.recordType) {
+        packQueue.tryPush(chunk);
+        return true;
+    }
+    freeChunks.tryPush(chunk);
+    chunkDone(finishedCount);
+    return true;
+}
+
+bool PipelinedLoad::packChunk() {
+    Chunk* chunk;
+    if (!packQueue.tryPop(chunk)) {
+        return false;
+    }
+    ScopedTimer timer("pipelinePack");
+    const size_t count = chunk->end - chunk->begin;
+    packRecords(result.plan, result.plan.entries, fieldColumns, chunk->begin, chunk->end, result.packed);
+    timer.addBytes(count * result.plan.stride);
+    const size_t finishedCount = packedCount += count;
+    freeChunks.tryPush(chunk);
+    chunkDone(finishedCount);
+    return true;
+}
+
+// Called with the number of splats through the last stage, including the
+// chunk just finished. Exactly one call sees the full count.
+void PipelinedLoad::chunkDone(size_t finishedCount) {
+    if (finishedCount == vertexCount && !stopped) {
+        if (options.shLayout != ShLayout::Interleaved) {
+            result.gaussians.setShLayout(options.shLayout);
+        }
+        finish(State::Completed);
+    }
+}
+
+LoadPool::LoadPool(int nThreads) {
+    const int nWorkers = resolveThreadCount(nThreads);
+    for (int worker = 0; worker < nWorkers; ++worker) {
+        workers.emplace_back(&LoadPool::workerLoop, this);
+    }
+}
+
+LoadPool::~LoadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto& load : loads) {
+            load->cancel();
+        }
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<PipelinedLoad> LoadPool::load(const std::string& filePath, const PipelineOptions& options) {
+    std::shared_ptr<PipelinedLoad> load(new PipelinedLoad(filePath, options));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.push_back(load);
+        ++handOffs;
+    }
+    wake.notify_all();
+    return load;
+}
+
+void LoadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t idleSteps = 0;
+    uint64_t sweepStart = handOffs;
+    while (!stopping) {
+        // A load that failed or was cancelled leaves without handing work on,
+        // so removing it restarts the sweeps that had counted it as idle.
+        if (std::erase_if(loads, [](const auto& load) { return load->finished(); }) > 0) {
+            ++handOffs;
+        }
+        if (idleSteps == 0) {
+            sweepStart = handOffs;
+        }
+        if (loads.empty() || idleSteps >= loads.size()) {
+            // No load had work for this worker: every chunk is with another
+            // worker. Any work handed on since the sweep started bumped
+            // handOffs, so none can be missed while waiting.
+            wake.wait(lock, [&] { return stopping || handOffs != sweepStart; });
+            idleSteps = 0;
+            continue;
+        }
+
+        const auto load = loads[cursor++ % loads.size()];
+        lock.unlock();
+        const bool worked = load->step();
+        lock.lock();
+        if (worked) {
+            ++handOffs;
+            idleSteps = 0;
+            wake.notify_all();
+        }
+        else {
+            ++idleSteps;
+        }
+    }
+}
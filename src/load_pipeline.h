@@ -0,0 +1,151 @@
+#ifndef LOAD_PIPELINE_H
+#define LOAD_PIPELINE_H
+
+#include "ply.h"
+#include "packing.h"
+#include "bounded_queue.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+
+struct PipelineOptions {
+    int maxShDegree = 3;
+    ShLayout shLayout = ShLayout::Interleaved;
+    // Vertices read, decoded and packed as one chunk.
+    int chunkVertices = 1 << 14;
+    // Chunk buffers of every load. They circulate from the read stage to the
+    // decode and pack stages and back, so they bound the memory of a load and
+    // hold the read stage back when the later stages fall behind.
+    int chunkBuffers = 8;
+    // Record layout the decoded splats are packed into, which must outlive
+    // the load, and the splat column of every field. Without a record type
+    // the pack stage is skipped.
+    const PackingType* recordType = nullptr;
+    std::unordered_map<std::string, VertexField> fields;
+};
+
+struct LoadedScene {
+    PackedGaussians gaussians;
+    PackingPlan plan;
+    // One record per splat when a record type was given, empty otherwise.
+    std::vector<uint8_t> packed;
+};
+
+class LoadCancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+class LoadPool;
+
+// One load running on a LoadPool. The file is read chunk by chunk; decoded
+// chunks are written straight into the scene's columns and packed records
+// into the output buffer, so chunks can finish in any order.
+class PipelinedLoad {
+public:
+    // Stops the load at the next chunk boundary. wait() then throws LoadCancelled.
+    void cancel();
+    bool finished() const;
+
+    // Blocks until the load has finished and hands over its result. Throws
+    // LoadCancelled, or the error that stopped the load. Call it only once.
+    LoadedScene wait();
+
+    // Vertex count from the header, 0 until the header has been read.
+    size_t total() const;
+    size_t decoded() const;
+    size_t packed() const;
+
+private:
+    friend class LoadPool;
+
+    struct Chunk {
+        std::vector<uint8_t> bytes;
+        int begin;
+        int end;
+    };
+
+    enum class State { Running, Completed, Cancelled, Failed };
+
+    std::string filePath;
+    PipelineOptions options;
+    LoadedScene result;
+    std::ifstream file;
+    PlyHeader header;
+    std::vector<VertexField> planFields;
+    std::vector<PackingColumn> fieldColumns;
+
+    std::vector<Chunk> chunks;
+    BoundedQueue<Chunk*> freeChunks;
+    BoundedQueue<Chunk*> decodeQueue;
+    BoundedQueue<Chunk*> packQueue;
+
+    // Held by the worker that runs the read stage, which is sequential.
+    std::atomic<bool> reading{ false };
+    bool opened = false;
+    int nextRead = 0;
+
+    std::atomic<size_t> vertexCount{ 0 };
+    std::atomic<size_t> decodedCount{ 0 };
+    std::atomic<size_t> packedCount{ 0 };
+    std::atomic<int> activeSteps{ 0 };
+    std::atomic<bool> stopped{ false };
+
+    mutable std::mutex mutex;
+    std::condition_variable done;
+    State state = State::Running;
+    std::exception_ptr error;
+
+    PipelinedLoad(const std::string& filePath, const PipelineOptions& options);
+
+    // Runs one unit of work of some stage. Returns false when no stage had work.
+    bool step();
+    bool readChunk();
+    bool decodeChunk();
+    bool packChunk();
+    void open();
+    void chunkDone(size_t finishedCount);
+    void leave();
+    void finish(State finalState);
+};
+
+// Worker threads shared by any number of loads. Each worker takes the loads in
+// turn and runs one step of the next one, so concurrent loads progress side by
+// side. Within a load, steps prefer the read stage, then packing, then
+// decoding, which keeps the file streaming while chunks drain.
+class LoadPool {
+public:
+    explicit LoadPool(int nThreads = 0);
+    // Cancels the loads that are still running.
+    ~LoadPool();
+
+    LoadPool(const LoadPool&) = delete;
+    LoadPool& operator=(const LoadPool&) = delete;
+
+    // Starts loading a binary or ASCII PLY. ASCII files are read and decoded as one chunk.
+    std::shared_ptr<PipelinedLoad> load(const std::string& filePath, const PipelineOptions& options = {});
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::shared_ptr<PipelinedLoad>> loads;
+    size_t cursor = 0;
+    // Counts steps that did work, which hands chunks to the next stage, and
+    // added or removed loads. A worker that found no work sleeps until it changes.
+    uint64_t handOffs = 0;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+#endif // LOAD_PIPELINE_H
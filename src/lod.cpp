@@ -0,0 +1,520 @@
+#include "lod.h"
+#include "binary_io.h"
+#include "covariance.h"
+#include "parallel.h"
+#include "sorting.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+static float maxLogScale(const std::array<float, 3>& logScale) {
+    return std::max({ logScale[0], logScale[1], logScale[2] });
+}
+
+// Eigenvalues and eigenvectors (columns of `vectors`) of a symmetric 3x3
+// matrix by cyclic Jacobi rotations.
+static void symmetricEigen(double a[3][3], double values[3], double vectors[3][3]) {
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            vectors[row][column] = row == column ? 1.0 : 0.0;
+        }
+    }
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        const double offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        const double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (offDiagonal <= 1e-30 * diagonal || offDiagonal == 0.0) {
+            break;
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[p][q] == 0.0) {
+                    continue;
+                }
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (int k = 0; k < 3; ++k) {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    const double vkp = vectors[k][p], vkq = vectors[k][q];
+                    vectors[k][p] = c * vkp - s * vkq;
+                    vectors[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        values[k] = a[k][k];
+    }
+}
+
+// (w, x, y, z) quaternion of a row-major rotation matrix, the inverse of quaternionToMatrix.
+static std::array<float, 4> matrixToQuaternion(const double r[3][3]) {
+    double w, x, y, z;
+    const double trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0) {
+        const double s = 2.0 * std::sqrt(trace + 1.0);
+        w = 0.25 * s;
+        x = (r[2][1] - r[1][2]) / s;
+        y = (r[0][2] - r[2][0]) / s;
+        z = (r[1][0] - r[0][1]) / s;
+    }
+    else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        const double s = 2.0 * std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]);
+        w = (r[2][1] - r[1][2]) / s;
+        x = 0.25 * s;
+        y = (r[0][1] + r[1][0]) / s;
+        z = (r[0][2] + r[2][0]) / s;
+    }
+    else if (r[1][1] > r[2][2]) {
+        const double s = 2.0 * std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]);
+        w = (r[0][2] - r[2][0]) / s;
+        x = (r[0][1] + r[1][0]) / s;
+        y = 0.25 * s;
+        z = (r[1][2] + r[2][1]) / s;
+    }
+    else {
+        const double s = 2.0 * std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]);
+        w = (r[1][0] - r[0][1]) / s;
+        x = (r[0][2] + r[2][0]) / s;
+        y = (r[1][2] + r[2][1]) / s;
+        z = 0.25 * s;
+    }
+    return { static_cast<float>(w), static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
+}
+
+LodHierarchy::LodHierarchy() : sourceCount(0) {}
+
+LodHierarchy::LodHierarchy(const PackedGaussians& gaussians, const LodOptions& options) : sourceCount(gaussians.numGaussians) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    const size_t n = gaussians.numGaussians;
+    const int nThreads = options.nThreads;
+    const int nSlices = parallelSlices(n, nThreads);
+
+    // Prune, then number the survivors of every slice after those of the previous slices.
+    const float pixelsPerRadius = 3.0f * options.referenceFocal / options.referenceDistance;
+    auto keep = [&](size_t i) {
+        const float opacity = 1.0f / (1.0f + std::exp(-gaussians.opacityLogits[i]));
+        return opacity >= options.minOpacity && pixelsPerRadius * std::exp(maxLogScale(gaussians.logScales[i])) >= options.minPixelRadius;
+    };
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<size_t> sliceCounts(nSlices, 0);
+    std::vector<std::array<float, 6>> sliceBounds(nSlices, { inf, inf, inf, -inf, -inf, -inf });
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        auto& bounds = sliceBounds[slice];
+        for (size_t i = begin; i < end; ++i) {
+            if (keep(i)) {
+                sliceCounts[slice]++;
+                for (int axis = 0; axis < 3; ++axis) {
+                    bounds[axis] = std::min(bounds[axis], gaussians.positions[i][axis]);
+                    bounds[axis + 3] = std::max(bounds[axis + 3], gaussians.positions[i][axis]);
+                }
+            }
+        }
+    });
+    std::array<float, 6> bounds = { inf, inf, inf, -inf, -inf, -inf };
+    std::vector<size_t> sliceOffsets(nSlices + 1, 0);
+    for (int slice = 0; slice < nSlices; ++slice) {
+        sliceOffsets[slice + 1] = sliceOffsets[slice] + sliceCounts[slice];
+        for (int axis = 0; axis < 3; ++axis) {
+            bounds[axis] = std::min(bounds[axis], sliceBounds[slice][axis]);
+            bounds[axis + 3] = std::max(bounds[axis + 3], sliceBounds[slice][axis + 3]);
+        }
+    }
+    const size_t nLeaves = sliceOffsets[nSlices];
+
+    const std::array<float, 3> origin = { bounds[0], bounds[1], bounds[2] };
+    std::array<float, 3> cellScale;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = bounds[axis + 3] - bounds[axis];
+        cellScale[axis] = extent > 0.0f ? 2097151.0f / extent : 0.0f;
+    }
+    std::vector<uint64_t> codes(nLeaves);
+    leafSources.resize(nLeaves);
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        size_t position = sliceOffsets[slice];
+        for (size_t i = begin; i < end; ++i) {
+            if (!keep(i)) {
+                continue;
+            }
+            codes[position] = mortonCode63(gaussians.positions[i], origin, cellScale);
+            leafSources[position++] = static_cast<uint32_t>(i);
+        }
+    });
+    {
+        std::vector<uint64_t> scratchCodes;
+        std::vector<uint32_t> scratchSources;
+        radixSortPairs<uint64_t>(codes, leafSources, scratchCodes, scratchSources, 63, nThreads);
+    }
+
+    radii.resize(nLeaves);
+    parallelFor(nLeaves, nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            radii[i] = 3.0f * std::exp(maxLogScale(gaussians.logScales[leafSources[i]]));
+        }
+    });
+    levelOffsets = { 0, nLeaves };
+    levelStats.push_back({ nLeaves, std::chrono::duration<double, std::milli>(Clock::now() - start).count() });
+
+    nodes.numGaussians = 0;
+    nodes.sphericalHarmonicsDegree = gaussians.sphericalHarmonicsDegree;
+    nodes.shLayout = ShLayout::Interleaved;
+    const int nShValues = gaussians.nShCoeffs() * 3;
+
+    int shift = 0;
+    size_t count = nLeaves;
+    while (count > 1 && levelCount() < options.maxLevels) {
+        start = Clock::now();
+
+        // Coarsen the octree cell until the level shrinks enough.
+        std::vector<uint32_t> groupStarts;
+        for (;; shift = std::min(shift + 3, 63)) {
+            groupStarts.assign(1, 0);
+            for (size_t i = 1; i < count; ++i) {
+                if ((codes[i] >> shift) != (codes[i - 1] >> shift)) {
+                    groupStarts.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            if (groupStarts.size() * std::max(options.branching, 1) <= count || shift == 63) {
+                break;
+            }
+        }
+        groupStarts.push_back(static_cast<uint32_t>(count));
+        const size_t nGroups = groupStarts.size() - 1;
+
+        const size_t childBase = levelOffsets[levelOffsets.size() - 2];
+        const size_t interiorBase = nodes.numGaussians;
+        const size_t total = interiorBase + nGroups;
+        nodes.numGaussians = static_cast<int>(total);
+        nodes.positions.resize(total);
+        nodes.logScales.resize(total);
+        nodes.rotQuats.resize(total);
+        nodes.opacityLogits.resize(total);
+        nodes.shCoeffs.resize(total * nShValues);
+        firstChild.resize(total);
+        childCount.resize(total);
+        radii.resize(nLeaves + total);
+
+        parallelFor(nGroups, nThreads, [&](int, size_t begin, size_t end) {
+            std::vector<double> sh(nShValues);
+            std::vector<double> uniformSh(nShValues);
+            for (size_t group = begin; group < end; ++group) {
+                const size_t firstNode = childBase + groupStarts[group];
+                const size_t lastNode = childBase + groupStarts[group + 1];
+                auto source = [&](size_t node) -> std::pair<const PackedGaussians&, size_t> {
+                    if (node < nLeaves) {
+                        return { gaussians, leafSources[node] };
+                    }
+                    return { nodes, node - nLeaves };
+                };
+
+                // One pass over the children: weighted moments about the first
+                // child's center, which keeps the covariance free of cancellation.
+                const auto& origin = source(firstNode).first.positions[source(firstNode).second];
+                double totalWeight = 0.0;
+                double uniformWeight = 0.0;
+                double offset[3] = { 0.0, 0.0, 0.0 };
+                double moments[6] = {};
+                double uniformOffset[3] = { 0.0, 0.0, 0.0 };
+                double uniformMoments[6] = {};
+                std::fill(sh.begin(), sh.end(), 0.0);
+                std::fill(uniformSh.begin(), uniformSh.end(), 0.0);
+                for (size_t node = firstNode; node < lastNode; ++node) {
+                    // Leaves are scattered over the source scene; fetch a few ahead.
+                    if (node + 8 < nLeaves) {
+                        const uint32_t ahead = leafSources[node + 8];
+                        __builtin_prefetch(&gaussians.positions[ahead]);
+                        __builtin_prefetch(&gaussians.logScales[ahead]);
+                        __builtin_prefetch(&gaussians.rotQuats[ahead]);
+                        __builtin_prefetch(&gaussians.opacityLogits[ahead]);
+                        __builtin_prefetch(&gaussians.shCoeffs[gaussians.shIndex(ahead, 0, 0)]);
+                    }
+                    auto [scene, i] = source(node);
+                    const auto& logScale = scene.logScales[i];
+                    const float area = std::exp(logScale[0] + logScale[1] + logScale[2] - std::min({ logScale[0], logScale[1], logScale[2] }));
+                    const double w = static_cast<double>(area) / (1.0 + std::exp(-static_cast<double>(scene.opacityLogits[i])));
+
+                    Covariance child;
+                    computeCovariances(scene, i, i + 1, &child, SimdLevel::Scalar);
+                    const double d[3] = { scene.positions[i][0] - origin[0], scene.positions[i][1] - origin[1], scene.positions[i][2] - origin[2] };
+                    const double second[6] = { child[0] + d[0] * d[0], child[1] + d[0] * d[1], child[2] + d[0] * d[2], child[3] + d[1] * d[1], child[4] + d[1] * d[2], child[5] + d[2] * d[2] };
+                    const float* coefficients = scene.shCoeffs.data() + scene.shIndex(static_cast<int>(i), 0, 0);
+                    const size_t step = scene.shLayout == ShLayout::Planar ? scene.numGaussians : 1;
+
+                    totalWeight += w;
+                    uniformWeight += 1.0;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        offset[axis] += w * d[axis];
+                        uniformOffset[axis] += d[axis];
+                    }
+                    for (int k = 0; k < 6; ++k) {
+                        moments[k] += w * second[k];
+                        uniformMoments[k] += second[k];
+                    }
+                    for (int k = 0; k < nShValues; ++k) {
+                        sh[k] += w * coefficients[k * step];
+                        uniformSh[k] += coefficients[k * step];
+                    }
+                }
+                // Fully transparent groups fall back to equal weights.
+                const bool uniform = !(totalWeight > 0.0);
+                if (uniform) {
+                    totalWeight = uniformWeight;
+                    std::copy_n(uniformOffset, 3, offset);
+                    std::copy_n(uniformMoments, 6, moments);
+                    sh.swap(uniformSh);
+                }
+
+                double mean[3];
+                for (int axis = 0; axis < 3; ++axis) {
+                    offset[axis] /= totalWeight;
+                    mean[axis] = origin[axis] + offset[axis];
+                }
+                for (int k = 0; k < nShValues; ++k) {
+                    sh[k] /= totalWeight;
+                }
+                double covariance[3][3];
+                int index = 0;
+                for (int row = 0; row < 3; ++row) {
+                    for (int column = row; column < 3; ++column) {
+                        covariance[row][column] = covariance[column][row] = moments[index++] / totalWeight - offset[row] * offset[column];
+                    }
+                }
+
+                double variances[3];
+                double axes[3][3];
+                symmetricEigen(covariance, variances, axes);
+                const double determinant = axes[0][0] * (axes[1][1] * axes[2][2] - axes[1][2] * axes[2][1]) - axes[0][1] * (axes[1][0] * axes[2][2] - axes[1][2] * axes[2][0]) + axes[0][2] * (axes[1][0] * axes[2][1] - axes[1][1] * axes[2][0]);
+                if (determinant < 0.0) {
+                    for (int row = 0; row < 3; ++row) {
+                        axes[row][2] = -axes[row][2];
+                    }
+                }
+                double deviations[3];
+                for (int k = 0; k < 3; ++k) {
+                    deviations[k] = std::sqrt(std::max(variances[k], 1e-24));
+                }
+
+                const size_t j = interiorBase + group;
+                nodes.positions[j] = { static_cast<float>(mean[0]), static_cast<float>(mean[1]), static_cast<float>(mean[2]) };
+                nodes.logScales[j] = { static_cast<float>(std::log(deviations[0])), static_cast<float>(std::log(deviations[1])), static_cast<float>(std::log(deviations[2])) };
+                nodes.rotQuats[j] = matrixToQuaternion(axes);
+                const double area = deviations[0] * deviations[1] * deviations[2] / std::min({ deviations[0], deviations[1], deviations[2] });
+                const double opacity = std::clamp(uniform ? 0.0 : totalWeight / area, 1e-6, 0.99);
+                nodes.opacityLogits[j] = static_cast<float>(std::log(opacity / (1.0 - opacity)));
+                for (int k = 0; k < nShValues; ++k) {
+                    nodes.shCoeffs[j * nShValues + k] = static_cast<float>(sh[k]);
+                }
+                firstChild[j] = static_cast<uint32_t>(firstNode);
+                childCount[j] = static_cast<uint32_t>(lastNode - firstNode);
+
+                // A light child can sit far from the weighted mean, so each
+                // child's bound is moved out by its distance to the stored
+                // center, and rounded up to stay a bound in float.
+                const auto& center = nodes.positions[j];
+                double radius = 3.0 * std::max({ deviations[0], deviations[1], deviations[2] });
+                for (size_t node = firstNode; node < lastNode; ++node) {
+                    auto [scene, i] = source(node);
+                    const double d[3] = { scene.positions[i][0] - center[0], scene.positions[i][1] - center[1], scene.positions[i][2] - center[2] };
+                    radius = std::max(radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + radii[node]);
+                }
+                radii[nLeaves + j] = std::nextafter(static_cast<float>(radius), std::numeric_limits<float>::infinity());
+            }
+        });
+
+        // A node takes the code of its first child, which its whole cell shares above `shift`.
+        for (size_t group = 0; group < nGroups; ++group) {
+            codes[group] = codes[groupStarts[group]];
+        }
+        codes.resize(nGroups);
+        count = nGroups;
+        levelOffsets.push_back(levelOffsets.back() + nGroups);
+        levelStats.push_back({ nGroups, std::chrono::duration<double, std::milli>(Clock::now() - start).count() });
+    }
+}
+
+size_t LodHierarchy::leafCount() const {
+    return leafSources.size();
+}
+
+size_t LodHierarchy::nodeCount() const {
+    return leafSources.size() + firstChild.size();
+}
+
+int LodHierarchy::levelCount() const {
+    return static_cast<int>(levelOffsets.size()) - 1;
+}
+
+const std::array<float, 3>& LodHierarchy::nodePosition(const PackedGaussians& gaussians, uint32_t node) const {
+    if (node < leafSources.size()) {
+        return gaussians.positions[leafSources[node]];
+    }
+    return nodes.positions[node - leafSources.size()];
+}
+
+std::vector<uint32_t> LodHierarchy::selectCut(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, float focal, float maxPixelRadius) const {
+    if (static_cast<size_t>(gaussians.numGaussians) != sourceCount) {
+        throw std::invalid_argument("Scene does not match the LOD hierarchy");
+    }
+
+    std::vector<uint32_t> cut;
+    std::vector<uint32_t> stack;
+    if (levelCount() > 0) {
+        for (size_t node = levelOffsets[levelOffsets.size() - 2]; node < levelOffsets.back(); ++node) {
+            stack.push_back(static_cast<uint32_t>(node));
+        }
+    }
+    while (!stack.empty()) {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        if (node < leafSources.size()) {
+            cut.push_back(node);
+            continue;
+        }
+        const auto& position = nodePosition(gaussians, node);
+        const float dx = position[0] - cameraPosition[0];
+        const float dy = position[1] - cameraPosition[1];
+        const float dz = position[2] - cameraPosition[2];
+        const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (focal * radii[node] <= maxPixelRadius * distance) {
+            cut.push_back(node);
+            continue;
+        }
+        const size_t j = node - leafSources.size();
+        for (uint32_t child = firstChild[j]; child < firstChild[j] + childCount[j]; ++child) {
+            stack.push_back(child);
+        }
+    }
+    return cut;
+}
+
+PackedGaussians LodHierarchy::gather(const PackedGaussians& gaussians, std::span<const uint32_t> cut) const {
+    const size_t n = cut.size();
+    PackedGaussians result;
+    result.numGaussians = static_cast<int>(n);
+    result.sphericalHarmonicsDegree = gaussians.sphericalHarmonicsDegree;
+    result.positions.resize(n);
+    result.logScales.resize(n);
+    result.rotQuats.resize(n);
+    result.opacityLogits.resize(n);
+    const int nShValues = result.nShCoeffs() * 3;
+    result.shCoeffs.resize(n * nShValues);
+    for (size_t k = 0; k < n; ++k) {
+        const bool leaf = cut[k] < leafSources.size();
+        const PackedGaussians& scene = leaf ? gaussians : nodes;
+        const int i = static_cast<int>(leaf ? leafSources[cut[k]] : cut[k] - leafSources.size());
+        result.positions[k] = scene.positions[i];
+        result.logScales[k] = scene.logScales[i];
+        result.rotQuats[k] = scene.rotQuats[i];
+        result.opacityLogits[k] = scene.opacityLogits[i];
+        for (int v = 0; v < nShValues; ++v) {
+            result.shCoeffs[k * nShValues + v] = scene.shCoeff(i, v / 3, v % 3);
+        }
+    }
+    return result;
+}
+
+static const char lodMagic[4] = { 'G', 'S', 'L', 'D' };
+static const uint32_t lodVersion = 1;
+static const char lodFileKind[] = "LOD file";
+
+void LodHierarchy::save(const std::string& filePath) const {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+
+    const uint64_t header[5] = { sourceCount, leafSources.size(), firstChild.size(), levelOffsets.size(), static_cast<uint64_t>(nodes.sphericalHarmonicsDegree) };
+    writeValues(file, lodMagic, 4);
+    writeValues(file, &lodVersion, 1);
+    writeValues(file, header, 5);
+    writeValues(file, levelOffsets.data(), levelOffsets.size());
+    writeValues(file, levelStats.data(), levelStats.size());
+    writeValues(file, leafSources.data(), leafSources.size());
+    writeValues(file, firstChild.data(), firstChild.size());
+    writeValues(file, childCount.data(), childCount.size());
+    writeValues(file, radii.data(), radii.size());
+    writeValues(file, nodes.positions.data(), nodes.positions.size());
+    writeValues(file, nodes.logScales.data(), nodes.logScales.size());
+    writeValues(file, nodes.rotQuats.data(), nodes.rotQuats.size());
+    writeValues(file, nodes.opacityLogits.data(), nodes.opacityLogits.size());
+    writeValues(file, nodes.shCoeffs.data(), nodes.shCoeffs.size());
+
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
+
+LodHierarchy LodHierarchy::load(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to load file");
+    }
+
+    char magic[4];
+    uint32_t version;
+    uint64_t header[5];
+    readValues(file, magic, 4, lodFileKind);
+    readValues(file, &version, 1, lodFileKind);
+    if (std::memcmp(magic, lodMagic, 4) != 0 || version != lodVersion) {
+        throw std::runtime_error("Not a LOD file, or unsupported version");
+    }
+    readValues(file, header, 5, lodFileKind);
+    const uint64_t maxCount = std::numeric_limits<int32_t>::max();
+    if (header[1] > header[0] || header[0] > maxCount || header[2] > maxCount || header[3] < 2 || header[3] > 64 || header[4] > 3) {
+        throw std::runtime_error("Invalid LOD file header");
+    }
+
+    LodHierarchy lod;
+    lod.sourceCount = header[0];
+    const size_t nLeaves = header[1];
+    const size_t nInterior = header[2];
+    lod.levelOffsets.resize(header[3]);
+    lod.levelStats.resize(header[3] - 1);
+    lod.leafSources.resize(nLeaves);
+    lod.firstChild.resize(nInterior);
+    lod.childCount.resize(nInterior);
+    lod.radii.resize(nLeaves + nInterior);
+    lod.nodes.numGaussians = static_cast<int>(nInterior);
+    lod.nodes.sphericalHarmonicsDegree = static_cast<int>(header[4]);
+    lod.nodes.shLayout = ShLayout::Interleaved;
+    lod.nodes.positions.resize(nInterior);
+    lod.nodes.logScales.resize(nInterior);
+    lod.nodes.rotQuats.resize(nInterior);
+    lod.nodes.opacityLogits.resize(nInterior);
+    lod.nodes.shCoeffs.resize(nInterior * lod.nodes.nShCoeffs() * 3);
+
+    readValues(file, lod.levelOffsets.data(), lod.levelOffsets.size(), lodFileKind);
+    readValues(file, lod.levelStats.data(), lod.levelStats.size(), lodFileKind);
+    readValues(file, lod.leafSources.data(), nLeaves, lodFileKind);
+    readValues(file, lod.firstChild.data(), nInterior, lodFileKind);
+    readValues(file, lod.childCount.data(), nInterior, lodFileKind);
+    readValues(file, lod.radii.data(), lod.radii.size(), lodFileKind);
+    readValues(file, lod.nodes.positions.data(), nInterior, lodFileKind);
+    readValues(file, lod.nodes.logScales.data(), nInterior, lodFileKind);
+    readValues(file, lod.nodes.rotQuats.data(), nInterior, lodFileKind);
+    readValues(file, lod.nodes.opacityLogits.data(), nInterior, lodFileKind);
+    readValues(file, lod.nodes.shCoeffs.data(), lod.nodes.shCoeffs.size(), lodFileKind);
+    if (lod.levelOffsets.back() != nLeaves + nInterior) {
+        throw std::runtime_error("Invalid LOD file levels");
+    }
+    for (size_t j = 0; j < nInterior; ++j) {
+        if (static_cast<uint64_t>(lod.firstChild[j]) + lod.childCount[j] > nLeaves + j) {
+            throw std::runtime_error("Invalid LOD file node children");
+        }
+    }
+    return lod;
+}
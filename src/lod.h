@@ -0,0 +1,80 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include "ply.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <string>
+#include <cstdint>
+
+struct LodOptions {
+    int nThreads = 0;
+    // Splats whose activated opacity is below this are dropped.
+    float minOpacity = 1.0f / 255.0f;
+    // Splats whose 3-sigma radius covers fewer pixels than this, seen from
+    // referenceDistance through a camera of focal length referenceFocal
+    // pixels, are dropped. 0 keeps them all.
+    float minPixelRadius = 0.0f;
+    float referenceFocal = 1000.0f;
+    float referenceDistance = 10.0f;
+    // Each level is made as coarse as needed to have at most 1 / branching as
+    // many nodes as the level below.
+    int branching = 4;
+    int maxLevels = 24;
+};
+
+struct LodLevelStats {
+    size_t nodes;
+    double buildMilliseconds;
+};
+
+// Simplification tree over the splats of a scene. Splats that survive
+// pruning are the leaves, sorted by the 63-bit Morton code of their center.
+// Every level above groups consecutive nodes of the level below that share
+// an octree cell and replaces each group by one Gaussian with the same
+// weighted mean and covariance, weighted by opacity times the area of the
+// two largest axes. The parent's opacity keeps that weighted area and its
+// SH coefficients are the weighted mean of its children's.
+//
+// Node ids run over the leaves first and then the interior nodes level by
+// level. The leaves refer to the source scene, so only the tree and the
+// merged splats are stored here, and the tree is saved next to the scene
+// rather than with it.
+class LodHierarchy {
+public:
+    size_t sourceCount;
+    // Source splat of every leaf.
+    std::vector<uint32_t> leafSources;
+    // Merged splat of every interior node, in interior node order. SH is interleaved.
+    PackedGaussians nodes;
+    // Children of interior node j are nodes [firstChild[j], firstChild[j] + childCount[j]).
+    std::vector<uint32_t> firstChild;
+    std::vector<uint32_t> childCount;
+    // Radius around every node's center that holds the 3-sigma extent of the
+    // node and of every splat of its subtree.
+    std::vector<float> radii;
+    // Nodes of level l are [levelOffsets[l], levelOffsets[l + 1]); level 0 is the leaves.
+    std::vector<size_t> levelOffsets;
+    std::vector<LodLevelStats> levelStats;
+
+    LodHierarchy();
+    LodHierarchy(const PackedGaussians& gaussians, const LodOptions& options = {});
+
+    size_t leafCount() const;
+    size_t nodeCount() const;
+    int levelCount() const;
+    const std::array<float, 3>& nodePosition(const PackedGaussians& gaussians, uint32_t node) const;
+
+    // Coarsest nodes whose projected radius is at most maxPixelRadius, with
+    // leaves standing in where no such node exists. `gaussians` is the scene
+    // the tree was built from.
+    std::vector<uint32_t> selectCut(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, float focal, float maxPixelRadius) const;
+    // The splats of `cut` as a scene of their own.
+    PackedGaussians gather(const PackedGaussians& gaussians, std::span<const uint32_t> cut) const;
+
+    void save(const std::string& filePath) const;
+    static LodHierarchy load(const std::string& filePath);
+};
+
+#endif // LOD_H
@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath) : fd(-1), mapping(nullptr), length(0) {
+    fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file " + filePath);
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file " + filePath);
+    }
+    length = static_cast<size_t>(status.st_size);
+
+    if (length > 0) {
+        void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file " + filePath);
+        }
+        mapping = static_cast<uint8_t*>(address);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapping) {
+        ::munmap(mapping, length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void MappedFile::adviseSequential() const {
+    if (mapping) {
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::release(std::span<const uint8_t> range) const {
+    if (!mapping || range.empty()) {
+        return;
+    }
+    const uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(range.data()) + pageSize - 1) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(range.data() + range.size()) & ~(pageSize - 1);
+    if (begin < end) {
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath) : fd(-1), mapping(nullptr), length(0) {
+    throw std::runtime_error("Memory mapping is not supported on this platform");
+}
+
+MappedFile::~MappedFile() {}
+
+void MappedFile::adviseSequential() const {}
+
+void MappedFile::release(std::span<const uint8_t> range) const {}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : fd(std::exchange(other.fd, -1)), mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    std::swap(fd, other.fd);
+    std::swap(mapping, other.mapping);
+    std::swap(length, other.length);
+    return *this;
+}
+
+std::span<const uint8_t> MappedFile::data() const {
+    return { mapping, length };
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <span>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Pages are faulted in lazily as the
+// span is read and can be handed back to the kernel once they are consumed.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::span<const uint8_t> data() const;
+    size_t size() const;
+
+    void adviseSequential() const;
+
+    // Drops the resident pages fully covered by `range`, which must lie inside
+    // data(). Touching them again refetches them from the file.
+    void release(std::span<const uint8_t> range) const;
+
+private:
+    int fd;
+    uint8_t* mapping;
+    size_t length;
+};
+
+#endif // MAPPED_FILE_H
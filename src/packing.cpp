@@ -1,4 +1,8 @@
 #include "packing.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <cassert>
 
 int roundUp(int n, int multiple) {
     return std::ceil(static_cast<float>(n) / multiple) * multiple;
@@ -8,6 +12,46 @@ PackingError::PackingError(const std::string& message) : std::runtime_error(mess
 
 PackingType::PackingType(int size, int alignment) : size(size), alignment(alignment) {}
 
+int PackingType::elementCount() const {
+    return 0;
+}
+
+std::pair<int, const PackingType*> PackingType::element(int /* offset */, int /* index */) const {
+    throw PackingError("Type has no elements");
+}
+
+std::pair<int, const PackingType*> PackingType::member(int /* offset */, std::string_view key) const {
+    throw PackingError("Type has no member " + std::string(key));
+}
+
+int PackingPlan::fieldIndex(const std::string& field) const {
+    for (int i = 0; i < static_cast<int>(fields.size()); ++i) {
+        if (fields[i] == field) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PackingPlan::appendScalar(const std::string& field, int offset, ScalarKind kind) {
+    int index = fieldIndex(field);
+    if (index < 0) {
+        index = static_cast<int>(fields.size());
+        fields.push_back(field);
+        fieldScalarCounts.push_back(0);
+    }
+    const int sourceIndex = fieldScalarCounts[index]++;
+
+    if (!entries.empty()) {
+        auto& last = entries.back();
+        if (last.field == index && last.kind == kind && last.sourceIndex + last.count == sourceIndex && last.offset + 4 * last.count == offset) {
+            last.count++;
+            return;
+        }
+    }
+    entries.push_back({ index, sourceIndex, offset, kind, 1 });
+}
+
 i32Type::i32Type() : PackingType(4, 4) {}
 
 int i32Type::pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const {
@@ -59,6 +103,18 @@ std::pair<int, NestedData> f32Type::unpack(int offset, const std::vector<uint8_t
     return {offset + size, content};
 }
 
+void i32Type::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    plan.appendScalar(field, offset, ScalarKind::I32);
+}
+
+void u32Type::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    plan.appendScalar(field, offset, ScalarKind::U32);
+}
+
+void f32Type::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    plan.appendScalar(field, offset, ScalarKind::F32);
+}
+
 const i32Type i32;
 const u32Type u32;
 const f32Type f32;
@@ -106,6 +162,24 @@ std::pair<int, NestedData> VectorType::unpack(int offset, const std::vector<uint
     return {offset, values};
 }
 
+void VectorType::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    offset = roundUp(offset, alignment);
+    for (int i = 0; i < nValues; ++i) {
+        baseType.appendPlan(offset + i * baseType.size, field, plan);
+    }
+}
+
+int VectorType::elementCount() const {
+    return nValues;
+}
+
+std::pair<int, const PackingType*> VectorType::element(int offset, int index) const {
+    if (index < 0 || index >= nValues) {
+        throw PackingError("Index " + std::to_string(index) + " out of range for " + std::to_string(nValues) + " values");
+    }
+    return { roundUp(offset, alignment) + index * baseType.size, &baseType };
+}
+
 vec2::vec2(const PackingType& baseType) : VectorType(baseType, 2, 8) {}
 
 vec3::vec3(const PackingType& baseType) : VectorType(baseType, 3, 16) {}
@@ -127,7 +201,12 @@ Struct::Struct(const std::vector<std::pair<std::string, PackingType*>>& members)
     this->alignment = alignment;
 }
 
+// Struct and StaticArray packing recurse per member and element, so only
+// the outermost call of a tree is traced.
+static thread_local int packDepth = 0;
+
 int Struct::pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const {
+    OutermostTimer timer("Struct::pack", packDepth);
     if (!std::holds_alternative<std::unordered_map<std::string, NestedData>>(value)) {
         throw PackingError("Expected object, got " + std::string(typeid(value).name()));
     }
@@ -159,6 +238,7 @@ int Struct::pack(int offset, const NestedData& value, std::vector<uint8_t>& buff
     }
 
     offset += size - (offset - startingOffset);
+    timer.addBytes(offset - startingOffset);
     return offset;
 }
 
@@ -182,12 +262,35 @@ std::pair<int, NestedData> Struct::unpack(int offset, const std::vector<uint8_t>
     return {offset, values};
 }
 
+void Struct::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    offset = roundUp(offset, alignment);
+    for (const auto& member : members) {
+        offset = roundUp(offset, member.second->alignment);
+        member.second->appendPlan(offset, field.empty() ? member.first : field + "." + member.first, plan);
+        offset += member.second->size;
+    }
+}
+
+std::pair<int, const PackingType*> Struct::member(int offset, std::string_view key) const {
+    offset = roundUp(offset, alignment);
+    for (const auto& member : members) {
+        offset = roundUp(offset, member.second->alignment);
+        if (member.first == key) {
+            return { offset, member.second };
+        }
+        offset += member.second->size;
+    }
+    throw PackingError("Missing value for key " + std::string(key));
+}
+
 StaticArray::StaticArray(const PackingType& type, int nElements)
     : PackingType(nElements * roundUp(type.size, type.alignment), type.alignment),
       type(type), nElements(nElements),
       stride(roundUp(type.size, type.alignment)) {}
 
 int StaticArray::pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const {
+    OutermostTimer timer("StaticArray::pack", packDepth);
+    const int startingOffset = offset;
     if (!std::holds_alternative<std::vector<NestedData>>(value)) {
         throw PackingError("Expected array, got " + std::string(typeid(value).name()));
     }
@@ -210,6 +313,7 @@ int StaticArray::pack(int offset, const NestedData& value, std::vector<uint8_t>&
         }
         offset += stride - type.size;
     }
+    timer.addBytes(offset - startingOffset);
     return offset;
 }
 
@@ -229,21 +333,37 @@ std::pair<int, NestedData> StaticArray::unpack(int offset, const std::vector<uin
     return {offset, values};
 }
 
-MatrixType::MatrixType(const PackingType& baseType, int nRows, int nColumns)
-    : PackingType(0, 0), baseType(baseType), nRows(nRows), nColumns(nColumns) {
-    VectorType* vecType;
-    if (nRows == 2) {
-        vecType = new vec2(baseType);
-    } else if (nRows == 3) {
-        vecType = new vec3(baseType);
-    } else if (nRows == 4) {
-        vecType = new vec4(baseType);
-    } else {
+void StaticArray::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    offset = roundUp(offset, alignment);
+    for (int i = 0; i < nElements; ++i) {
+        type.appendPlan(offset + i * stride, field, plan);
+    }
+}
+
+int StaticArray::elementCount() const {
+    return nElements;
+}
+
+std::pair<int, const PackingType*> StaticArray::element(int offset, int index) const {
+    if (index < 0 || index >= nElements) {
+        throw PackingError("Index " + std::to_string(index) + " out of range for " + std::to_string(nElements) + " elements");
+    }
+    return { roundUp(offset, alignment) + index * stride, &type };
+}
+
+static int matrixColumnAlignment(int nRows) {
+    if (nRows < 2 || nRows > 4) {
         throw std::invalid_argument("Invalid number of rows: " + std::to_string(nRows));
     }
-    StaticArray arrayType(*vecType, nColumns);
+    return nRows == 2 ? 8 : 16;
+}
+
+MatrixType::MatrixType(const PackingType& baseType, int nRows, int nColumns)
+    : PackingType(0, 0), baseType(baseType), nRows(nRows), nColumns(nColumns),
+      columnType(baseType, nRows, matrixColumnAlignment(nRows)), packedColumnType(baseType, nRows, baseType.alignment) {
+    StaticArray arrayType(columnType, nColumns);
     size = arrayType.size;
-    alignment = vecType->alignment;
+    alignment = columnType.alignment;
 }
 
 int MatrixType::pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const {
@@ -305,4 +425,113 @@ std::pair<int, NestedData> MatrixType::unpack(int offset, const std::vector<uint
     return {offset, outerValues};
 }
 
+int MatrixType::elementCount() const {
+    return nColumns;
+}
+
+std::pair<int, const PackingType*> MatrixType::element(int offset, int index) const {
+    if (index < 0 || index >= nColumns) {
+        throw PackingError("Index " + std::to_string(index) + " out of range for " + std::to_string(nColumns) + " columns");
+    }
+    // Columns are stored back to back, see MatrixType::pack.
+    return { roundUp(offset, alignment) + index * nRows * baseType.size, &packedColumnType };
+}
+
 mat4x4::mat4x4(const PackingType& baseType) : MatrixType(baseType, 4, 4) {}
+
+void MatrixType::appendPlan(int offset, const std::string& field, PackingPlan& plan) const {
+    // Mirrors MatrixType::pack, which writes the columns back to back.
+    offset = roundUp(offset, alignment);
+    for (int i = 0; i < nColumns * nRows; ++i) {
+        baseType.appendPlan(offset + i * baseType.size, field, plan);
+    }
+}
+
+PackingPlan compilePackingPlan(const PackingType& type) {
+    PackingPlan plan;
+    plan.stride = roundUp(type.size, type.alignment);
+    plan.alignment = type.alignment;
+    type.appendPlan(0, "", plan);
+    return plan;
+}
+
+void packArray(const PackingPlan& plan, const std::unordered_map<std::string, PackingColumn>& columns, size_t count, std::span<uint8_t> buffer, int nThreads) {
+    ScopedTimer timer("packArray");
+    timer.addBytes(count * plan.stride);
+    if (buffer.size() < count * plan.stride) {
+        throw PackingError("Buffer holds " + std::to_string(buffer.size()) + " bytes, need " + std::to_string(count * plan.stride));
+    }
+
+    std::vector<PackingColumn> fieldColumns;
+    for (const auto& field : plan.fields) {
+        auto column = columns.find(field);
+        if (column == columns.end()) {
+            throw PackingError("Missing column for field " + field);
+        }
+        fieldColumns.push_back(column->second);
+    }
+    checkPackingColumns(plan, fieldColumns);
+
+    parallelFor(count, nThreads, [&](int, size_t begin, size_t end) {
+        packRecords(plan, plan.entries, fieldColumns, begin, end, buffer);
+    });
+}
+
+void checkPackingColumns(const PackingPlan& plan, std::span<const PackingColumn> fieldColumns) {
+    if (fieldColumns.size() != plan.fields.size()) {
+        throw PackingError("Plan has " + std::to_string(plan.fields.size()) + " fields, got " + std::to_string(fieldColumns.size()) + " columns");
+    }
+    for (size_t i = 0; i < plan.fields.size(); ++i) {
+        if (plan.fieldScalarCounts[i] > fieldColumns[i].scalarCount) {
+            throw PackingError("Field " + plan.fields[i] + " has " + std::to_string(plan.fieldScalarCounts[i]) + " scalars, its column " + std::to_string(fieldColumns[i].scalarCount));
+        }
+    }
+    for (const auto& entry : plan.entries) {
+        if (entry.kind != fieldColumns[entry.field].kind) {
+            throw PackingError("Field " + plan.fields[entry.field] + " has a different scalar type than its column");
+        }
+    }
+}
+
+void packRecords(const PackingPlan& plan, std::span<const PackingPlanEntry> entries, std::span<const PackingColumn> fieldColumns, size_t begin, size_t end, std::span<uint8_t> buffer) {
+    for (const auto& entry : entries) {
+        assert(entry.sourceIndex + entry.count <= fieldColumns[entry.field].scalarCount);
+    }
+    for (size_t record = begin; record < end; ++record) {
+        uint8_t* destination = buffer.data() + record * plan.stride;
+        for (const auto& entry : entries) {
+            const auto& column = fieldColumns[entry.field];
+            const uint8_t* source = static_cast<const uint8_t*>(column.data) + record * column.recordStride + entry.sourceIndex * 4;
+            std::memcpy(destination + entry.offset, source, entry.count * 4);
+        }
+    }
+}
+
+PackedView::PackedView(const PackingType& type, std::span<const uint8_t> buffer, int offset)
+    : viewType(&type), buffer(buffer), viewOffset(offset) {
+    if (offset < 0 || static_cast<size_t>(roundUp(offset, type.alignment)) + type.size > buffer.size()) {
+        throw PackingError("View at offset " + std::to_string(offset) + " extends past the end of the buffer");
+    }
+}
+
+const PackingType& PackedView::type() const {
+    return *viewType;
+}
+
+int PackedView::offset() const {
+    return viewOffset;
+}
+
+int PackedView::size() const {
+    return viewType->elementCount();
+}
+
+PackedView PackedView::operator[](std::string_view key) const {
+    auto [memberOffset, memberType] = viewType->member(viewOffset, key);
+    return PackedView(*memberType, buffer, memberOffset);
+}
+
+PackedView PackedView::operator[](int index) const {
+    auto [elementOffset, elementType] = viewType->element(viewOffset, index);
+    return PackedView(*elementType, buffer, elementOffset);
+}
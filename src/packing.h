@@ -10,9 +10,20 @@
 #include <cstring>
 #include <cmath>
 #include <string>
+#include <cstdint>
+#include <span>
+#include <array>
+#include <string_view>
+#include <type_traits>
+#include <tuple>
 
-// Define NestedData as a variant of possible types
-using NestedData = std::variant<int32_t, uint32_t, float, std::vector<NestedData>, std::unordered_map<std::string, NestedData>>;
+// Define NestedData as a variant of possible types. A type alias cannot refer
+// to itself, so the recursive variant is wrapped in a struct.
+struct NestedData;
+using NestedDataVariant = std::variant<int32_t, uint32_t, float, std::vector<NestedData>, std::unordered_map<std::string, NestedData>>;
+struct NestedData : NestedDataVariant {
+    using NestedDataVariant::NestedDataVariant;
+};
 
 int roundUp(int n, int multiple);
 
@@ -21,14 +32,49 @@ public:
     explicit PackingError(const std::string& message);
 };
 
+enum class ScalarKind { I32, U32, F32 };
+
+// A run of `count` consecutive 4-byte scalars copied from one source field of
+// a record into the packed record at `offset`.
+struct PackingPlanEntry {
+    int field;
+    int sourceIndex;
+    int offset;
+    ScalarKind kind;
+    int count;
+};
+
+// A PackingType flattened into copy runs. Struct members are addressed by
+// dotted path ("camera.view"); vectors, matrices and arrays below a path are
+// flattened into consecutive scalars of that field, in pack order.
+struct PackingPlan {
+    std::vector<std::string> fields;
+    std::vector<int> fieldScalarCounts;
+    std::vector<PackingPlanEntry> entries;
+    int stride;
+    int alignment;
+
+    int fieldIndex(const std::string& field) const;
+    void appendScalar(const std::string& field, int offset, ScalarKind kind);
+};
+
 class PackingType {
 public:
     int size;
     int alignment;
 
     PackingType(int size, int alignment);
+    virtual ~PackingType() = default;
     virtual int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const = 0;
     virtual std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const = 0;
+    virtual void appendPlan(int offset, const std::string& field, PackingPlan& plan) const = 0;
+
+    // Offset and type of element `index` (arrays, vectors, matrix columns) or
+    // member `key` (structs) of a value stored at `offset`. Types without
+    // elements or members throw PackingError.
+    virtual int elementCount() const;
+    virtual std::pair<int, const PackingType*> element(int offset, int index) const;
+    virtual std::pair<int, const PackingType*> member(int offset, std::string_view key) const;
 };
 
 class i32Type : public PackingType {
@@ -36,6 +82,7 @@ public:
     i32Type();
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
 };
 
 class u32Type : public PackingType {
@@ -43,6 +90,7 @@ public:
     u32Type();
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
 };
 
 class f32Type : public PackingType {
@@ -50,6 +98,7 @@ public:
     f32Type();
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
 };
 
 extern const i32Type i32;
@@ -64,6 +113,9 @@ public:
     VectorType(const PackingType& baseType, int nValues, int alignment);
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
+    int elementCount() const override;
+    std::pair<int, const PackingType*> element(int offset, int index) const override;
 };
 
 class vec2 : public VectorType {
@@ -88,6 +140,8 @@ public:
     Struct(const std::vector<std::pair<std::string, PackingType*>>& members);
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
+    std::pair<int, const PackingType*> member(int offset, std::string_view key) const override;
 };
 
 class StaticArray : public PackingType {
@@ -99,6 +153,9 @@ public:
     StaticArray(const PackingType& type, int nElements);
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
+    int elementCount() const override;
+    std::pair<int, const PackingType*> element(int offset, int index) const override;
 };
 
 class MatrixType : public PackingType {
@@ -106,10 +163,17 @@ public:
     const PackingType& baseType;
     int nRows;
     int nColumns;
+    VectorType columnType;
+    // A column as pack stores it: back to back with the previous one, so
+    // aligned only like baseType. This is the type element() returns.
+    VectorType packedColumnType;
 
     MatrixType(const PackingType& baseType, int nRows, int nColumns);
     int pack(int offset, const NestedData& value, std::vector<uint8_t>& buffer) const override;
     std::pair<int, NestedData> unpack(int offset, const std::vector<uint8_t>& buffer) const override;
+    void appendPlan(int offset, const std::string& field, PackingPlan& plan) const override;
+    int elementCount() const override;
+    std::pair<int, const PackingType*> element(int offset, int index) const override;
 };
 
 class mat4x4 : public MatrixType {
@@ -117,4 +181,197 @@ public:
     mat4x4(const PackingType& baseType);
 };
 
+PackingPlan compilePackingPlan(const PackingType& type);
+
+// Source of one plan field: the field's first scalar for record 0, the byte
+// distance between consecutive records, and the number and kind of the
+// scalars each record holds.
+struct PackingColumn {
+    const void* data;
+    size_t recordStride;
+    int scalarCount;
+    ScalarKind kind;
+};
+
+template <typename T>
+constexpr ScalarKind scalarKindOf() {
+    static_assert(std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float>, "Columns hold i32, u32 or f32 scalars");
+    if constexpr (std::is_same_v<T, int32_t>) {
+        return ScalarKind::I32;
+    }
+    else if constexpr (std::is_same_v<T, uint32_t>) {
+        return ScalarKind::U32;
+    }
+    else {
+        return ScalarKind::F32;
+    }
+}
+
+template <typename T, size_t N>
+PackingColumn makeColumn(const std::vector<std::array<T, N>>& values) {
+    return { values.data(), sizeof(std::array<T, N>), static_cast<int>(N), scalarKindOf<T>() };
+}
+
+template <typename T>
+PackingColumn makeColumn(const std::vector<T>& values) {
+    return { values.data(), sizeof(T), 1, scalarKindOf<T>() };
+}
+
+// Packs `count` records into `buffer` (which must hold count * plan.stride
+// bytes) straight from typed columns, one memcpy per plan entry and record.
+// Throws PackingError when a field is missing, has more scalars than its
+// column or a different scalar kind.
+void packArray(const PackingPlan& plan, const std::unordered_map<std::string, PackingColumn>& columns, size_t count, std::span<uint8_t> buffer, int nThreads = 1);
+
+// Throws PackingError when a column of fieldColumns, indexed like
+// plan.fields, has fewer scalars than its field or a different scalar kind.
+void checkPackingColumns(const PackingPlan& plan, std::span<const PackingColumn> fieldColumns);
+
+// Packs records [begin, end) into their slots of `buffer`, copying only
+// `entries`, a subset of plan.entries. fieldColumns is indexed like plan.fields
+// and must have passed checkPackingColumns.
+void packRecords(const PackingPlan& plan, std::span<const PackingPlanEntry> entries, std::span<const PackingColumn> fieldColumns, size_t begin, size_t end, std::span<uint8_t> buffer);
+
+template <typename T>
+bool holdsScalar(const PackingType& type) {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        return dynamic_cast<const i32Type*>(&type) != nullptr;
+    }
+    else if constexpr (std::is_same_v<T, uint32_t>) {
+        return dynamic_cast<const u32Type*>(&type) != nullptr;
+    }
+    else {
+        static_assert(std::is_same_v<T, float>, "Scalars are int32_t, uint32_t or float");
+        return dynamic_cast<const f32Type*>(&type) != nullptr;
+    }
+}
+
+template <typename T>
+struct ColumnElement {
+    using scalar = T;
+    static constexpr int nValues = 1;
+};
+
+template <typename T, size_t N>
+struct ColumnElement<std::array<T, N>> {
+    using scalar = T;
+    static constexpr int nValues = static_cast<int>(N);
+};
+
+// Strided read-only sequence of T (a scalar or std::array of scalars) inside
+// a packed buffer, e.g. one member of every element of a StaticArray of Structs.
+template <typename T>
+class PackedColumn {
+public:
+    class iterator {
+    public:
+        iterator(const uint8_t* position, int stride) : position(position), stride(stride) {}
+        T operator*() const {
+            T value;
+            std::memcpy(&value, position, sizeof(T));
+            return value;
+        }
+        iterator& operator++() {
+            position += stride;
+            return *this;
+        }
+        bool operator!=(const iterator& other) const {
+            return position != other.position;
+        }
+
+    private:
+        const uint8_t* position;
+        int stride;
+    };
+
+    PackedColumn(const uint8_t* first, int stride, int count) : first(first), stride(stride), count(count) {}
+
+    int size() const {
+        return count;
+    }
+
+    T operator[](int index) const {
+        T value;
+        std::memcpy(&value, first + static_cast<size_t>(index) * stride, sizeof(T));
+        return value;
+    }
+
+    iterator begin() const {
+        return { first, stride };
+    }
+
+    iterator end() const {
+        return { first + static_cast<size_t>(count) * stride, stride };
+    }
+
+private:
+    const uint8_t* first;
+    int stride;
+    int count;
+};
+
+// Read-only view of a value of `type` packed at `offset` in `buffer`.
+// Member and element access resolve offsets from the type descriptors and
+// read straight from the buffer, without building NestedData.
+class PackedView {
+public:
+    PackedView(const PackingType& type, std::span<const uint8_t> buffer, int offset = 0);
+
+    const PackingType& type() const;
+    int offset() const;
+    int size() const;
+
+    PackedView operator[](std::string_view key) const;
+    PackedView operator[](int index) const;
+
+    template <typename T>
+    T as() const {
+        if (!holdsScalar<T>(*viewType)) {
+            throw PackingError("Value at offset " + std::to_string(viewOffset) + " has a different scalar type");
+        }
+        T value;
+        std::memcpy(&value, buffer.data() + roundUp(viewOffset, viewType->alignment), sizeof(T));
+        return value;
+    }
+
+    // Every element of this array, vector or matrix (or the `member` of every
+    // element, for arrays of structs) as a strided column of T.
+    template <typename T>
+    PackedColumn<T> column(std::string_view member = {}) const {
+        const int count = size();
+        if (count == 0) {
+            return { buffer.data(), 0, 0 };
+        }
+        auto [firstOffset, elementType] = viewType->element(viewOffset, 0);
+        const int stride = count > 1 ? viewType->element(viewOffset, 1).first - firstOffset : 0;
+        if (!member.empty()) {
+            std::tie(firstOffset, elementType) = elementType->member(firstOffset, member);
+        }
+
+        using Element = ColumnElement<T>;
+        const PackingType* scalarType = elementType;
+        if constexpr (Element::nValues > 1) {
+            if (elementType->elementCount() != Element::nValues) {
+                throw PackingError("Column element has " + std::to_string(elementType->elementCount()) + " values, expected " + std::to_string(Element::nValues));
+            }
+            std::tie(firstOffset, scalarType) = elementType->element(firstOffset, 0);
+        }
+        if (!holdsScalar<typename Element::scalar>(*scalarType)) {
+            throw PackingError("Column has a different scalar type");
+        }
+        firstOffset = roundUp(firstOffset, scalarType->alignment);
+
+        const size_t last = static_cast<size_t>(firstOffset) + static_cast<size_t>(count - 1) * stride + sizeof(T);
+        if (last > buffer.size()) {
+            throw PackingError("Column extends past the end of the buffer");
+        }
+        return { buffer.data() + firstOffset, stride, count };
+    }
+
+private:
+    const PackingType* viewType;
+    std::span<const uint8_t> buffer;
+    int viewOffset;
+};
+
 #endif // PACKING_H
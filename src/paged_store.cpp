@@ -0,0 +1,505 @@
+#include "paged_store.h"
+#include "binary_io.h"
+#include "trace.h"
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+static const char pagedMagic[4] = { 'G', 'S', 'P', 'S' };
+static const uint32_t pagedVersion = 1;
+static const size_t pagedAlignment = 4096;
+// Magic, version, then splat count, SH degree and chunk count as uint64.
+static const size_t pagedHeaderSize = 8 + 3 * sizeof(uint64_t);
+// Offset and size as uint64, count and padding as uint32, then six bounds floats.
+static const size_t pagedEntrySize = 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + 6 * sizeof(float);
+
+static size_t alignUp(size_t value) {
+    return (value + pagedAlignment - 1) & ~(pagedAlignment - 1);
+}
+
+// Positions, log-scales, quaternions, opacities, interleaved SH and source
+// indices, in that order.
+static size_t chunkPayloadSize(size_t count, int shDegree) {
+    const size_t nShValues = static_cast<size_t>((shDegree + 1) * (shDegree + 1)) * 3;
+    return count * (sizeof(float) * (3 + 3 + 4 + 1 + nShValues) + sizeof(uint32_t));
+}
+
+static float boxDistance(const Aabb& box, const std::array<float, 3>& point) {
+    float squared = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = std::max({ box.min[axis] - point[axis], 0.0f, point[axis] - box.max[axis] });
+        squared += d * d;
+    }
+    return std::sqrt(squared);
+}
+
+static bool boxesOverlap(const Aabb& a, const Aabb& b) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (a.max[axis] < b.min[axis] || b.max[axis] < a.min[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splat ranges of `order` that become chunks, in depth-first order so that
+// neighbouring chunks are also close in the file.
+static std::vector<std::pair<size_t, size_t>> partitionChunks(const PackedGaussians& gaussians, std::vector<uint32_t>& order, size_t chunkSplats) {
+    std::vector<std::pair<size_t, size_t>> chunks;
+    std::vector<std::pair<size_t, size_t>> stack;
+    if (!order.empty()) {
+        stack.push_back({ 0, order.size() });
+    }
+    while (!stack.empty()) {
+        const auto [begin, end] = stack.back();
+        stack.pop_back();
+        if (end - begin <= chunkSplats) {
+            chunks.push_back({ begin, end });
+            continue;
+        }
+
+        std::array<float, 3> lower = gaussians.positions[order[begin]];
+        std::array<float, 3> upper = lower;
+        for (size_t k = begin + 1; k < end; ++k) {
+            const auto& p = gaussians.positions[order[k]];
+            for (int axis = 0; axis < 3; ++axis) {
+                lower[axis] = std::min(lower[axis], p[axis]);
+                upper[axis] = std::max(upper[axis], p[axis]);
+            }
+        }
+        int axis = 0;
+        for (int a = 1; a < 3; ++a) {
+            if (upper[a] - lower[a] > upper[axis] - lower[axis]) {
+                axis = a;
+            }
+        }
+
+        // Split on a chunk boundary so that only the last chunk of the scene
+        // can be partly filled.
+        const size_t nChunks = (end - begin + chunkSplats - 1) / chunkSplats;
+        const size_t middle = begin + nChunks / 2 * chunkSplats;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](uint32_t a, uint32_t b) {
+            return gaussians.positions[a][axis] < gaussians.positions[b][axis];
+        });
+        stack.push_back({ middle, end });
+        stack.push_back({ begin, middle });
+    }
+    return chunks;
+}
+
+void writePagedScene(const std::string& filePath, const PackedGaussians& gaussians, const PagedSceneWriteOptions& options) {
+    ScopedTimer timer("writePagedScene");
+    if (options.chunkSplats <= 0) {
+        throw std::invalid_argument("chunkSplats must be positive");
+    }
+
+    const size_t n = gaussians.numGaussians;
+    const int shDegree = gaussians.sphericalHarmonicsDegree;
+    const int nShCoeffs = gaussians.nShCoeffs();
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    const auto ranges = partitionChunks(gaussians, order, options.chunkSplats);
+
+    std::vector<PagedChunkInfo> table(ranges.size());
+    size_t offset = alignUp(pagedHeaderSize + ranges.size() * pagedEntrySize);
+    for (size_t c = 0; c < ranges.size(); ++c) {
+        const size_t count = ranges[c].second - ranges[c].first;
+        table[c].offset = offset;
+        table[c].byteSize = chunkPayloadSize(count, shDegree);
+        table[c].count = static_cast<uint32_t>(count);
+        offset = alignUp(offset + table[c].byteSize);
+    }
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+
+    // The table holds the chunk bounds, so the payloads are built first and
+    // the table is written over the space reserved for it at the end.
+    const size_t firstOffset = table.empty() ? pagedHeaderSize : table[0].offset;
+    const std::vector<char> zeros(std::max(firstOffset, pagedAlignment), 0);
+    file.write(zeros.data(), static_cast<std::streamsize>(firstOffset));
+    std::vector<float> shValues;
+    std::vector<uint32_t> sources;
+    for (size_t c = 0; c < ranges.size(); ++c) {
+        const auto [begin, end] = ranges[c];
+        const size_t count = end - begin;
+        Aabb bounds = splatAabb(gaussians.positions[order[begin]], gaussians.logScales[order[begin]], gaussians.rotQuats[order[begin]], 3.0f);
+        for (size_t k = begin + 1; k < end; ++k) {
+            const uint32_t i = order[k];
+            const Aabb box = splatAabb(gaussians.positions[i], gaussians.logScales[i], gaussians.rotQuats[i], 3.0f);
+            for (int axis = 0; axis < 3; ++axis) {
+                bounds.min[axis] = std::min(bounds.min[axis], box.min[axis]);
+                bounds.max[axis] = std::max(bounds.max[axis], box.max[axis]);
+            }
+        }
+        table[c].bounds = bounds;
+
+        for (size_t k = begin; k < end; ++k) {
+            writeValues(file, &gaussians.positions[order[k]], 1);
+        }
+        for (size_t k = begin; k < end; ++k) {
+            writeValues(file, &gaussians.logScales[order[k]], 1);
+        }
+        for (size_t k = begin; k < end; ++k) {
+            writeValues(file, &gaussians.rotQuats[order[k]], 1);
+        }
+        for (size_t k = begin; k < end; ++k) {
+            writeValues(file, &gaussians.opacityLogits[order[k]], 1);
+        }
+        shValues.resize(count * nShCoeffs * 3);
+        for (size_t k = begin; k < end; ++k) {
+            for (int coeff = 0; coeff < nShCoeffs; ++coeff) {
+                for (int channel = 0; channel < 3; ++channel) {
+                    shValues[((k - begin) * nShCoeffs + coeff) * 3 + channel] = gaussians.shCoeff(order[k], coeff, channel);
+                }
+            }
+        }
+        writeValues(file, shValues.data(), shValues.size());
+        sources.assign(order.begin() + begin, order.begin() + end);
+        writeValues(file, sources.data(), sources.size());
+
+        const size_t padding = alignUp(table[c].byteSize) - table[c].byteSize;
+        if (c + 1 < ranges.size()) {
+            file.write(zeros.data(), static_cast<std::streamsize>(padding));
+        }
+    }
+
+    file.seekp(0);
+    const uint64_t header[3] = { n, static_cast<uint64_t>(shDegree), ranges.size() };
+    writeValues(file, pagedMagic, 4);
+    writeValues(file, &pagedVersion, 1);
+    writeValues(file, header, 3);
+    for (const auto& entry : table) {
+        const uint64_t location[2] = { entry.offset, entry.byteSize };
+        const uint32_t count[2] = { entry.count, 0 };
+        writeValues(file, location, 2);
+        writeValues(file, count, 2);
+        writeValues(file, entry.bounds.min.data(), 3);
+        writeValues(file, entry.bounds.max.data(), 3);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+    timer.addBytes(offset);
+}
+
+size_t SceneChunk::byteSize() const {
+    return gaussians.positions.size() * sizeof(gaussians.positions[0])
+        + gaussians.logScales.size() * sizeof(gaussians.logScales[0])
+        + gaussians.rotQuats.size() * sizeof(gaussians.rotQuats[0])
+        + gaussians.opacityLogits.size() * sizeof(float)
+        + gaussians.shCoeffs.size() * sizeof(float)
+        + sourceIndices.size() * sizeof(uint32_t);
+}
+
+PagedScene::PagedScene(const std::string& filePath, const PagedSceneOptions& options)
+    : options(options), file(filePath), counters{}, predictedCamera{} {
+    const auto data = file.data();
+    if (data.size() < pagedHeaderSize || std::memcmp(data.data(), pagedMagic, 4) != 0) {
+        throw std::runtime_error("Not a paged scene file");
+    }
+    uint32_t version;
+    uint64_t header[3];
+    std::memcpy(&version, data.data() + 4, sizeof(version));
+    std::memcpy(header, data.data() + 8, sizeof(header));
+    if (version != pagedVersion) {
+        throw std::runtime_error("Unsupported paged scene version");
+    }
+    if (header[0] > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) || header[1] > 3
+        || header[2] > header[0] || pagedHeaderSize + header[2] * pagedEntrySize > data.size()) {
+        throw std::runtime_error("Invalid paged scene header");
+    }
+    totalSplats = header[0];
+    shDegree = static_cast<int>(header[1]);
+
+    chunkTable.resize(header[2]);
+    uint64_t splatsSeen = 0;
+    for (size_t c = 0; c < chunkTable.size(); ++c) {
+        const uint8_t* entry = data.data() + pagedHeaderSize + c * pagedEntrySize;
+        auto& info = chunkTable[c];
+        std::memcpy(&info.offset, entry, sizeof(uint64_t));
+        std::memcpy(&info.byteSize, entry + 8, sizeof(uint64_t));
+        std::memcpy(&info.count, entry + 16, sizeof(uint32_t));
+        std::memcpy(info.bounds.min.data(), entry + 24, 3 * sizeof(float));
+        std::memcpy(info.bounds.max.data(), entry + 36, 3 * sizeof(float));
+        if (info.byteSize != chunkPayloadSize(info.count, shDegree) || info.offset > data.size() || info.byteSize > data.size() - info.offset) {
+            throw std::runtime_error("Invalid paged scene chunk table");
+        }
+        splatsSeen += info.count;
+    }
+    if (splatsSeen != totalSplats) {
+        throw std::runtime_error("Invalid paged scene chunk table");
+    }
+
+    entries.resize(chunkTable.size());
+    loading.resize(chunkTable.size(), false);
+    if (options.prefetch) {
+        prefetcher = std::thread(&PagedScene::prefetchLoop, this);
+    }
+}
+
+PagedScene::~PagedScene() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (prefetcher.joinable()) {
+        prefetcher.join();
+    }
+}
+
+int PagedScene::sphericalHarmonicsDegree() const {
+    return shDegree;
+}
+
+size_t PagedScene::splatCount() const {
+    return totalSplats;
+}
+
+const std::vector<PagedChunkInfo>& PagedScene::chunks() const {
+    return chunkTable;
+}
+
+std::shared_ptr<SceneChunk> PagedScene::readChunk(uint32_t chunk) {
+    ScopedTimer timer("readChunk");
+    const auto& info = chunkTable[chunk];
+    const size_t count = info.count;
+    const auto payload = file.data().subspan(info.offset, info.byteSize);
+
+    auto result = std::make_shared<SceneChunk>();
+    result->index = chunk;
+    auto& g = result->gaussians;
+    g.numGaussians = static_cast<int>(count);
+    g.sphericalHarmonicsDegree = shDegree;
+    g.shLayout = ShLayout::Interleaved;
+    g.positions.resize(count);
+    g.logScales.resize(count);
+    g.rotQuats.resize(count);
+    g.opacityLogits.resize(count);
+    g.shCoeffs.resize(count * g.nShCoeffs() * 3);
+    result->sourceIndices.resize(count);
+
+    size_t cursor = 0;
+    auto copyColumn = [&](void* destination, size_t bytes) {
+        std::memcpy(destination, payload.data() + cursor, bytes);
+        cursor += bytes;
+    };
+    copyColumn(g.positions.data(), count * sizeof(g.positions[0]));
+    copyColumn(g.logScales.data(), count * sizeof(g.logScales[0]));
+    copyColumn(g.rotQuats.data(), count * sizeof(g.rotQuats[0]));
+    copyColumn(g.opacityLogits.data(), count * sizeof(float));
+    copyColumn(g.shCoeffs.data(), g.shCoeffs.size() * sizeof(float));
+    copyColumn(result->sourceIndices.data(), count * sizeof(uint32_t));
+
+    // The copy is what counts against the budget, not the file's pages.
+    file.release(payload);
+    timer.addBytes(info.byteSize);
+    return result;
+}
+
+bool PagedScene::makeRoom(size_t bytes, float minEvictDistance, bool evict) {
+    size_t freed = 0;
+    auto candidate = lru.end();
+    while (counters.residentBytes - freed + bytes > options.memoryBudget) {
+        // Least recently used first, skipping chunks at most minEvictDistance
+        // from the predicted camera.
+        do {
+            if (candidate == lru.begin()) {
+                return false;
+            }
+            --candidate;
+        } while (boxDistance(chunkTable[*candidate].bounds, predictedCamera) <= minEvictDistance);
+        freed += entries[*candidate].chunk->byteSize();
+    }
+    if (!evict) {
+        return true;
+    }
+
+    while (counters.residentBytes + bytes > options.memoryBudget) {
+        auto victim = std::prev(lru.end());
+        while (boxDistance(chunkTable[*victim].bounds, predictedCamera) <= minEvictDistance) {
+            --victim;
+        }
+        auto& entry = entries[*victim];
+        counters.residentBytes -= entry.chunk->byteSize();
+        entry.chunk.reset();
+        lru.erase(victim);
+        ++counters.evictions;
+    }
+    return true;
+}
+
+void PagedScene::insert(uint32_t chunk, std::shared_ptr<SceneChunk> loaded, bool prefetched) {
+    auto& entry = entries[chunk];
+    counters.residentBytes += loaded->byteSize();
+    counters.peakResidentBytes = std::max(counters.peakResidentBytes, counters.residentBytes);
+    counters.bytesRead += chunkTable[chunk].byteSize;
+    entry.chunk = std::move(loaded);
+    entry.prefetched = prefetched;
+    lru.push_front(chunk);
+    entry.lruPosition = lru.begin();
+}
+
+std::shared_ptr<const SceneChunk> PagedScene::acquire(uint32_t chunk) {
+    if (chunk >= chunkTable.size()) {
+        throw std::out_of_range("Chunk index out of range");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return !loading[chunk]; });
+    auto& entry = entries[chunk];
+    if (entry.chunk) {
+        ++counters.hits;
+        if (entry.prefetched) {
+            ++counters.prefetchHits;
+            entry.prefetched = false;
+        }
+        lru.splice(lru.begin(), lru, entry.lruPosition);
+        return entry.chunk;
+    }
+
+    ++counters.misses;
+    loading[chunk] = true;
+    lock.unlock();
+    std::shared_ptr<SceneChunk> loaded;
+    try {
+        loaded = readChunk(chunk);
+    }
+    catch (...) {
+        lock.lock();
+        loading[chunk] = false;
+        changed.notify_all();
+        throw;
+    }
+    lock.lock();
+    loading[chunk] = false;
+    // A chunk larger than the whole budget is still handed out, just not kept.
+    if (makeRoom(loaded->byteSize(), -std::numeric_limits<float>::infinity(), true)) {
+        insert(chunk, loaded, false);
+    }
+    else {
+        counters.bytesRead += chunkTable[chunk].byteSize;
+    }
+    changed.notify_all();
+    return loaded;
+}
+
+std::vector<std::shared_ptr<const SceneChunk>> PagedScene::acquireBox(const Aabb& box) {
+    std::vector<std::shared_ptr<const SceneChunk>> result;
+    for (uint32_t c = 0; c < chunkTable.size(); ++c) {
+        if (boxesOverlap(chunkTable[c].bounds, box)) {
+            result.push_back(acquire(c));
+        }
+    }
+    return result;
+}
+
+std::vector<std::shared_ptr<const SceneChunk>> PagedScene::acquireNear(const std::array<float, 3>& center, float radius) {
+    std::vector<std::pair<float, uint32_t>> near;
+    for (uint32_t c = 0; c < chunkTable.size(); ++c) {
+        const float distance = boxDistance(chunkTable[c].bounds, center);
+        if (distance <= radius) {
+            near.push_back({ distance, c });
+        }
+    }
+    std::sort(near.begin(), near.end());
+
+    std::vector<std::shared_ptr<const SceneChunk>> result;
+    result.reserve(near.size());
+    for (const auto& [distance, c] : near) {
+        result.push_back(acquire(c));
+    }
+    return result;
+}
+
+bool PagedScene::resident(uint32_t chunk) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunk < entries.size() && entries[chunk].chunk != nullptr;
+}
+
+void PagedScene::updateCamera(const std::array<float, 3>& position, const std::array<float, 3>& velocity) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int axis = 0; axis < 3; ++axis) {
+            predictedCamera[axis] = position[axis] + velocity[axis] * options.lookaheadSeconds;
+        }
+        ++cameraVersion;
+    }
+    changed.notify_all();
+}
+
+PagedSceneStats PagedScene::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void PagedScene::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t resident = counters.residentBytes;
+    counters = {};
+    counters.residentBytes = resident;
+    counters.peakResidentBytes = resident;
+}
+
+void PagedScene::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t seenVersion = 0;
+    while (true) {
+        changed.wait(lock, [&] { return stopping || cameraVersion != seenVersion; });
+        if (stopping) {
+            return;
+        }
+        seenVersion = cameraVersion;
+
+        std::vector<std::pair<float, uint32_t>> wanted;
+        for (uint32_t c = 0; c < chunkTable.size(); ++c) {
+            const float distance = boxDistance(chunkTable[c].bounds, predictedCamera);
+            if (distance <= options.prefetchRadius && !entries[c].chunk) {
+                wanted.push_back({ distance, c });
+            }
+        }
+        std::sort(wanted.begin(), wanted.end());
+
+        for (const auto& [distance, c] : wanted) {
+            if (stopping || cameraVersion != seenVersion) {
+                break;
+            }
+            if (entries[c].chunk || loading[c]) {
+                continue;
+            }
+            // Everything after this chunk is farther away, so once it does
+            // not fit nothing else will.
+            const size_t bytes = chunkPayloadSize(chunkTable[c].count, shDegree);
+            if (!makeRoom(bytes, distance, false)) {
+                break;
+            }
+
+            loading[c] = true;
+            lock.unlock();
+            std::shared_ptr<SceneChunk> loaded;
+            try {
+                loaded = readChunk(c);
+            }
+            catch (const std::exception& e) {
+                logMessage(LogLevel::Error, std::string("Prefetching a chunk failed: ") + e.what());
+            }
+            lock.lock();
+            loading[c] = false;
+            if (loaded && makeRoom(bytes, distance, true)) {
+                insert(c, std::move(loaded), true);
+                ++counters.prefetched;
+            }
+            changed.notify_all();
+        }
+    }
+}
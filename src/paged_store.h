@@ -0,0 +1,130 @@
+#ifndef PAGED_STORE_H
+#define PAGED_STORE_H
+
+#include "ply.h"
+#include "bvh.h"
+#include "mapped_file.h"
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <list>
+#include <cstdint>
+
+struct PagedSceneWriteOptions {
+    // Splats per chunk; the last chunk of a region may hold fewer.
+    int chunkSplats = 1 << 16;
+};
+
+// Splits the scene into spatially coherent chunks by recursive median splits
+// along the longest axis and writes them as one file: a chunk table with the
+// 3-sigma bounds of every chunk, followed by one page-aligned block of SoA
+// columns per chunk, in host byte order.
+void writePagedScene(const std::string& filePath, const PackedGaussians& gaussians, const PagedSceneWriteOptions& options = {});
+
+struct PagedChunkInfo {
+    uint64_t offset;
+    uint64_t byteSize;
+    uint32_t count;
+    Aabb bounds;
+};
+
+// A resident chunk: its splats as a scene of their own, and the index of each
+// in the scene the file was written from.
+struct SceneChunk {
+    uint32_t index;
+    PackedGaussians gaussians;
+    std::vector<uint32_t> sourceIndices;
+
+    size_t byteSize() const;
+};
+
+struct PagedSceneOptions {
+    // Resident chunk bytes the store keeps. A chunk still referenced by a
+    // caller stays alive after eviction but no longer counts.
+    size_t memoryBudget = size_t(1) << 30;
+    bool prefetch = true;
+    // Prefetching targets chunks within this distance of the camera position
+    // predicted lookaheadSeconds ahead, nearest first.
+    float prefetchRadius = 50.0f;
+    float lookaheadSeconds = 1.0f;
+};
+
+struct PagedSceneStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t prefetched;
+    // Hits on chunks loaded by the prefetcher that had not been used yet.
+    uint64_t prefetchHits;
+    uint64_t evictions;
+    uint64_t bytesRead;
+    size_t residentBytes;
+    size_t peakResidentBytes;
+};
+
+// Chunks of a file written by writePagedScene, paged in on demand under a
+// byte budget. Eviction is least recently used. The prefetcher thread only
+// evicts chunks farther from the predicted camera than the one it loads, so
+// it never pushes out what the camera is about to need.
+class PagedScene {
+public:
+    explicit PagedScene(const std::string& filePath, const PagedSceneOptions& options = {});
+    ~PagedScene();
+
+    PagedScene(const PagedScene&) = delete;
+    PagedScene& operator=(const PagedScene&) = delete;
+
+    int sphericalHarmonicsDegree() const;
+    size_t splatCount() const;
+    const std::vector<PagedChunkInfo>& chunks() const;
+
+    // Returns the chunk, loading it first if it is not resident.
+    std::shared_ptr<const SceneChunk> acquire(uint32_t chunk);
+    std::vector<std::shared_ptr<const SceneChunk>> acquireBox(const Aabb& box);
+    std::vector<std::shared_ptr<const SceneChunk>> acquireNear(const std::array<float, 3>& center, float radius);
+    bool resident(uint32_t chunk) const;
+
+    // Tells the prefetcher where the camera is and how it is moving.
+    void updateCamera(const std::array<float, 3>& position, const std::array<float, 3>& velocity);
+
+    PagedSceneStats stats() const;
+    void resetStats();
+
+private:
+    struct Entry {
+        std::shared_ptr<const SceneChunk> chunk;
+        std::list<uint32_t>::iterator lruPosition;
+        bool prefetched;
+    };
+
+    PagedSceneOptions options;
+    MappedFile file;
+    int shDegree;
+    size_t totalSplats;
+    std::vector<PagedChunkInfo> chunkTable;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Entry> entries;
+    std::vector<bool> loading;
+    // Resident chunks, most recently used first.
+    std::list<uint32_t> lru;
+    PagedSceneStats counters;
+
+    std::array<float, 3> predictedCamera;
+    uint64_t cameraVersion = 0;
+    bool stopping = false;
+    std::thread prefetcher;
+
+    std::shared_ptr<SceneChunk> readChunk(uint32_t chunk);
+    // Whether `bytes` more fit after evicting only chunks farther than
+    // minEvictDistance from the predicted camera; evicts them if `evict`.
+    bool makeRoom(size_t bytes, float minEvictDistance, bool evict);
+    void insert(uint32_t chunk, std::shared_ptr<SceneChunk> loaded, bool prefetched);
+    void prefetchLoop();
+};
+
+#endif // PAGED_STORE_H
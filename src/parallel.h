@@ -0,0 +1,120 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+// Thread counts of 0 or less mean "use every hardware thread".
+inline int resolveThreadCount(int nThreads) {
+    if (nThreads > 0) {
+        return nThreads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// Number of slices parallelFor splits `count` items into.
+inline int parallelSlices(size_t count, int nThreads) {
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(resolveThreadCount(nThreads), count)));
+}
+
+// Runs fn(slice, begin, end) over parallelSlices(count, nThreads) contiguous
+// slices of [0, count), one thread per slice, and waits for all of them.
+template <typename Fn>
+void parallelFor(size_t count, int nThreads, Fn&& fn) {
+    const int nSlices = parallelSlices(count, nThreads);
+    if (nSlices == 1) {
+        fn(0, size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(nSlices);
+    for (int slice = 0; slice < nSlices; ++slice) {
+        const size_t begin = count * slice / nSlices;
+        const size_t end = count * (slice + 1) / nSlices;
+        workers.emplace_back([&fn, slice, begin, end] { fn(slice, begin, end); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Runs fn(item, worker) for every item in [0, count) on parallelSlices(count,
+// nThreads) workers. Each worker starts on its own contiguous block and takes
+// items from the front of it; a worker that runs dry steals the back half of
+// another worker's remaining block, so uneven items still balance out.
+template <typename Fn>
+void workStealingFor(size_t count, int nThreads, Fn&& fn) {
+    const int nWorkers = parallelSlices(count, nThreads);
+    if (nWorkers == 1) {
+        for (size_t item = 0; item < count; ++item) {
+            fn(item, 0);
+        }
+        return;
+    }
+
+    // Remaining block of each worker, packed as (begin << 32) | end so owner
+    // and thieves can update it with a single compare-and-swap.
+    auto blocks = std::make_unique<std::atomic<uint64_t>[]>(nWorkers);
+    for (int worker = 0; worker < nWorkers; ++worker) {
+        const uint64_t begin = count * worker / nWorkers;
+        const uint64_t end = count * (worker + 1) / nWorkers;
+        blocks[worker].store((begin << 32) | end);
+    }
+
+    auto takeFront = [&](int worker, size_t& item) {
+        uint64_t block = blocks[worker].load();
+        while (true) {
+            const uint64_t begin = block >> 32, end = block & 0xffffffffu;
+            if (begin >= end) {
+                return false;
+            }
+            if (blocks[worker].compare_exchange_weak(block, ((begin + 1) << 32) | end)) {
+                item = begin;
+                return true;
+            }
+        }
+    };
+
+    auto stealBack = [&](int thief) {
+        for (int offset = 1; offset < nWorkers; ++offset) {
+            const int victim = (thief + offset) % nWorkers;
+            uint64_t block = blocks[victim].load();
+            while (true) {
+                const uint64_t begin = block >> 32, end = block & 0xffffffffu;
+                if (begin >= end) {
+                    break;
+                }
+                const uint64_t middle = end - (end - begin + 1) / 2;
+                if (blocks[victim].compare_exchange_weak(block, (begin << 32) | middle)) {
+                    blocks[thief].store((middle << 32) | end);
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(nWorkers);
+    for (int worker = 0; worker < nWorkers; ++worker) {
+        workers.emplace_back([&, worker] {
+            size_t item;
+            do {
+                while (takeFront(worker, item)) {
+                    fn(item, worker);
+                }
+            } while (stealBack(worker));
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif // PARALLEL_H
@@ -1,78 +1,324 @@
 #include "ply.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "simd.h"
+#include "sorting.h"
+#include "trace.h"
 #include <fstream>
-#include <iostream>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <optional>
+#include <charconv>
+#include <limits>
+#include <bit>
+#include <atomic>
 
-std::tuple<int, std::map<std::string, std::string>, std::span<const uint8_t>, std::map<int, std::string>> PackedGaussians::decodeHeader(std::span<const uint8_t> plyArrayBuffer) {
-    std::string headerText;
-    size_t headerOffset = 0;
+#if HAS_X86_SIMD
+#include <immintrin.h>
+#endif
 
-    while (headerOffset < plyArrayBuffer.size()) {
-        headerText += std::string(plyArrayBuffer.begin() + headerOffset, plyArrayBuffer.begin() + headerOffset + 50);
-        headerOffset += 50;
+size_t plyScalarSize(PlyScalarType type) {
+    switch (type) {
+    case PlyScalarType::Char:
+    case PlyScalarType::UChar: return 1;
+    case PlyScalarType::Short:
+    case PlyScalarType::UShort: return 2;
+    case PlyScalarType::Int:
+    case PlyScalarType::UInt:
+    case PlyScalarType::Float: return 4;
+    case PlyScalarType::Double: return 8;
+    }
+    throw std::invalid_argument("Unknown PLY scalar type");
+}
 
-        if (headerText.find("end_header") != std::string::npos) {
-            break;
+static PlyScalarType parseScalarType(const std::string& name) {
+    static const std::map<std::string, PlyScalarType> scalarTypes = {
+        { "char", PlyScalarType::Char }, { "int8", PlyScalarType::Char },
+        { "uchar", PlyScalarType::UChar }, { "uint8", PlyScalarType::UChar },
+        { "short", PlyScalarType::Short }, { "int16", PlyScalarType::Short },
+        { "ushort", PlyScalarType::UShort }, { "uint16", PlyScalarType::UShort },
+        { "int", PlyScalarType::Int }, { "int32", PlyScalarType::Int },
+        { "uint", PlyScalarType::UInt }, { "uint32", PlyScalarType::UInt },
+        { "float", PlyScalarType::Float }, { "float32", PlyScalarType::Float },
+        { "double", PlyScalarType::Double }, { "float64", PlyScalarType::Double },
+    };
+    auto it = scalarTypes.find(name);
+    if (it == scalarTypes.end()) {
+        throw std::runtime_error("Unsupported PLY property type " + name);
+    }
+    return it->second;
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyScalarType type;
+    bool isList;
+    PlyScalarType countType;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+static std::vector<std::string_view> splitHeaderLine(std::string_view line) {
+    std::vector<std::string_view> tokens;
+    size_t position = 0;
+    while (true) {
+        position = line.find_first_not_of(" \t\r", position);
+        if (position == std::string_view::npos) {
+            return tokens;
+        }
+        const size_t tokenEnd = std::min(line.find_first_of(" \t\r", position), line.size());
+        tokens.push_back(line.substr(position, tokenEnd - position));
+        position = tokenEnd;
+    }
+}
+
+// Any scalar in the file's byte order as a double; only used off the hot path.
+static double readBinaryValue(const uint8_t* source, PlyScalarType type, bool byteSwapped) {
+    uint8_t bytes[8];
+    const size_t size = plyScalarSize(type);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = source[byteSwapped ? size - 1 - i : i];
+    }
+    switch (type) {
+    case PlyScalarType::Char: return static_cast<int8_t>(bytes[0]);
+    case PlyScalarType::UChar: return bytes[0];
+    case PlyScalarType::Short: { int16_t value; std::memcpy(&value, bytes, 2); return value; }
+    case PlyScalarType::UShort: { uint16_t value; std::memcpy(&value, bytes, 2); return value; }
+    case PlyScalarType::Int: { int32_t value; std::memcpy(&value, bytes, 4); return value; }
+    case PlyScalarType::UInt: { uint32_t value; std::memcpy(&value, bytes, 4); return value; }
+    case PlyScalarType::Float: { float value; std::memcpy(&value, bytes, 4); return value; }
+    case PlyScalarType::Double: { double value; std::memcpy(&value, bytes, 8); return value; }
+    }
+    return 0.0;
+}
+
+// Byte offset just past the records of an element that precedes the vertex
+// element in a binary file.
+static size_t skipBinaryElement(const PlyElement& element, std::span<const uint8_t> data, size_t offset, bool byteSwapped) {
+    bool hasLists = false;
+    size_t recordSize = 0;
+    for (const auto& property : element.properties) {
+        hasLists = hasLists || property.isList;
+        recordSize += plyScalarSize(property.type);
+    }
+    if (!hasLists) {
+        if (recordSize != 0 && element.count > (data.size() - offset) / recordSize) {
+            throw std::runtime_error("PLY element " + element.name + " is shorter than the header declares");
         }
+        return offset + element.count * recordSize;
     }
 
-    size_t header_end = headerText.find("end_header");
-    std::vector<std::string> headerLines;
-    size_t pos = 0;
-    while ((pos = headerText.find('\n')) != std::string::npos) {
-        headerLines.push_back(headerText.substr(0, pos));
-        headerText.erase(0, pos + 1);
+    for (size_t record = 0; record < element.count; ++record) {
+        for (const auto& property : element.properties) {
+            size_t size = plyScalarSize(property.type);
+            if (property.isList) {
+                const size_t countSize = plyScalarSize(property.countType);
+                if (data.size() - offset < countSize) {
+                    throw std::runtime_error("PLY element " + element.name + " is shorter than the header declares");
+                }
+                const double count = readBinaryValue(data.data() + offset, property.countType, byteSwapped);
+                if (count < 0) {
+                    throw std::runtime_error("Negative list length in PLY element " + element.name);
+                }
+                offset += countSize;
+                size *= static_cast<size_t>(count);
+            }
+            if (data.size() - offset < size) {
+                throw std::runtime_error("PLY element " + element.name + " is shorter than the header declares");
+            }
+            offset += size;
+        }
     }
+    return offset;
+}
 
-    int vertexCount = 0;
-    std::map<std::string, std::string> propertyTypes;
-    std::map<int, std::string> intKeys; // To store integer-like keys
-    int key = 0;
+PlyHeader PackedGaussians::decodeHeader(std::span<const uint8_t> plyArrayBuffer, int maxShDegree) {
+    ScopedTimer timer("decodeHeader");
+    const std::string_view text(reinterpret_cast<const char*>(plyArrayBuffer.data()), plyArrayBuffer.size());
+    std::optional<PlyFormat> format;
+    std::vector<PlyElement> elements;
+    size_t dataOffset = 0;
+    bool ended = false;
 
-    for (const auto& line : headerLines) {
-        std::string trimmedLine = line;
-        trimmedLine.erase(trimmedLine.find_last_not_of(" \n\r\t") + 1);
-        if (trimmedLine.find("element vertex") == 0) {
-            vertexCount = std::stoi(trimmedLine.substr(15));
+    for (int lineNumber = 0; !ended; ++lineNumber) {
+        const size_t lineEnd = text.find('\n', dataOffset);
+        if (lineEnd == std::string_view::npos) {
+            throw std::runtime_error("PLY header is not terminated by end_header");
         }
-        else if (trimmedLine.find("property") == 0) {
-            size_t firstSpace = trimmedLine.find(' ');
-            size_t secondSpace = trimmedLine.find(' ', firstSpace + 1);
-            std::string propertyType = trimmedLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
-            std::string propertyName = trimmedLine.substr(secondSpace + 1);
-            propertyTypes[propertyName] = propertyType;
-            intKeys[key] = propertyName;
-            key++;
+        const auto tokens = splitHeaderLine(text.substr(dataOffset, lineEnd - dataOffset));
+        dataOffset = lineEnd + 1;
+
+        if (lineNumber == 0) {
+            if (tokens.size() != 1 || tokens[0] != "ply") {
+                throw std::runtime_error("Not a PLY file");
+            }
+            continue;
         }
-        else if (trimmedLine == "end_header") {
-            break;
+        if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") {
+            continue;
+        }
+
+        if (tokens[0] == "format" && tokens.size() == 3) {
+            if (tokens[1] == "binary_little_endian") {
+                format = PlyFormat::BinaryLittleEndian;
+            }
+            else if (tokens[1] == "binary_big_endian") {
+                format = PlyFormat::BinaryBigEndian;
+            }
+            else if (tokens[1] == "ascii") {
+                format = PlyFormat::Ascii;
+            }
+            else {
+                throw std::runtime_error("Unsupported PLY format " + std::string(tokens[1]));
+            }
+        }
+        else if (tokens[0] == "element" && tokens.size() == 3) {
+            size_t count = 0;
+            const auto [end, error] = std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), count);
+            if (error != std::errc() || end != tokens[2].data() + tokens[2].size()) {
+                throw std::runtime_error("Invalid count for PLY element " + std::string(tokens[1]));
+            }
+            elements.push_back({ std::string(tokens[1]), count, {} });
+        }
+        else if (tokens[0] == "property" && tokens.size() == 3 && !elements.empty()) {
+            elements.back().properties.push_back({ std::string(tokens[2]), parseScalarType(std::string(tokens[1])), false, PlyScalarType::UChar });
+        }
+        else if (tokens[0] == "property" && tokens.size() == 5 && tokens[1] == "list" && !elements.empty()) {
+            elements.back().properties.push_back({ std::string(tokens[4]), parseScalarType(std::string(tokens[3])), true, parseScalarType(std::string(tokens[2])) });
+        }
+        else if (tokens[0] == "end_header" && tokens.size() == 1) {
+            ended = true;
         }
+        else {
+            throw std::runtime_error("Invalid PLY header line " + std::to_string(lineNumber + 1));
+        }
+    }
+
+    if (!format) {
+        throw std::runtime_error("PLY header has no format line");
+    }
+    auto vertexElement = std::find_if(elements.begin(), elements.end(), [](const PlyElement& element) { return element.name == "vertex"; });
+    if (vertexElement == elements.end()) {
+        throw std::runtime_error("PLY file has no vertex element");
+    }
+    if (vertexElement->count > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error("Too many vertices in PLY file");
     }
 
-    size_t vertexByteOffset = header_end + std::string("end_header").length() + 1;
-    auto vertexData = std::span<const uint8_t>(plyArrayBuffer.begin() + vertexByteOffset, plyArrayBuffer.end());
+    std::vector<std::pair<std::string, PlyScalarType>> properties;
+    for (const auto& property : vertexElement->properties) {
+        if (property.isList) {
+            throw std::runtime_error("Unsupported list property " + property.name + " in vertex element");
+        }
+        properties.emplace_back(property.name, property.type);
+    }
+    VertexLayout layout = compileVertexLayout(properties, maxShDegree);
+    layout.byteSwapped = *format != PlyFormat::Ascii && (*format == PlyFormat::BinaryBigEndian) != (std::endian::native == std::endian::big);
+
+    // Skip the elements stored before the vertices.
+    for (auto element = elements.begin(); element != vertexElement; ++element) {
+        if (*format != PlyFormat::Ascii) {
+            dataOffset = skipBinaryElement(*element, plyArrayBuffer, dataOffset, layout.byteSwapped);
+            continue;
+        }
+        for (size_t line = 0; line < element->count; ++line) {
+            const size_t lineEnd = text.find('\n', dataOffset);
+            if (lineEnd == std::string_view::npos) {
+                throw std::runtime_error("PLY element " + element->name + " is shorter than the header declares");
+            }
+            dataOffset = lineEnd + 1;
+        }
+    }
 
-    return { vertexCount, propertyTypes, vertexData, intKeys };
+    timer.addBytes(dataOffset);
+    return { static_cast<int>(vertexElement->count), std::move(layout), plyArrayBuffer.subspan(dataOffset), *format };
 }
 
-std::tuple<size_t, std::map<std::string, float>> PackedGaussians::readRawVertex(size_t offset, std::span<const uint8_t> vertexData, const std::map<std::string, std::string>& propertyTypes, std::map<int, std::string> intKeys) {
-    std::map<std::string, float> rawVertex;
+VertexLayout PackedGaussians::compileVertexLayout(const std::vector<std::pair<std::string, PlyScalarType>>& properties, int maxShDegree) {
+    static const std::map<std::string, std::pair<VertexField, int>> namedSlots = {
+        { "x", { VertexField::Position, 0 } },
+        { "y", { VertexField::Position, 1 } },
+        { "z", { VertexField::Position, 2 } },
+        { "scale_0", { VertexField::LogScale, 0 } },
+        { "scale_1", { VertexField::LogScale, 1 } },
+        { "scale_2", { VertexField::LogScale, 2 } },
+        { "rot_0", { VertexField::RotQuat, 0 } },
+        { "rot_1", { VertexField::RotQuat, 1 } },
+        { "rot_2", { VertexField::RotQuat, 2 } },
+        { "rot_3", { VertexField::RotQuat, 3 } },
+        { "opacity", { VertexField::OpacityLogit, 0 } },
+        { "f_dc_0", { VertexField::ShCoeff, 0 } },
+        { "f_dc_1", { VertexField::ShCoeff, 1 } },
+        { "f_dc_2", { VertexField::ShCoeff, 2 } },
+    };
+
+    int nRestCoeffs = 0;
+    for (const auto& [propertyName, propertyType] : properties) {
+        if (propertyName.find("f_rest_") == 0) {
+            nRestCoeffs++;
+        }
+    }
+    int nCoeffsPerColor = nRestCoeffs / 3;
+
+    VertexLayout layout;
+    const int fileShDegree = static_cast<int>(std::sqrt(nCoeffsPerColor + 1) - 1);
+    layout.sphericalHarmonicsDegree = std::clamp(maxShDegree, 0, fileShDegree);
+    const int nCoeffs = (layout.sphericalHarmonicsDegree + 1) * (layout.sphericalHarmonicsDegree + 1);
 
-    for (const auto& [key, property] : intKeys) {
-        std::string propertyType = propertyTypes.at(property);
-        if (propertyType == "float") {
-            float value;
-            std::memcpy(&value, vertexData.data() + offset, sizeof(float));
-            rawVertex[property] = value;
-            offset += sizeof(float);
+    size_t offset = 0;
+    int nNamedSlots = 0;
+    int property = -1;
+    for (const auto& [propertyName, propertyType] : properties) {
+        property++;
+        layout.propertyTypes.push_back(propertyType);
+        VertexField field;
+        int component;
+        auto named = namedSlots.find(propertyName);
+        if (named != namedSlots.end()) {
+            field = named->second.first;
+            component = named->second.second;
+            nNamedSlots++;
+        }
+        else if (propertyName.find("f_rest_") == 0 && nCoeffsPerColor > 0) {
+            // f_rest_ is stored channel-major: all coefficients of red, then green, then blue.
+            int restIndex = std::stoi(propertyName.substr(7));
+            int coeff = 1 + restIndex % nCoeffsPerColor;
+            int rgb = restIndex / nCoeffsPerColor;
+            field = VertexField::ShCoeff;
+            component = coeff * 3 + rgb;
+            if (coeff >= nCoeffs || rgb >= 3) {
+                offset += plyScalarSize(propertyType);
+                continue;
+            }
         }
-        else if (propertyType == "uchar") {
-            rawVertex[property] = vertexData[offset] / 255.0f;
-            offset += sizeof(uint8_t);
+        else {
+            offset += plyScalarSize(propertyType);
+            continue;
         }
+
+        layout.slots.push_back({ offset, propertyType, field, component, property });
+        offset += plyScalarSize(propertyType);
     }
+    layout.stride = offset;
 
-    return { offset, rawVertex };
+    if (nNamedSlots != static_cast<int>(namedSlots.size())) {
+        for (const auto& [name, slot] : namedSlots) {
+            bool found = false;
+            for (const auto& property : properties) {
+                found = found || property.first == name;
+            }
+            if (!found) {
+                throw std::runtime_error("Missing vertex property " + name);
+            }
+        }
+    }
+
+    return layout;
 }
 
 int PackedGaussians::nShCoeffs() const {
@@ -85,73 +331,406 @@ int PackedGaussians::nShCoeffs() const {
     }
 }
 
-std::map<std::string, std::vector<float>> PackedGaussians::arrangeVertex(const std::map<std::string, float>& rawVertex, const std::vector<std::string>& shFeatureOrder) {
-    std::vector<std::vector<float>> shCoeffs;
-    for (int i = 0; i < nShCoeffs(); ++i) {
-        std::vector<float> coeff;
-        for (int j = 0; j < 3; ++j) {
-            coeff.push_back(rawVertex.at(shFeatureOrder[i * 3 + j]));
+size_t PackedGaussians::shIndex(int splat, int coeff, int channel) const {
+    if (shLayout == ShLayout::Planar) {
+        return static_cast<size_t>(coeff * 3 + channel) * numGaussians + splat;
+    }
+    return (static_cast<size_t>(splat) * nShCoeffs() + coeff) * 3 + channel;
+}
+
+float PackedGaussians::shCoeff(int splat, int coeff, int channel) const {
+    return shCoeffs[shIndex(splat, coeff, channel)];
+}
+
+void PackedGaussians::setShLayout(ShLayout layout) {
+    if (layout == shLayout) {
+        return;
+    }
+    std::vector<float> reordered(shCoeffs.size());
+    const int nComponents = nShCoeffs() * 3;
+    for (int i = 0; i < numGaussians; ++i) {
+        for (int component = 0; component < nComponents; ++component) {
+            const size_t interleaved = static_cast<size_t>(i) * nComponents + component;
+            const size_t planar = static_cast<size_t>(component) * numGaussians + i;
+            if (layout == ShLayout::Planar) {
+                reordered[planar] = shCoeffs[interleaved];
+            }
+            else {
+                reordered[interleaved] = shCoeffs[planar];
+            }
         }
-        shCoeffs.push_back(coeff);
     }
+    shCoeffs = std::move(reordered);
+    shLayout = layout;
+}
 
-    std::map<std::string, std::vector<float>> arrangedVertex;
-    arrangedVertex["position"] = { rawVertex.at("x"), rawVertex.at("y"), rawVertex.at("z") };
-    arrangedVertex["logScale"] = { rawVertex.at("scale_0"), rawVertex.at("scale_1"), rawVertex.at("scale_2") };
-    arrangedVertex["rotQuat"] = { rawVertex.at("rot_0"), rawVertex.at("rot_1"), rawVertex.at("rot_2"), rawVertex.at("rot_3") };
-    arrangedVertex["opacityLogit"] = { rawVertex.at("opacity") };
-    arrangedVertex["shCoeffs"] = std::vector<float>();
-    for (const auto& coeff : shCoeffs) {
-        arrangedVertex["shCoeffs"].insert(arrangedVertex["shCoeffs"].end(), coeff.begin(), coeff.end());
+void PackedGaussians::truncateShDegree(int degree) {
+    if (degree < 0) {
+        throw std::invalid_argument("Unsupported SH degree");
+    }
+    if (degree >= sphericalHarmonicsDegree) {
+        return;
     }
+    const size_t oldComponents = static_cast<size_t>(nShCoeffs()) * 3;
+    sphericalHarmonicsDegree = degree;
+    const size_t newComponents = static_cast<size_t>(nShCoeffs()) * 3;
+    // Planar keeps the planes of the lower bands first, so only interleaved
+    // coefficients have to move.
+    if (shLayout == ShLayout::Interleaved) {
+        for (int i = 0; i < numGaussians; ++i) {
+            std::copy_n(shCoeffs.begin() + i * oldComponents, newComponents, shCoeffs.begin() + i * newComponents);
+        }
+    }
+    shCoeffs.resize(newComponents * numGaussians);
+    shCoeffs.shrink_to_fit();
+}
 
-    return arrangedVertex;
+// permuted[k * width + j] = values[order[k] * width + j] for every column
+// of `width` values per splat.
+template <typename T>
+static void gatherRows(std::vector<T>& values, std::span<const uint32_t> order, size_t width, int nThreads) {
+    std::vector<T> permuted(values.size());
+    parallelFor(order.size(), nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            // The rows are read in random order; fetch them a few splats ahead.
+            if (k + 8 < end) {
+                const T* ahead = values.data() + order[k + 8] * width;
+                for (size_t line = 0; line < width * sizeof(T); line += 64) {
+                    __builtin_prefetch(reinterpret_cast<const char*>(ahead) + line);
+                }
+            }
+            std::copy_n(values.begin() + order[k] * width, width, permuted.begin() + k * width);
+        }
+    });
+    values.swap(permuted);
 }
 
-PackedGaussians::PackedGaussians(std::span<const uint8_t> arrayBuffer) {
-    auto [vertexCount, propertyTypes, vertexData, intKeys] = decodeHeader(arrayBuffer);
-    numGaussians = vertexCount;
+void PackedGaussians::permute(std::span<const uint32_t> order, int nThreads) {
+    ScopedTimer timer("permute");
+    if (order.size() != static_cast<size_t>(numGaussians)) {
+        throw std::invalid_argument("Permutation size does not match the splat count");
+    }
+    gatherRows(positions, order, 1, nThreads);
+    gatherRows(logScales, order, 1, nThreads);
+    gatherRows(rotQuats, order, 1, nThreads);
+    gatherRows(opacityLogits, order, 1, nThreads);
+    if (shLayout == ShLayout::Interleaved) {
+        gatherRows(shCoeffs, order, nShCoeffs() * 3, nThreads);
+    }
+    else {
+        std::vector<float> permuted(shCoeffs.size());
+        const size_t n = numGaussians;
+        parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+            for (size_t plane = 0; plane < static_cast<size_t>(nShCoeffs()) * 3; ++plane) {
+                const float* source = shCoeffs.data() + plane * n;
+                float* destination = permuted.data() + plane * n;
+                for (size_t k = begin; k < end; ++k) {
+                    destination[k] = source[order[k]];
+                }
+            }
+        });
+        shCoeffs.swap(permuted);
+    }
+    if (sourceIndices.empty()) {
+        sourceIndices.assign(order.begin(), order.end());
+    }
+    else {
+        gatherRows(sourceIndices, order, 1, nThreads);
+    }
+}
 
-    int nRestCoeffs = 0;
-    for (const auto& [propertyName, propertyType] : propertyTypes) {
-        if (propertyName.find("f_rest_") == 0) {
-            nRestCoeffs++;
+static inline float readScalar(const uint8_t* source, PlyScalarType type) {
+    if (type == PlyScalarType::Float) {
+        float value;
+        std::memcpy(&value, source, sizeof(float));
+        return value;
+    }
+    switch (type) {
+    case PlyScalarType::UChar: return source[0] / 255.0f;
+    case PlyScalarType::Char: return static_cast<int8_t>(source[0]);
+    case PlyScalarType::Short: { int16_t value; std::memcpy(&value, source, 2); return value; }
+    case PlyScalarType::UShort: { uint16_t value; std::memcpy(&value, source, 2); return value; }
+    case PlyScalarType::Int: { int32_t value; std::memcpy(&value, source, 4); return static_cast<float>(value); }
+    case PlyScalarType::UInt: { uint32_t value; std::memcpy(&value, source, 4); return static_cast<float>(value); }
+    case PlyScalarType::Double: { double value; std::memcpy(&value, source, 8); return static_cast<float>(value); }
+    default: return 0.0f;
+    }
+}
+
+float readVertexScalar(const uint8_t* vertex, const VertexSlot& slot, bool byteSwapped) {
+    if (!byteSwapped) {
+        return readScalar(vertex + slot.byteOffset, slot.type);
+    }
+    uint8_t bytes[8];
+    const size_t size = plyScalarSize(slot.type);
+    for (size_t b = 0; b < size; ++b) {
+        bytes[b] = vertex[slot.byteOffset + size - 1 - b];
+    }
+    return readScalar(bytes, slot.type);
+}
+
+#if HAS_X86_SIMD
+__attribute__((target("avx2")))
+static size_t byteSwapWordsAvx2(const uint8_t* source, uint8_t* target, size_t size, size_t wordSize) {
+    // vpshufb works within 16-byte lanes, which every word size divides.
+    alignas(32) uint8_t pattern[32];
+    for (int i = 0; i < 32; ++i) {
+        const size_t position = i % 16;
+        pattern[i] = static_cast<uint8_t>(position / wordSize * wordSize + wordSize - 1 - position % wordSize);
+    }
+    const __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i), _mm256_shuffle_epi8(words, shuffle));
+    }
+    return i;
+}
+#endif
+
+// Reverses the bytes of every wordSize-byte word; size is a multiple of wordSize.
+static void byteSwapWords(const uint8_t* source, uint8_t* target, size_t size, size_t wordSize) {
+    size_t i = 0;
+#if HAS_X86_SIMD
+    if (detectSimdLevel() != SimdLevel::Scalar) {
+        i = byteSwapWordsAvx2(source, target, size, wordSize);
+    }
+#endif
+    for (; i < size; i += wordSize) {
+        for (size_t b = 0; b < wordSize; ++b) {
+            target[i + b] = source[i + wordSize - 1 - b];
         }
     }
-    int nCoeffsPerColor = nRestCoeffs / 3;
-    sphericalHarmonicsDegree = static_cast<int>(std::sqrt(nCoeffsPerColor + 1) - 1);
-    std::cout << "Detected degree " << sphericalHarmonicsDegree << " with " << nCoeffsPerColor << " coefficients per color\n";
+}
+
+// Converts count records to host byte order. When every property has the
+// same size the records are a plain array of words and take the SIMD path.
+static void byteSwapRecords(const VertexLayout& layout, const uint8_t* source, uint8_t* target, size_t count) {
+    const size_t wordSize = plyScalarSize(layout.propertyTypes.front());
+    bool uniform = true;
+    for (auto type : layout.propertyTypes) {
+        uniform = uniform && plyScalarSize(type) == wordSize;
+    }
+    if (uniform) {
+        byteSwapWords(source, target, count * layout.stride, wordSize);
+        return;
+    }
+
+    // Mixed sizes: a byte permutation of one record, applied to every record.
+    std::vector<uint32_t> permutation;
+    permutation.reserve(layout.stride);
+    for (auto type : layout.propertyTypes) {
+        const size_t size = plyScalarSize(type);
+        const size_t offset = permutation.size();
+        for (size_t b = 0; b < size; ++b) {
+            permutation.push_back(static_cast<uint32_t>(offset + size - 1 - b));
+        }
+    }
+    for (size_t record = 0; record < count; ++record) {
+        const uint8_t* sourceRecord = source + record * layout.stride;
+        uint8_t* targetRecord = target + record * layout.stride;
+        for (size_t b = 0; b < layout.stride; ++b) {
+            targetRecord[b] = sourceRecord[permutation[b]];
+        }
+    }
+}
+
+std::vector<std::pair<float*, size_t>> PackedGaussians::slotDestinations(const VertexLayout& layout) {
+    std::vector<std::pair<float*, size_t>> destinations;
+    destinations.reserve(layout.slots.size());
+    for (const auto& slot : layout.slots) {
+        switch (slot.field) {
+        case VertexField::Position:
+            destinations.emplace_back(reinterpret_cast<float*>(positions.data()) + slot.component, 3);
+            break;
+        case VertexField::LogScale:
+            destinations.emplace_back(reinterpret_cast<float*>(logScales.data()) + slot.component, 3);
+            break;
+        case VertexField::RotQuat:
+            destinations.emplace_back(reinterpret_cast<float*>(rotQuats.data()) + slot.component, 4);
+            break;
+        case VertexField::OpacityLogit:
+            destinations.emplace_back(opacityLogits.data(), 1);
+            break;
+        case VertexField::ShCoeff:
+            destinations.emplace_back(shCoeffs.data() + shIndex(0, slot.component / 3, slot.component % 3), shIndex(1, 0, 0));
+            break;
+        }
+    }
+    return destinations;
+}
+
+void PackedGaussians::decodeVertices(const VertexLayout& layout, std::span<const uint8_t> vertexData, int begin, int end) {
+    decodeVertexBlock(layout, vertexData.subspan(static_cast<size_t>(begin) * layout.stride, static_cast<size_t>(end - begin) * layout.stride), begin);
+}
 
-    std::vector<std::string> shFeatureOrder;
-    for (int rgb = 0; rgb < 3; ++rgb) {
-        shFeatureOrder.push_back("f_dc_" + std::to_string(rgb));
+void PackedGaussians::decodeVertexBlock(const VertexLayout& layout, std::span<const uint8_t> records, int begin) {
+    ScopedTimer timer("decodeVertices");
+    timer.addBytes(records.size());
+    const int end = begin + static_cast<int>(records.size() / layout.stride);
+    // Resolve every slot to a base pointer and a per-splat stride once per call.
+    const auto destinations = slotDestinations(layout);
+
+    // Decodes vertices [first, last) from records holding vertex `first` onward.
+    auto decodeRecords = [&](const uint8_t* block, int first, int last) {
+        for (int i = first; i < last; ++i) {
+            const uint8_t* vertex = block + static_cast<size_t>(i - first) * layout.stride;
+            for (size_t s = 0; s < layout.slots.size(); ++s) {
+                const auto& slot = layout.slots[s];
+                destinations[s].first[i * destinations[s].second] = readScalar(vertex + slot.byteOffset, slot.type);
+            }
+        }
+    };
+
+    if (!layout.byteSwapped) {
+        decodeRecords(records.data(), begin, end);
+        return;
+    }
+
+    // Foreign byte order: swap small blocks into a scratch buffer that stays in
+    // cache, then decode them as native records.
+    const int blockVertices = 4096;
+    std::vector<uint8_t> scratch(static_cast<size_t>(std::min(end - begin, blockVertices)) * layout.stride);
+    for (int first = begin; first < end; first += blockVertices) {
+        const int last = std::min(first + blockVertices, end);
+        byteSwapRecords(layout, records.data() + static_cast<size_t>(first - begin) * layout.stride, scratch.data(), last - first);
+        decodeRecords(scratch.data(), first, last);
+    }
+}
+
+void PackedGaussians::decodeVertexList(const VertexLayout& layout, std::span<const uint8_t> vertexData, std::span<const uint32_t> sources, int begin) {
+    ScopedTimer timer("decodeVertexList");
+    timer.addBytes(sources.size() * layout.stride);
+    const auto destinations = slotDestinations(layout);
+    std::vector<uint8_t> swapped(layout.byteSwapped ? layout.stride : 0);
+    for (size_t k = 0; k < sources.size(); ++k) {
+        const uint8_t* vertex = vertexData.data() + static_cast<size_t>(sources[k]) * layout.stride;
+        if (layout.byteSwapped) {
+            byteSwapRecords(layout, vertex, swapped.data(), 1);
+            vertex = swapped.data();
+        }
+        const size_t i = begin + k;
+        for (size_t s = 0; s < layout.slots.size(); ++s) {
+            const auto& slot = layout.slots[s];
+            destinations[s].first[i * destinations[s].second] = readScalar(vertex + slot.byteOffset, slot.type);
+        }
     }
-    for (int i = 0; i < nCoeffsPerColor; ++i) {
-        for (int rgb = 0; rgb < 3; ++rgb) {
-            shFeatureOrder.push_back("f_rest_" + std::to_string(rgb * nCoeffsPerColor + i));
+}
+
+void PackedGaussians::decodeAsciiVertices(const VertexLayout& layout, std::string_view text, int nThreads) {
+    ScopedTimer timer("decodeAsciiVertices");
+    timer.addBytes(text.size());
+    const int blockLines = 16384;
+    std::vector<size_t> blockStarts;
+    size_t offset = 0;
+    for (int line = 0; line < numGaussians; ++line) {
+        if (line % blockLines == 0) {
+            blockStarts.push_back(offset);
+        }
+        if (offset >= text.size()) {
+            throw std::runtime_error("Vertex data is shorter than the header declares");
+        }
+        offset = std::min(text.find('\n', offset), text.size() - 1) + 1;
+    }
+
+    const auto destinations = slotDestinations(layout);
+    std::vector<int> propertySlots(layout.propertyTypes.size(), -1);
+    for (size_t s = 0; s < layout.slots.size(); ++s) {
+        propertySlots[layout.slots[s].property] = static_cast<int>(s);
+    }
+
+    // Workers cannot throw, so the first malformed vertex is reported afterwards.
+    std::atomic<int> malformedVertex = -1;
+    workStealingFor(blockStarts.size(), nThreads, [&](size_t block, int) {
+        const char* cursor = text.data() + blockStarts[block];
+        const char* limit = text.data() + text.size();
+        const int first = static_cast<int>(block) * blockLines;
+        const int last = std::min(first + blockLines, numGaussians);
+        for (int i = first; i < last; ++i) {
+            for (size_t property = 0; property < propertySlots.size(); ++property) {
+                while (cursor < limit && (*cursor == ' ' || *cursor == '\t' || *cursor == '+')) {
+                    ++cursor;
+                }
+                float value;
+                const auto [end, error] = std::from_chars(cursor, limit, value);
+                if (error != std::errc()) {
+                    int expected = -1;
+                    malformedVertex.compare_exchange_strong(expected, i);
+                    return;
+                }
+                cursor = end;
+                const int s = propertySlots[property];
+                if (s >= 0) {
+                    destinations[s].first[i * destinations[s].second] = layout.slots[s].type == PlyScalarType::UChar ? value / 255.0f : value;
+                }
+            }
+            while (cursor < limit && *cursor != '\n') {
+                ++cursor;
+            }
+            ++cursor;
         }
+    });
+    if (malformedVertex >= 0) {
+        throw std::runtime_error("Malformed ASCII vertex " + std::to_string(malformedVertex.load()));
     }
+}
 
-    size_t readOffset = 0;
-    for (int i = 0; i < vertexCount; ++i) {
-        auto [newReadOffset, rawVertex] = readRawVertex(readOffset, vertexData, propertyTypes, intKeys);
-        readOffset = newReadOffset;
+void PackedGaussians::decodeVerticesParallel(const VertexLayout& layout, std::span<const uint8_t> vertexData, int begin, int end, int nThreads) {
+    // Every slice owns a contiguous range of vertices and therefore a disjoint
+    // part of each preallocated output column.
+    parallelFor(std::max(0, end - begin), nThreads, [&](int, size_t sliceBegin, size_t sliceEnd) {
+        decodeVertices(layout, vertexData, begin + static_cast<int>(sliceBegin), begin + static_cast<int>(sliceEnd));
+    });
+}
 
-        auto arrangedVertex = arrangeVertex(rawVertex, shFeatureOrder);
-        positions.push_back({ arrangedVertex["position"][0], arrangedVertex["position"][1], arrangedVertex["position"][2] });
-        logScales.push_back({ arrangedVertex["logScale"][0], arrangedVertex["logScale"][1], arrangedVertex["logScale"][2] });
-        rotQuats.push_back({ arrangedVertex["rotQuat"][0], arrangedVertex["rotQuat"][1], arrangedVertex["rotQuat"][2], arrangedVertex["rotQuat"][3] });
-        opacityLogits.push_back(arrangedVertex["opacityLogit"][0]);
+PackedGaussians::PackedGaussians() : numGaussians(0), sphericalHarmonicsDegree(0), shLayout(ShLayout::Interleaved) {}
 
-        std::vector<std::array<float, 3>> coeffs;
-        for (int j = 0; j < nShCoeffs(); ++j) {
-            coeffs.push_back({ arrangedVertex["shCoeffs"][j * 3], arrangedVertex["shCoeffs"][j * 3 + 1], arrangedVertex["shCoeffs"][j * 3 + 2] });
+PackedGaussians::PackedGaussians(std::span<const uint8_t> arrayBuffer, const LoadOptions& options) {
+    ScopedTimer timer("PackedGaussians");
+    timer.addBytes(arrayBuffer.size());
+    auto [vertexCount, layout, vertexData, format] = decodeHeader(arrayBuffer, options.maxShDegree);
+    numGaussians = vertexCount;
+    sphericalHarmonicsDegree = layout.sphericalHarmonicsDegree;
+    shLayout = options.shLayout;
+    traceCounter("vertices", vertexCount);
+    logMessage(LogLevel::Info, "Detected degree " + std::to_string(sphericalHarmonicsDegree) + " with " + std::to_string(nShCoeffs() - 1) + " coefficients per color");
+
+    if (format != PlyFormat::Ascii && vertexData.size() < static_cast<size_t>(vertexCount) * layout.stride) {
+        throw std::runtime_error("Vertex data is shorter than the header declares");
+    }
+
+    positions.resize(vertexCount);
+    logScales.resize(vertexCount);
+    rotQuats.resize(vertexCount);
+    opacityLogits.resize(vertexCount);
+    shCoeffs.resize(static_cast<size_t>(vertexCount) * nShCoeffs() * 3);
+
+    if (format == PlyFormat::Ascii) {
+        decodeAsciiVertices(layout, std::string_view(reinterpret_cast<const char*>(vertexData.data()), vertexData.size()), options.nThreads);
+        if (options.releaseConsumed) {
+            options.releaseConsumed(vertexData);
+        }
+    }
+    else if (!options.releaseConsumed) {
+        decodeVerticesParallel(layout, vertexData, 0, vertexCount, options.nThreads);
+    }
+    else {
+        // Decode in blocks of roughly 64 MiB so consumed input can be released early.
+        const int blockVertices = std::max(1, static_cast<int>((64 << 20) / std::max<size_t>(layout.stride, 1)));
+        for (int begin = 0; begin < vertexCount; begin += blockVertices) {
+            const int end = std::min(begin + blockVertices, vertexCount);
+            decodeVerticesParallel(layout, vertexData, begin, end, options.nThreads);
+            options.releaseConsumed(vertexData.subspan(begin * layout.stride, (end - begin) * layout.stride));
         }
-        shCoeffs.push_back(coeffs);
+    }
+
+    if (options.mortonOrder) {
+        permute(mortonOrder(positions, options.nThreads), options.nThreads);
     }
 }
 
 std::vector<uint8_t> loadFileAsArrayBuffer(const std::string& filePath) {
+    ScopedTimer timer("loadFileAsArrayBuffer");
     std::ifstream file(filePath, std::ios::binary | std::ios::ate);
     if (!file) {
         throw std::runtime_error("Failed to load file");
@@ -165,5 +744,27 @@ std::vector<uint8_t> loadFileAsArrayBuffer(const std::string& filePath) {
         throw std::runtime_error("Failed to read file");
     }
 
+    timer.addBytes(buffer.size());
     return buffer;
 }
+
+PackedGaussians loadPackedGaussians(const std::string& filePath, const LoadOptions& options) {
+    std::optional<MappedFile> mapped;
+    try {
+        mapped.emplace(filePath);
+    }
+    catch (const std::runtime_error&) {
+        auto buffer = loadFileAsArrayBuffer(filePath);
+        return PackedGaussians(buffer, options);
+    }
+
+    mapped->adviseSequential();
+    LoadOptions mappedOptions = options;
+    mappedOptions.releaseConsumed = [&](std::span<const uint8_t> consumed) {
+        if (options.releaseConsumed) {
+            options.releaseConsumed(consumed);
+        }
+        mapped->release(consumed);
+    };
+    return PackedGaussians(mapped->data(), mappedOptions);
+}
@@ -3,11 +3,77 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
 #include <tuple>
 #include <span>
 #include <array>
 #include <stdexcept>
+#include <cstdint>
+#include <functional>
+
+enum class PlyScalarType { Char, UChar, Short, UShort, Int, UInt, Float, Double };
+
+enum class PlyFormat { BinaryLittleEndian, BinaryBigEndian, Ascii };
+
+enum class VertexField { Position, LogScale, RotQuat, OpacityLogit, ShCoeff };
+
+// Interleaved keeps the nShCoeffs() x 3 coefficients of a splat together;
+// Planar stores one plane of numGaussians floats per (coefficient, channel).
+enum class ShLayout { Interleaved, Planar };
+
+// One property of the vertex element that is copied into PackedGaussians:
+// where it sits inside a vertex, how it is encoded, and which column and
+// component of the output it is written to. `property` is its position in
+// the vertex element, which is what ASCII files are decoded by.
+struct VertexSlot {
+    size_t byteOffset;
+    PlyScalarType type;
+    VertexField field;
+    int component;
+    int property;
+};
+
+// Vertex layout compiled once from the header, so decoding does not have to
+// look anything up by property name. Integer properties are converted to
+// float as they are, except uchar, which is normalized to [0, 1].
+struct VertexLayout {
+    size_t stride;
+    int sphericalHarmonicsDegree;
+    std::vector<VertexSlot> slots;
+    // Types of every property of the vertex element, used or not.
+    std::vector<PlyScalarType> propertyTypes;
+    // Binary data is in the opposite byte order to the host.
+    bool byteSwapped = false;
+};
+
+// vertexData starts at the first vertex. For ASCII files it is the text of
+// the vertex lines onward.
+struct PlyHeader {
+    int vertexCount;
+    VertexLayout layout;
+    std::span<const uint8_t> vertexData;
+    PlyFormat format;
+};
+
+struct LoadOptions {
+    // Worker threads used to decode the vertex block; 0 picks the hardware concurrency.
+    int nThreads = 1;
+    // Called with each part of the vertex block once it has been fully decoded,
+    // in file order. Used to drop consumed pages of a mapped file.
+    std::function<void(std::span<const uint8_t>)> releaseConsumed;
+    // Higher SH bands present in the file are dropped at load time.
+    int maxShDegree = 3;
+    ShLayout shLayout = ShLayout::Interleaved;
+    // Reorder the splats by the Morton code of their center, so that splats
+    // close in space are close in memory. The file order is kept in sourceIndices.
+    bool mortonOrder = false;
+};
+
+size_t plyScalarSize(PlyScalarType type);
+
+// Value of one slot of a binary vertex record, converted like the decoders do.
+float readVertexScalar(const uint8_t* vertex, const VertexSlot& slot, bool byteSwapped);
 
 class PackedGaussians {
 public:
@@ -18,19 +84,53 @@ public:
     std::vector<std::array<float, 3>> logScales;
     std::vector<std::array<float, 4>> rotQuats;
     std::vector<float> opacityLogits;
-    std::vector<std::vector<std::array<float, 3>>> shCoeffs;
+    ShLayout shLayout;
+    std::vector<float> shCoeffs;
+    // Original index of every splat once they have been permuted, empty while
+    // they are in file order.
+    std::vector<uint32_t> sourceIndices;
 
-    static std::tuple<int, std::map<std::string, std::string>, std::span<const uint8_t>, std::map<int, std::string>> decodeHeader(std::span<const uint8_t> plyArrayBuffer);
+    static PlyHeader decodeHeader(std::span<const uint8_t> plyArrayBuffer, int maxShDegree = 3);
 
-    std::tuple<size_t, std::map<std::string, float>> readRawVertex(size_t offset, std::span<const uint8_t> vertexData, const std::map<std::string, std::string>& propertyTypes, std::map<int, std::string> intKeys);
+    static VertexLayout compileVertexLayout(const std::vector<std::pair<std::string, PlyScalarType>>& properties, int maxShDegree = 3);
 
     int nShCoeffs() const;
 
-    std::map<std::string, std::vector<float>> arrangeVertex(const std::map<std::string, float>& rawVertex, const std::vector<std::string>& shFeatureOrder);
+    size_t shIndex(int splat, int coeff, int channel) const;
+    float shCoeff(int splat, int coeff, int channel) const;
+    void setShLayout(ShLayout layout);
+    // Drops the SH bands above `degree` and releases their memory.
+    void truncateShDegree(int degree);
+
+    // Moves splat order[k] to position k in every column, one column at a
+    // time so only one extra column is held. `order` must be a permutation.
+    void permute(std::span<const uint32_t> order, int nThreads);
+
+    void decodeVertices(const VertexLayout& layout, std::span<const uint8_t> vertexData, int begin, int end);
+
+    // Decodes the whole records in `records` into splats begin onward.
+    void decodeVertexBlock(const VertexLayout& layout, std::span<const uint8_t> records, int begin);
 
-    PackedGaussians(std::span<const uint8_t> arrayBuffer);
+    void decodeVerticesParallel(const VertexLayout& layout, std::span<const uint8_t> vertexData, int begin, int end, int nThreads);
+
+    // Decodes vertex sources[k] of vertexData into splat begin + k.
+    void decodeVertexList(const VertexLayout& layout, std::span<const uint8_t> vertexData, std::span<const uint32_t> sources, int begin);
+
+    // Parses numGaussians vertex lines, splitting them into blocks of lines
+    // that are decoded in parallel.
+    void decodeAsciiVertices(const VertexLayout& layout, std::string_view text, int nThreads);
+
+    // Base pointer and per-splat float stride of the output of every slot.
+    std::vector<std::pair<float*, size_t>> slotDestinations(const VertexLayout& layout);
+
+    PackedGaussians();
+    PackedGaussians(std::span<const uint8_t> arrayBuffer, const LoadOptions& options = {});
 };
 
 std::vector<uint8_t> loadFileAsArrayBuffer(const std::string& filePath);
 
+// Loads a PLY through a memory mapping, falling back to loadFileAsArrayBuffer
+// when the file cannot be mapped.
+PackedGaussians loadPackedGaussians(const std::string& filePath, const LoadOptions& options = {});
+
 #endif // PLY_H
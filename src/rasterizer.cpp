@@ -0,0 +1,288 @@
+#include "rasterizer.h"
+#include "parallel.h"
+#include <cmath>
+#include <algorithm>
+#include <bit>
+
+std::array<float, 3> Camera::position() const {
+    // The camera center is -R^T t for the rotation R and translation t of the view.
+    std::array<float, 3> center;
+    for (int c = 0; c < 3; ++c) {
+        center[c] = -(view[c][0] * view[3][0] + view[c][1] * view[3][1] + view[c][2] * view[3][2]);
+    }
+    return center;
+}
+
+// Branch-free float select. Under the default -ftrapping-math GCC will not
+// if-convert float ternaries whose arms it can fold into later arithmetic,
+// which keeps the blending loop scalar; selecting on the bit patterns does not
+// have that problem.
+static inline float selectFloat(bool condition, float a, float b) {
+    const int32_t mask = -static_cast<int32_t>(condition);
+    return std::bit_cast<float>((std::bit_cast<int32_t>(a) & mask) | (std::bit_cast<int32_t>(b) & ~mask));
+}
+
+// exp(x) for x <= 0 with plain float/int arithmetic so loops calling it
+// vectorize. Relative error is below 1e-6 down to about -87; results flush to
+// zero below that.
+static inline float fastExp(float x) {
+    const float t = x * 1.44269504f;
+    const int32_t truncated = static_cast<int32_t>(t);
+    const int32_t integer = truncated - (t < static_cast<float>(truncated) ? 1 : 0);
+    const float f = t - static_cast<float>(integer);
+    const float fraction = 1.0f + f * (0.69314718f + f * (0.24022652f + f * (0.05550411f + f * (0.00961813f + f * 0.00133336f))));
+    return fraction * std::bit_cast<float>(std::max(integer + 127, 0) << 23);
+}
+
+SplatRasterizer::SplatRasterizer(const RasterOptions& options)
+    : options(options), covarianceCache({ .nThreads = options.nThreads }), colorCache({ .nThreads = options.nThreads, .angleThreshold = options.colorAngleThreshold }) {}
+
+void SplatRasterizer::projectSplats(const PackedGaussians& gaussians, const Camera& camera, const ShCodebook* codebook) {
+    const int tilesX = (camera.width + tileSize - 1) / tileSize;
+    const int tilesY = (camera.height + tileSize - 1) / tileSize;
+    const auto cameraPosition = camera.position();
+    const auto& view = camera.view;
+    // Like the reference 3DGS rasterizer, splats far outside the view are
+    // projected as if they sat slightly beyond the image border.
+    const float limitX = 1.3f * 0.5f * camera.width / camera.fx;
+    const float limitY = 1.3f * 0.5f * camera.height / camera.fy;
+
+    const auto& covariances = covarianceCache.update(gaussians);
+    const auto& colors = colorCache.update(gaussians, cameraPosition, codebook);
+    projected.resize(gaussians.numGaussians);
+    parallelFor(gaussians.numGaussians, options.nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ProjectedSplat& splat = projected[i];
+            splat.tileMinX = splat.tileMaxX = 0;
+
+            const auto& p = gaussians.positions[i];
+            float t[3];
+            for (int r = 0; r < 3; ++r) {
+                t[r] = view[0][r] * p[0] + view[1][r] * p[1] + view[2][r] * p[2] + view[3][r];
+            }
+            const float depth = -t[2];
+            if (depth < camera.nearPlane) {
+                continue;
+            }
+
+            const Covariance& packed = covariances[i];
+            const float covariance[3][3] = {
+                { packed[0], packed[1], packed[2] },
+                { packed[1], packed[3], packed[4] },
+                { packed[2], packed[4], packed[5] },
+            };
+
+            const float tx = std::clamp(t[0] / depth, -limitX, limitX) * depth;
+            const float ty = std::clamp(t[1] / depth, -limitY, limitY) * depth;
+            const float jacobian[2][3] = {
+                { camera.fx / depth, 0.0f, camera.fx * tx / (depth * depth) },
+                { 0.0f, -camera.fy / depth, -camera.fy * ty / (depth * depth) },
+            };
+            float projection[2][3];
+            for (int a = 0; a < 2; ++a) {
+                for (int c = 0; c < 3; ++c) {
+                    projection[a][c] = jacobian[a][0] * view[c][0] + jacobian[a][1] * view[c][1] + jacobian[a][2] * view[c][2];
+                }
+            }
+            float covariance2d[2][2];
+            for (int a = 0; a < 2; ++a) {
+                for (int b = 0; b < 2; ++b) {
+                    float sum = 0.0f;
+                    for (int r = 0; r < 3; ++r) {
+                        for (int c = 0; c < 3; ++c) {
+                            sum += projection[a][r] * covariance[r][c] * projection[b][c];
+                        }
+                    }
+                    covariance2d[a][b] = sum;
+                }
+            }
+            // Low-pass filter so every splat covers at least about one pixel.
+            covariance2d[0][0] += 0.3f;
+            covariance2d[1][1] += 0.3f;
+
+            const float determinant = covariance2d[0][0] * covariance2d[1][1] - covariance2d[0][1] * covariance2d[0][1];
+            if (determinant <= 0.0f) {
+                continue;
+            }
+            const float middle = 0.5f * (covariance2d[0][0] + covariance2d[1][1]);
+            const float largestEigenvalue = middle + std::sqrt(std::max(0.1f, middle * middle - determinant));
+            const float radius = std::ceil(3.0f * std::sqrt(largestEigenvalue));
+
+            splat.radius = radius;
+            splat.meanX = camera.cx + camera.fx * t[0] / depth;
+            splat.meanY = camera.cy - camera.fy * t[1] / depth;
+            splat.tileMinX = std::clamp(static_cast<int>(std::floor((splat.meanX - radius) / tileSize)), 0, tilesX);
+            splat.tileMinY = std::clamp(static_cast<int>(std::floor((splat.meanY - radius) / tileSize)), 0, tilesY);
+            splat.tileMaxX = std::clamp(static_cast<int>(std::floor((splat.meanX + radius) / tileSize)) + 1, 0, tilesX);
+            splat.tileMaxY = std::clamp(static_cast<int>(std::floor((splat.meanY + radius) / tileSize)) + 1, 0, tilesY);
+            if (splat.tileMinX >= splat.tileMaxX || splat.tileMinY >= splat.tileMaxY) {
+                splat.tileMaxX = splat.tileMinX;
+                continue;
+            }
+
+            splat.conicA = covariance2d[1][1] / determinant;
+            splat.conicB = -covariance2d[0][1] / determinant;
+            splat.conicC = covariance2d[0][0] / determinant;
+            splat.opacity = 1.0f / (1.0f + std::exp(-gaussians.opacityLogits[i]));
+            splat.depth = depth;
+
+            splat.color = colors[i];
+        }
+    });
+}
+
+void SplatRasterizer::binSplats(int tilesX, int tilesY) {
+    const size_t n = projected.size();
+    const size_t nTiles = static_cast<size_t>(tilesX) * tilesY;
+    const int nSlices = parallelSlices(n, options.nThreads);
+
+    std::vector<size_t> counts(static_cast<size_t>(nSlices) * nTiles, 0);
+    parallelFor(n, options.nThreads, [&](int slice, size_t begin, size_t end) {
+        size_t* sliceCounts = counts.data() + slice * nTiles;
+        for (size_t i = begin; i < end; ++i) {
+            const auto& splat = projected[i];
+            for (int y = splat.tileMinY; y < splat.tileMaxY && splat.tileMinX < splat.tileMaxX; ++y) {
+                for (int x = splat.tileMinX; x < splat.tileMaxX; ++x) {
+                    sliceCounts[static_cast<size_t>(y) * tilesX + x]++;
+                }
+            }
+        }
+    });
+
+    tileOffsets.assign(nTiles + 1, 0);
+    size_t offset = 0;
+    for (size_t tile = 0; tile < nTiles; ++tile) {
+        tileOffsets[tile] = offset;
+        for (int slice = 0; slice < nSlices; ++slice) {
+            const size_t count = counts[slice * nTiles + tile];
+            counts[slice * nTiles + tile] = offset;
+            offset += count;
+        }
+    }
+    tileOffsets[nTiles] = offset;
+
+    // Positive float depths order like their bit patterns, so depth in the
+    // high word and splat index in the low word sort front to back.
+    tileEntries.resize(offset);
+    parallelFor(n, options.nThreads, [&](int slice, size_t begin, size_t end) {
+        size_t* sliceOffsets = counts.data() + slice * nTiles;
+        for (size_t i = begin; i < end; ++i) {
+            const auto& splat = projected[i];
+            const uint64_t key = (static_cast<uint64_t>(std::bit_cast<uint32_t>(splat.depth)) << 32) | i;
+            for (int y = splat.tileMinY; y < splat.tileMaxY && splat.tileMinX < splat.tileMaxX; ++y) {
+                for (int x = splat.tileMinX; x < splat.tileMaxX; ++x) {
+                    tileEntries[sliceOffsets[static_cast<size_t>(y) * tilesX + x]++] = key;
+                }
+            }
+        }
+    });
+
+    workStealingFor(nTiles, options.nThreads, [&](size_t tile, int) {
+        std::sort(tileEntries.begin() + tileOffsets[tile], tileEntries.begin() + tileOffsets[tile + 1]);
+    });
+}
+
+void SplatRasterizer::blendTile(int tile, int tilesX, const Camera& camera) {
+    constexpr int nPixels = tileSize * tileSize;
+    const int originX = (tile % tilesX) * tileSize;
+    const int originY = (tile / tilesX) * tileSize;
+
+    alignas(64) float pixelX[nPixels], pixelY[nPixels];
+    alignas(64) float transmittance[nPixels], red[nPixels], green[nPixels], blue[nPixels], done[nPixels];
+    for (int p = 0; p < nPixels; ++p) {
+        pixelX[p] = originX + p % tileSize + 0.5f;
+        pixelY[p] = originY + p / tileSize + 0.5f;
+        transmittance[p] = 1.0f;
+        red[p] = green[p] = blue[p] = done[p] = 0.0f;
+    }
+
+    const size_t first = tileOffsets[tile];
+    const size_t last = tileOffsets[tile + 1];
+    for (size_t entry = first; entry < last; ++entry) {
+        const ProjectedSplat& splat = projected[tileEntries[entry] & 0xffffffffu];
+        const float meanX = splat.meanX, meanY = splat.meanY;
+        const float conicA = splat.conicA, conicB = splat.conicB, conicC = splat.conicC;
+        const float opacity = splat.opacity;
+        const float splatRed = splat.color[0], splatGreen = splat.color[1], splatBlue = splat.color[2];
+        // Only the rows the splat's 3-sigma extent overlaps; small splats
+        // touch a few rows of the tile.
+        const int rowBegin = std::clamp(static_cast<int>(std::floor(meanY - splat.radius)) - originY, 0, tileSize);
+        const int rowEnd = std::clamp(static_cast<int>(std::ceil(meanY + splat.radius)) - originY + 1, 0, tileSize);
+
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const int rowStart = row * tileSize;
+            for (int column = 0; column < tileSize; ++column) {
+                const int p = rowStart + column;
+                const float dx = meanX - pixelX[p];
+                const float dy = meanY - pixelY[p];
+                const float power = -0.5f * (conicA * dx * dx + conicC * dy * dy) - conicB * dx * dy;
+                float alpha = opacity * fastExp(power);
+                alpha = selectFloat(alpha > 0.99f, 0.99f, alpha);
+                alpha = selectFloat((power > 0.0f) | (alpha < 1.0f / 255.0f), 0.0f, alpha);
+                const float remaining = transmittance[p] * (1.0f - alpha);
+                // A pixel is finished by the first splat that would push its
+                // transmittance below 1e-4; that splat and later ones are skipped.
+                const float finished = selectFloat(remaining < 0.0001f, 1.0f, done[p]);
+                alpha = selectFloat(finished != 0.0f, 0.0f, alpha);
+                const float weight = alpha * transmittance[p];
+                red[p] += splatRed * weight;
+                green[p] += splatGreen * weight;
+                blue[p] += splatBlue * weight;
+                transmittance[p] *= 1.0f - alpha;
+                done[p] = finished;
+            }
+        }
+
+        if ((entry - first) % 32 == 31) {
+            float nDone = 0.0f;
+            for (int p = 0; p < nPixels; ++p) {
+                nDone += done[p];
+            }
+            if (nDone == nPixels) {
+                break;
+            }
+        }
+    }
+
+    const auto& background = options.background;
+    for (int p = 0; p < nPixels; ++p) {
+        const int x = originX + p % tileSize;
+        const int y = originY + p / tileSize;
+        if (x >= camera.width || y >= camera.height) {
+            continue;
+        }
+        const float rgba[4] = {
+            red[p] + transmittance[p] * background[0],
+            green[p] + transmittance[p] * background[1],
+            blue[p] + transmittance[p] * background[2],
+            1.0f - transmittance[p],
+        };
+        uint8_t* pixel = image.data() + (static_cast<size_t>(y) * camera.width + x) * 4;
+        for (int k = 0; k < 4; ++k) {
+            pixel[k] = static_cast<uint8_t>(std::clamp(rgba[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+const std::vector<uint8_t>& SplatRasterizer::render(const PackedGaussians& gaussians, const Camera& camera, const ShCodebook* codebook) {
+    const int tilesX = (camera.width + tileSize - 1) / tileSize;
+    const int tilesY = (camera.height + tileSize - 1) / tileSize;
+    image.assign(static_cast<size_t>(camera.width) * camera.height * 4, 0);
+
+    projectSplats(gaussians, camera, codebook);
+    binSplats(tilesX, tilesY);
+    workStealingFor(static_cast<size_t>(tilesX) * tilesY, options.nThreads, [&](size_t tile, int) {
+        blendTile(static_cast<int>(tile), tilesX, camera);
+    });
+    return image;
+}
+
+void SplatRasterizer::invalidate() {
+    covarianceCache.invalidate();
+    colorCache.invalidate();
+}
+
+void SplatRasterizer::invalidate(size_t begin, size_t end) {
+    covarianceCache.invalidate(begin, end);
+    colorCache.invalidate(begin, end);
+}
@@ -0,0 +1,89 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include "ply.h"
+#include "sorting.h"
+#include "covariance.h"
+#include "sh.h"
+#include <vector>
+#include <array>
+#include <cstdint>
+
+// Pinhole camera. The view matrix is column-major with the camera looking
+// down -z, as for DepthSorter; pixel rows go down the image.
+struct Camera {
+    ViewMatrix view;
+    int width;
+    int height;
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+    float nearPlane = 0.2f;
+
+    std::array<float, 3> position() const;
+};
+
+struct RasterOptions {
+    int nThreads = 0;
+    std::array<float, 3> background = { 0.0f, 0.0f, 0.0f };
+    // Splat colors are only re-evaluated once the direction from the camera
+    // turned by more than this many radians; see ShColorCache.
+    float colorAngleThreshold = 0.0f;
+};
+
+// Reference CPU splat rasterizer: splats are projected to 2D conics, binned
+// into 16x16 tiles, depth-sorted per tile and alpha-blended front to back
+// with early termination. Tiles are rendered in parallel on a work-stealing
+// scheduler, and each tile is blended as 256-wide pixel arrays so the inner
+// loop vectorizes.
+class SplatRasterizer {
+public:
+    static constexpr int tileSize = 16;
+
+    explicit SplatRasterizer(const RasterOptions& options = {});
+
+    // Returns width * height RGBA8 pixels, row-major from the top-left corner.
+    // Alpha is the accumulated coverage. With a codebook, `gaussians` only
+    // needs the DC terms and the higher SH bands come from the codebook.
+    const std::vector<uint8_t>& render(const PackedGaussians& gaussians, const Camera& camera, const ShCodebook* codebook = nullptr);
+
+    // Covariances and colors are cached across frames and only recomputed by
+    // themselves when a source column is reallocated or resized, or, for
+    // colors, when the view direction turns. Call these after editing splats
+    // in place, for every splat or for splats [begin, end).
+    void invalidate();
+    void invalidate(size_t begin, size_t end);
+
+    struct ProjectedSplat {
+        float meanX;
+        float meanY;
+        float radius;
+        float conicA;
+        float conicB;
+        float conicC;
+        float opacity;
+        float depth;
+        std::array<float, 3> color;
+        int tileMinX;
+        int tileMinY;
+        int tileMaxX;
+        int tileMaxY;
+    };
+
+private:
+    RasterOptions options;
+    // Reused across frames until the scene's columns change or invalidate() is called.
+    CovarianceCache covarianceCache;
+    ShColorCache colorCache;
+    std::vector<ProjectedSplat> projected;
+    std::vector<size_t> tileOffsets;
+    std::vector<uint64_t> tileEntries;
+    std::vector<uint8_t> image;
+
+    void projectSplats(const PackedGaussians& gaussians, const Camera& camera, const ShCodebook* codebook);
+    void binSplats(int tilesX, int tilesY);
+    void blendTile(int tile, int tilesX, const Camera& camera);
+};
+
+#endif // RASTERIZER_H
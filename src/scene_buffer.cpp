@@ -0,0 +1,172 @@
+#include "scene_buffer.h"
+#include "parallel.h"
+#include <algorithm>
+
+static int vertexFieldScalars(VertexField field, const PackedGaussians& gaussians) {
+    switch (field) {
+    case VertexField::Position: return 3;
+    case VertexField::LogScale: return 3;
+    case VertexField::RotQuat: return 4;
+    case VertexField::OpacityLogit: return 1;
+    case VertexField::ShCoeff: return gaussians.nShCoeffs() * 3;
+    }
+    return 0;
+}
+
+// Sorts `ranges` and joins the ones closer than `gap`.
+static void mergeRanges(std::vector<std::pair<size_t, size_t>>& ranges, size_t gap) {
+    std::sort(ranges.begin(), ranges.end());
+    size_t merged = 0;
+    for (const auto& range : ranges) {
+        if (merged > 0 && range.first <= ranges[merged - 1].second + gap) {
+            ranges[merged - 1].second = std::max(ranges[merged - 1].second, range.second);
+        }
+        else {
+            ranges[merged++] = range;
+        }
+    }
+    ranges.resize(merged);
+}
+
+std::vector<VertexField> bindVertexFields(const PackingPlan& plan, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians) {
+    std::vector<VertexField> planFields;
+    for (size_t i = 0; i < plan.fields.size(); ++i) {
+        auto field = fields.find(plan.fields[i]);
+        if (field == fields.end()) {
+            throw PackingError("Missing column for field " + plan.fields[i]);
+        }
+        if (plan.fieldScalarCounts[i] > vertexFieldScalars(field->second, gaussians)) {
+            throw PackingError("Field " + plan.fields[i] + " has more scalars than its splat column");
+        }
+        planFields.push_back(field->second);
+    }
+    for (const auto& entry : plan.entries) {
+        if (entry.kind != ScalarKind::F32) {
+            throw PackingError("Field " + plan.fields[entry.field] + " must be f32 to pack splat columns");
+        }
+    }
+    return planFields;
+}
+
+std::vector<PackingColumn> vertexFieldColumns(const PackedGaussians& gaussians, std::span<const VertexField> planFields) {
+    std::vector<PackingColumn> fieldColumns;
+    for (VertexField field : planFields) {
+        switch (field) {
+        case VertexField::Position: fieldColumns.push_back(makeColumn(gaussians.positions)); break;
+        case VertexField::LogScale: fieldColumns.push_back(makeColumn(gaussians.logScales)); break;
+        case VertexField::RotQuat: fieldColumns.push_back(makeColumn(gaussians.rotQuats)); break;
+        case VertexField::OpacityLogit: fieldColumns.push_back(makeColumn(gaussians.opacityLogits)); break;
+        case VertexField::ShCoeff:
+            if (gaussians.shLayout != ShLayout::Interleaved) {
+                throw PackingError("Packing SH coefficients needs the interleaved SH layout");
+            }
+            fieldColumns.push_back({ gaussians.shCoeffs.data(), gaussians.nShCoeffs() * 3 * sizeof(float), gaussians.nShCoeffs() * 3, ScalarKind::F32 });
+            break;
+        }
+    }
+    return fieldColumns;
+}
+
+PackedSceneBuffer::PackedSceneBuffer(const PackingType& recordType, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians, const SceneBufferOptions& options)
+    : options(options), recordPlan(compilePackingPlan(recordType)), gaussians(gaussians) {
+    planFields = bindVertexFields(recordPlan, fields, gaussians);
+    for (const auto& entry : recordPlan.entries) {
+        fieldEntries[static_cast<int>(planFields[entry.field])].push_back(entry);
+    }
+    flush();
+}
+
+void PackedSceneBuffer::markDirty(size_t begin, size_t end, VertexFieldMask fields) {
+    if (begin >= end) {
+        return;
+    }
+    for (int field = 0; field < 5; ++field) {
+        if (fields & (1u << field)) {
+            dirtyRanges[field].emplace_back(begin, end);
+        }
+    }
+}
+
+void PackedSceneBuffer::markDirty(std::span<const uint32_t> splats, VertexFieldMask fields) {
+    std::vector<uint32_t> sorted(splats.begin(), splats.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i + 1;
+        while (j < sorted.size() && sorted[j] <= sorted[j - 1] + 1) {
+            ++j;
+        }
+        markDirty(sorted[i], size_t(sorted[j - 1]) + 1, fields);
+        i = j;
+    }
+}
+
+void PackedSceneBuffer::markAllDirty() {
+    allDirty = true;
+}
+
+const std::vector<BufferRange>& PackedSceneBuffer::flush() {
+    const size_t n = gaussians.numGaussians;
+    const auto fieldColumns = vertexFieldColumns(gaussians, planFields);
+    // The scene may have changed since the fields were bound, e.g. by
+    // truncateShDegree, which leaves fewer SH scalars per splat.
+    checkPackingColumns(recordPlan, fieldColumns);
+    changed.clear();
+    repacked = 0;
+
+    if (allDirty || n != packedCount) {
+        buffer.assign(n * recordPlan.stride, 0);
+        parallelFor(n, options.nThreads, [&](int, size_t begin, size_t end) {
+            packRecords(recordPlan, recordPlan.entries, fieldColumns, begin, end, buffer);
+        });
+        for (auto& ranges : dirtyRanges) {
+            ranges.clear();
+        }
+        allDirty = false;
+        packedCount = n;
+        repacked = n;
+        if (n > 0) {
+            changed.push_back({ 0, buffer.size() });
+        }
+        return changed;
+    }
+
+    std::vector<std::pair<size_t, size_t>> touched;
+    for (int field = 0; field < 5; ++field) {
+        auto& ranges = dirtyRanges[field];
+        for (auto& range : ranges) {
+            range.second = std::min(range.second, n);
+        }
+        std::erase_if(ranges, [](const auto& range) { return range.first >= range.second; });
+        mergeRanges(ranges, options.mergeGap);
+        if (!fieldEntries[field].empty()) {
+            for (const auto& [begin, end] : ranges) {
+                // Only large ranges are worth starting threads for.
+                const int nThreads = end - begin >= (1 << 16) ? options.nThreads : 1;
+                parallelFor(end - begin, nThreads, [&](int, size_t sliceBegin, size_t sliceEnd) {
+                    packRecords(recordPlan, fieldEntries[field], fieldColumns, begin + sliceBegin, begin + sliceEnd, buffer);
+                });
+            }
+            touched.insert(touched.end(), ranges.begin(), ranges.end());
+        }
+        ranges.clear();
+    }
+
+    mergeRanges(touched, options.mergeGap);
+    for (const auto& [begin, end] : touched) {
+        changed.push_back({ begin * recordPlan.stride, (end - begin) * recordPlan.stride });
+        repacked += end - begin;
+    }
+    return changed;
+}
+
+std::span<const uint8_t> PackedSceneBuffer::data() const {
+    return buffer;
+}
+
+const PackingPlan& PackedSceneBuffer::plan() const {
+    return recordPlan;
+}
+
+size_t PackedSceneBuffer::lastRepacked() const {
+    return repacked;
+}
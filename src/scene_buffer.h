@@ -0,0 +1,85 @@
+#ifndef SCENE_BUFFER_H
+#define SCENE_BUFFER_H
+
+#include "ply.h"
+#include "packing.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+// Set of VertexFields, one bit per field.
+using VertexFieldMask = uint32_t;
+
+constexpr VertexFieldMask vertexFieldBit(VertexField field) {
+    return 1u << static_cast<int>(field);
+}
+
+constexpr VertexFieldMask allVertexFields = 0x1f;
+
+// Bytes [offset, offset + size) of a packed buffer.
+struct BufferRange {
+    size_t offset;
+    size_t size;
+};
+
+struct SceneBufferOptions {
+    int nThreads = 1;
+    // Dirty ranges closer than this many splats are repacked and reported as one.
+    size_t mergeGap = 0;
+};
+
+// VertexField of every field of `plan`, looked up by name in `fields`. Throws
+// PackingError when a field is missing, has more scalars than its splat
+// column or is not f32.
+std::vector<VertexField> bindVertexFields(const PackingPlan& plan, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians);
+
+// Source column of every bound plan field. SH fields need the interleaved layout.
+std::vector<PackingColumn> vertexFieldColumns(const PackedGaussians& gaussians, std::span<const VertexField> planFields);
+
+// One packed record per splat of a PackedGaussians, kept up to date
+// incrementally. Edits to the scene are reported with markDirty() and flush()
+// repacks only the plan entries of the dirty fields over the merged dirty
+// splat ranges, returning the byte ranges of the buffer that changed. Each
+// plan field is bound to a VertexField, whose values are copied from the
+// start of the splat's column; SH fields need the interleaved layout.
+class PackedSceneBuffer {
+public:
+    // Packs every splat of `gaussians`, which must outlive the buffer.
+    PackedSceneBuffer(const PackingType& recordType, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians, const SceneBufferOptions& options = {});
+
+    void markDirty(size_t begin, size_t end, VertexFieldMask fields = allVertexFields);
+    void markDirty(std::span<const uint32_t> splats, VertexFieldMask fields = allVertexFields);
+    // Repacks the whole scene on the next flush.
+    void markAllDirty();
+
+    // Repacks what was marked dirty since the last flush. A scene whose splat
+    // count changed is repacked completely. Throws PackingError when a field
+    // has more scalars than its splat column now holds, as after
+    // truncateShDegree lowered the degree below an SH field's size.
+    const std::vector<BufferRange>& flush();
+
+    std::span<const uint8_t> data() const;
+    const PackingPlan& plan() const;
+    // Number of splats repacked by the last flush().
+    size_t lastRepacked() const;
+
+private:
+    SceneBufferOptions options;
+    PackingPlan recordPlan;
+    std::vector<VertexField> planFields;
+    // plan.entries grouped by the VertexField they read.
+    std::array<std::vector<PackingPlanEntry>, 5> fieldEntries;
+    const PackedGaussians& gaussians;
+    std::vector<uint8_t> buffer;
+    size_t packedCount = 0;
+    bool allDirty = true;
+    std::array<std::vector<std::pair<size_t, size_t>>, 5> dirtyRanges;
+    std::vector<BufferRange> changed;
+    size_t repacked = 0;
+};
+
+#endif // SCENE_BUFFER_H
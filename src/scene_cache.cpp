@@ -0,0 +1,315 @@
+#include "scene_cache.h"
+#include "parallel.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+#include <bit>
+#include <atomic>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+// XXH64 constants and steps.
+static const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t read64(const uint8_t* source) {
+    uint64_t value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+static inline uint64_t hashRound(uint64_t accumulator, uint64_t lane) {
+    return std::rotl(accumulator + lane * prime2, 31) * prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+    return (hash ^ hashRound(0, accumulator)) * prime1 + prime4;
+}
+
+static uint64_t xxHash64(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint8_t* end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        for (; data + 32 <= end; data += 32) {
+            v1 = hashRound(v1, read64(data));
+            v2 = hashRound(v2, read64(data + 8));
+            v3 = hashRound(v3, read64(data + 16));
+            v4 = hashRound(v4, read64(data + 24));
+        }
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else {
+        hash = seed + prime5;
+    }
+
+    hash += size;
+    for (; data + 8 <= end; data += 8) {
+        hash = std::rotl(hash ^ hashRound(0, read64(data)), 27) * prime1 + prime4;
+    }
+    if (data + 4 <= end) {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        hash = std::rotl(hash ^ (word * prime1), 23) * prime2 + prime3;
+        data += 4;
+    }
+    for (; data < end; ++data) {
+        hash = std::rotl(hash ^ (*data * prime5), 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t hashBytes(std::span<const uint8_t> data, int nThreads) {
+    const size_t chunkSize = size_t(64) << 20;
+    const size_t nChunks = std::max<size_t>(1, (data.size() + chunkSize - 1) / chunkSize);
+    std::vector<uint64_t> chunkHashes(nChunks);
+    parallelFor(nChunks, nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            const size_t offset = chunk * chunkSize;
+            chunkHashes[chunk] = xxHash64(data.data() + offset, std::min(chunkSize, data.size() - offset), 0);
+        }
+    });
+    return xxHash64(reinterpret_cast<const uint8_t*>(chunkHashes.data()), nChunks * sizeof(uint64_t), data.size());
+}
+
+static int64_t modifiedTime(const std::string& filePath) {
+    return static_cast<int64_t>(std::filesystem::last_write_time(filePath).time_since_epoch().count());
+}
+
+SourceFingerprint fingerprintFile(const std::string& filePath, int nThreads) {
+    const int64_t time = modifiedTime(filePath);
+    MappedFile mapped(filePath);
+    mapped.adviseSequential();
+    return { mapped.size(), time, hashBytes(mapped.data(), nThreads) };
+}
+
+static const char sceneCacheMagic[4] = { 'G', 'S', 'S', 'C' };
+static const uint32_t sceneCacheVersion = 1;
+static const size_t columnAlignment = 64;
+static const int nColumns = 5;
+
+struct SceneCacheHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t numGaussians;
+    int32_t sphericalHarmonicsDegree;
+    int32_t maxShDegree;
+    int32_t shLayout;
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    // Byte offsets of positions, logScales, rotQuats, opacityLogits and shCoeffs.
+    uint64_t columnOffsets[nColumns];
+};
+
+static size_t alignColumn(size_t offset) {
+    return (offset + columnAlignment - 1) / columnAlignment * columnAlignment;
+}
+
+static std::array<size_t, nColumns> columnSizes(size_t n, int sphericalHarmonicsDegree) {
+    const size_t nCoeffs = static_cast<size_t>(sphericalHarmonicsDegree + 1) * (sphericalHarmonicsDegree + 1);
+    return { n * 12, n * 12, n * 16, n * 4, n * nCoeffs * 3 * 4 };
+}
+
+static int processId() {
+#ifndef _WIN32
+    return static_cast<int>(getpid());
+#else
+    return _getpid();
+#endif
+}
+
+void writeSceneCache(const std::string& cachePath, const PackedGaussians& gaussians, const SourceFingerprint& source, int maxShDegree) {
+    const size_t n = gaussians.numGaussians;
+    const auto sizes = columnSizes(n, gaussians.sphericalHarmonicsDegree);
+    if (gaussians.positions.size() != n || gaussians.logScales.size() != n || gaussians.rotQuats.size() != n || gaussians.opacityLogits.size() != n || gaussians.shCoeffs.size() * sizeof(float) != sizes[4]) {
+        throw std::invalid_argument("Scene columns do not match numGaussians");
+    }
+    const void* columns[nColumns] = { gaussians.positions.data(), gaussians.logScales.data(), gaussians.rotQuats.data(), gaussians.opacityLogits.data(), gaussians.shCoeffs.data() };
+
+    SceneCacheHeader header = {};
+    std::memcpy(header.magic, sceneCacheMagic, 4);
+    header.version = sceneCacheVersion;
+    header.numGaussians = gaussians.numGaussians;
+    header.sphericalHarmonicsDegree = gaussians.sphericalHarmonicsDegree;
+    header.maxShDegree = maxShDegree;
+    header.shLayout = static_cast<int32_t>(gaussians.shLayout);
+    header.sourceSize = source.size;
+    header.sourceModifiedTime = source.modifiedTime;
+    header.sourceHash = source.contentHash;
+    size_t offset = alignColumn(sizeof(SceneCacheHeader));
+    for (int column = 0; column < nColumns; ++column) {
+        header.columnOffsets[column] = offset;
+        offset = alignColumn(offset + sizes[column]);
+    }
+    header.fileSize = offset;
+
+    // Unique per process and call, so concurrent writers of the same cache
+    // never share a temporary file; the last rename wins.
+    static std::atomic<uint64_t> temporaryCount = 0;
+    const std::string temporaryPath = cachePath + ".tmp." + std::to_string(processId()) + "." + std::to_string(temporaryCount++);
+    try {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + temporaryPath + " for writing");
+        }
+        const char padding[columnAlignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        size_t written = sizeof(header);
+        for (int column = 0; column < nColumns; ++column) {
+            file.write(padding, header.columnOffsets[column] - written);
+            file.write(static_cast<const char*>(columns[column]), sizes[column]);
+            written = header.columnOffsets[column] + sizes[column];
+        }
+        file.write(padding, header.fileSize - written);
+        if (!file.flush()) {
+            throw std::runtime_error("Failed to write " + temporaryPath);
+        }
+        file.close();
+        std::filesystem::rename(temporaryPath, cachePath);
+    }
+    catch (...) {
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+        throw;
+    }
+}
+
+// Stores a new source modification time in the header of a cache whose
+// source was found unchanged by its content hash. Failing to is harmless:
+// the next open hashes the source again.
+static void updateSourceModifiedTime(const std::string& cachePath, int64_t time) {
+    std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offsetof(SceneCacheHeader, sourceModifiedTime));
+    file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+}
+
+MappedScene::MappedScene(const std::string& cachePath) : file(cachePath) {
+    const auto data = file.data();
+    SceneCacheHeader header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Scene cache " + cachePath + " is truncated");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, sceneCacheMagic, 4) != 0 || header.version != sceneCacheVersion) {
+        throw std::runtime_error("Not a scene cache, or unsupported version: " + cachePath);
+    }
+    if (header.numGaussians < 0 || header.sphericalHarmonicsDegree < 0 || header.sphericalHarmonicsDegree > 3 || header.fileSize != data.size()) {
+        throw std::runtime_error("Invalid scene cache header in " + cachePath);
+    }
+
+    const auto sizes = columnSizes(header.numGaussians, header.sphericalHarmonicsDegree);
+    for (int column = 0; column < nColumns; ++column) {
+        const uint64_t offset = header.columnOffsets[column];
+        if (offset % columnAlignment != 0 || offset > data.size() || sizes[column] > data.size() - offset) {
+            throw std::runtime_error("Scene cache " + cachePath + " is truncated");
+        }
+    }
+
+    numGaussians = header.numGaussians;
+    sphericalHarmonicsDegree = header.sphericalHarmonicsDegree;
+    maxShDegree = header.maxShDegree;
+    shLayout = static_cast<ShLayout>(header.shLayout);
+    source = { header.sourceSize, header.sourceModifiedTime, header.sourceHash };
+
+    const size_t n = numGaussians;
+    auto column = [&](int index) { return data.data() + header.columnOffsets[index]; };
+    positions = { reinterpret_cast<const std::array<float, 3>*>(column(0)), n };
+    logScales = { reinterpret_cast<const std::array<float, 3>*>(column(1)), n };
+    rotQuats = { reinterpret_cast<const std::array<float, 4>*>(column(2)), n };
+    opacityLogits = { reinterpret_cast<const float*>(column(3)), n };
+    shCoeffs = { reinterpret_cast<const float*>(column(4)), sizes[4] / sizeof(float) };
+}
+
+int MappedScene::nShCoeffs() const {
+    return (sphericalHarmonicsDegree + 1) * (sphericalHarmonicsDegree + 1);
+}
+
+bool MappedScene::matches(const std::string& sourcePath, bool verifyContent, int nThreads) const {
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(sourcePath, error);
+    if (error || size != source.size) {
+        return false;
+    }
+    if (!verifyContent && modifiedTime(sourcePath) == source.modifiedTime) {
+        return true;
+    }
+    return fingerprintFile(sourcePath, nThreads).contentHash == source.contentHash;
+}
+
+PackedGaussians MappedScene::toPackedGaussians() const {
+    PackedGaussians gaussians;
+    gaussians.numGaussians = numGaussians;
+    gaussians.sphericalHarmonicsDegree = sphericalHarmonicsDegree;
+    gaussians.shLayout = shLayout;
+    gaussians.positions.assign(positions.begin(), positions.end());
+    gaussians.logScales.assign(logScales.begin(), logScales.end());
+    gaussians.rotQuats.assign(rotQuats.begin(), rotQuats.end());
+    gaussians.opacityLogits.assign(opacityLogits.begin(), opacityLogits.end());
+    gaussians.shCoeffs.assign(shCoeffs.begin(), shCoeffs.end());
+    return gaussians;
+}
+
+std::optional<MappedScene> openSceneCache(const std::string& sourcePath, const std::string& cachePath, const SceneCacheOptions& options) {
+    std::optional<MappedScene> scene;
+    try {
+        scene.emplace(cachePath);
+    }
+    catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+    // Read before matching, so a source modified while it is hashed keeps a
+    // time that differs from the one stored below.
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(sourcePath, error);
+    if (error || scene->maxShDegree != options.maxShDegree || scene->shLayout != options.shLayout || !scene->matches(sourcePath, options.verifyContent, options.nThreads)) {
+        return std::nullopt;
+    }
+    // A touched or copied source matched by content: store its time so later
+    // opens skip the hash.
+    const int64_t sourceTime = static_cast<int64_t>(time.time_since_epoch().count());
+    if (sourceTime != scene->source.modifiedTime) {
+        updateSourceModifiedTime(cachePath, sourceTime);
+        scene->source.modifiedTime = sourceTime;
+    }
+    return scene;
+}
+
+MappedScene loadSceneCached(const std::string& sourcePath, const std::string& cachePath, const SceneCacheOptions& options) {
+    if (auto scene = openSceneCache(sourcePath, cachePath, options)) {
+        return std::move(*scene);
+    }
+
+    // Fingerprint first, so a source modified while loading makes the cache stale.
+    const SourceFingerprint source = fingerprintFile(sourcePath, options.nThreads);
+    LoadOptions loadOptions;
+    loadOptions.nThreads = options.nThreads;
+    loadOptions.maxShDegree = options.maxShDegree;
+    loadOptions.shLayout = options.shLayout;
+    const PackedGaussians gaussians = loadPackedGaussians(sourcePath, loadOptions);
+    writeSceneCache(cachePath, gaussians, source, options.maxShDegree);
+    return MappedScene(cachePath);
+}
@@ -0,0 +1,82 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include "ply.h"
+#include "mapped_file.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <string>
+#include <optional>
+#include <cstdint>
+
+// 64-bit hash of `data`, computed over 64 MiB chunks in parallel and then
+// over the chunk hashes, so it does not depend on the thread count.
+uint64_t hashBytes(std::span<const uint8_t> data, int nThreads = 0);
+
+// Identifies the PLY a cache was built from. Size and modification time are
+// compared first; the content hash settles it when they disagree.
+struct SourceFingerprint {
+    uint64_t size;
+    int64_t modifiedTime;
+    uint64_t contentHash;
+};
+
+SourceFingerprint fingerprintFile(const std::string& filePath, int nThreads = 0);
+
+struct SceneCacheOptions {
+    // Threads used to load the PLY and hash it.
+    int nThreads = 0;
+    int maxShDegree = 3;
+    ShLayout shLayout = ShLayout::Interleaved;
+    // Hash the source even when its size and modification time match.
+    bool verifyContent = false;
+};
+
+// Writes `gaussians` as a scene cache: a header followed by one 64-byte
+// aligned column per attribute, in host byte order. The file is written
+// next to cachePath and renamed over it once complete.
+void writeSceneCache(const std::string& cachePath, const PackedGaussians& gaussians, const SourceFingerprint& source, int maxShDegree = 3);
+
+// Read-only view of a scene cache. The columns point straight into the
+// mapping, so opening one costs no decoding and no copies regardless of the
+// scene size; toPackedGaussians() copies them out for code that needs one.
+class MappedScene {
+public:
+    int numGaussians;
+    int sphericalHarmonicsDegree;
+    // Degree limit the cache was loaded with.
+    int maxShDegree;
+    ShLayout shLayout;
+    SourceFingerprint source;
+
+    std::span<const std::array<float, 3>> positions;
+    std::span<const std::array<float, 3>> logScales;
+    std::span<const std::array<float, 4>> rotQuats;
+    std::span<const float> opacityLogits;
+    std::span<const float> shCoeffs;
+
+    // Throws std::runtime_error when the file is not a scene cache of this
+    // version or is truncated.
+    explicit MappedScene(const std::string& cachePath);
+
+    int nShCoeffs() const;
+    // Whether the cache was built from the current contents of sourcePath.
+    bool matches(const std::string& sourcePath, bool verifyContent = false, int nThreads = 0) const;
+    PackedGaussians toPackedGaussians() const;
+
+private:
+    MappedFile file;
+};
+
+// Maps cachePath when it is a valid cache of sourcePath built with the same
+// options, and returns nothing otherwise. When only the source's modification
+// time changed, the new time is written to the cache so the next open does
+// not hash the source again.
+std::optional<MappedScene> openSceneCache(const std::string& sourcePath, const std::string& cachePath, const SceneCacheOptions& options = {});
+
+// Maps cachePath if it is up to date, otherwise loads sourcePath, rewrites
+// the cache and maps the new one.
+MappedScene loadSceneCached(const std::string& sourcePath, const std::string& cachePath, const SceneCacheOptions& options = {});
+
+#endif // SCENE_CACHE_H
@@ -0,0 +1,598 @@
+#include "sequence.h"
+#include "binary_io.h"
+#include "parallel.h"
+#include "trace.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+
+static const char sequenceMagic[4] = { 'G', 'S', 'Q', '4' };
+static const uint32_t sequenceVersion = 1;
+// Magic and version, splat count, SH degree and frame count as uint64, frame
+// rate and padding, then the offset of the frame index.
+static const size_t sequenceHeaderSize = 8 + 3 * sizeof(uint64_t) + 2 * sizeof(float) + sizeof(uint64_t);
+// Offset and size as uint64, then keyframe flag and changed count as uint32.
+static const size_t frameEntrySize = 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+// Field mask and changed count as uint32, then one float scale per field.
+static const size_t deltaHeaderSize = 2 * sizeof(uint32_t) + 5 * sizeof(float);
+
+// Values per splat of every field, in VertexField order.
+static std::array<int, 5> fieldWidths(int shDegree) {
+    return { 3, 3, 4, 1, (shDegree + 1) * (shDegree + 1) * 3 };
+}
+
+// Bytes per value of every quantized field: 16 bits, and 8 for SH.
+static size_t quantizedSize(int field) {
+    return field == static_cast<int>(VertexField::ShCoeff) ? 1 : 2;
+}
+
+static float quantizationRange(int field) {
+    return field == static_cast<int>(VertexField::ShCoeff) ? 127.0f : 32767.0f;
+}
+
+static size_t keyframeSize(size_t splatCount, int shDegree) {
+    size_t values = 0;
+    for (int width : fieldWidths(shDegree)) {
+        values += width;
+    }
+    return splatCount * values * sizeof(float);
+}
+
+static size_t deltaSize(VertexFieldMask fields, size_t count, int shDegree) {
+    const auto widths = fieldWidths(shDegree);
+    size_t bytes = deltaHeaderSize + count * sizeof(uint32_t);
+    for (int field = 0; field < 5; ++field) {
+        if (fields & (1u << field)) {
+            bytes += count * widths[field] * quantizedSize(field);
+        }
+    }
+    return bytes;
+}
+
+// Base pointer of a field's values for splat 0 of an interleaved scene.
+static float* fieldValues(PackedGaussians& scene, int field) {
+    switch (static_cast<VertexField>(field)) {
+    case VertexField::Position: return scene.positions.data()->data();
+    case VertexField::LogScale: return scene.logScales.data()->data();
+    case VertexField::RotQuat: return scene.rotQuats.data()->data();
+    case VertexField::OpacityLogit: return scene.opacityLogits.data();
+    case VertexField::ShCoeff: return scene.shCoeffs.data();
+    }
+    return nullptr;
+}
+
+static const float* fieldValues(const SequenceDelta& delta, int field) {
+    switch (static_cast<VertexField>(field)) {
+    case VertexField::Position: return delta.positions.data()->data();
+    case VertexField::LogScale: return delta.logScales.data()->data();
+    case VertexField::RotQuat: return delta.rotQuats.data()->data();
+    case VertexField::OpacityLogit: return delta.opacityLogits.data();
+    case VertexField::ShCoeff: return delta.shCoeffs.data();
+    }
+    return nullptr;
+}
+
+static float* fieldValues(SequenceDelta& delta, int field) {
+    return const_cast<float*>(fieldValues(static_cast<const SequenceDelta&>(delta), field));
+}
+
+static void resizeDelta(SequenceDelta& delta, size_t count, int shDegree) {
+    delta.indices.resize(count);
+    delta.positions.resize(count);
+    delta.logScales.resize(count);
+    delta.rotQuats.resize(count);
+    delta.opacityLogits.resize(count);
+    delta.shCoeffs.resize(count * fieldWidths(shDegree)[4]);
+}
+
+void SequenceDelta::apply(PackedGaussians& scene, int nThreads) const {
+    ScopedTimer timer("applyDelta");
+    if (scene.shLayout != ShLayout::Interleaved) {
+        throw std::invalid_argument("Sequence deltas need the interleaved SH layout");
+    }
+    const auto widths = fieldWidths(scene.sphericalHarmonicsDegree);
+    parallelFor(indices.size(), nThreads, [&](int, size_t begin, size_t end) {
+        for (int field = 0; field < 5; ++field) {
+            if (!(fields & (1u << field))) {
+                continue;
+            }
+            const int width = widths[field];
+            float* target = fieldValues(scene, field);
+            const float* source = fieldValues(*this, field);
+            for (size_t k = begin; k < end; ++k) {
+                float* splat = target + static_cast<size_t>(indices[k]) * width;
+                for (int v = 0; v < width; ++v) {
+                    splat[v] += source[k * width + v];
+                }
+            }
+        }
+    });
+}
+
+SequenceWriter::SequenceWriter(const std::string& filePath, const SequenceWriteOptions& options)
+    : filePath(filePath), options(options), file(filePath, std::ios::binary), position(sequenceHeaderSize) {
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+    if (!(options.frameRate > 0.0f) || options.keyframeInterval < 0) {
+        throw std::invalid_argument("Invalid sequence frame rate or keyframe interval");
+    }
+    const std::vector<char> header(sequenceHeaderSize, 0);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+int SequenceWriter::frameCount() const {
+    return static_cast<int>(frames.size());
+}
+
+size_t SequenceWriter::bytesWritten() const {
+    return position;
+}
+
+void SequenceWriter::addFrame(const PackedGaussians& frame) {
+    ScopedTimer timer("addFrame");
+    if (!frames.empty() && (frame.numGaussians != decoded.numGaussians || frame.sphericalHarmonicsDegree != decoded.sphericalHarmonicsDegree)) {
+        throw std::invalid_argument("Every frame of a sequence needs the same splats");
+    }
+    const uint64_t offset = position;
+    const bool keyframe = frames.empty() || (options.keyframeInterval > 0 && frames.size() % options.keyframeInterval == 0);
+    if (keyframe) {
+        writeKeyframe(frame);
+    }
+    else {
+        writeDelta(frame);
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+    frames.push_back({ offset, position - offset, keyframe ? 1u : 0u, keyframe ? static_cast<uint32_t>(frame.numGaussians) : static_cast<uint32_t>(delta.indices.size()) });
+    timer.addBytes(position - offset);
+}
+
+void SequenceWriter::writeKeyframe(const PackedGaussians& frame) {
+    decoded = frame;
+    decoded.setShLayout(ShLayout::Interleaved);
+    decoded.sourceIndices.clear();
+    writeValues(file, decoded.positions.data(), decoded.positions.size());
+    writeValues(file, decoded.logScales.data(), decoded.logScales.size());
+    writeValues(file, decoded.rotQuats.data(), decoded.rotQuats.size());
+    writeValues(file, decoded.opacityLogits.data(), decoded.opacityLogits.size());
+    writeValues(file, decoded.shCoeffs.data(), decoded.shCoeffs.size());
+    position += keyframeSize(decoded.numGaussians, decoded.sphericalHarmonicsDegree);
+}
+
+void SequenceWriter::writeDelta(const PackedGaussians& frame) {
+    const size_t n = decoded.numGaussians;
+    const auto widths = fieldWidths(decoded.sphericalHarmonicsDegree);
+    const int nSlices = parallelSlices(n, options.nThreads);
+
+    // Value v of `field` for splat i of the new frame.
+    auto frameValue = [&](int field, size_t i, int v) {
+        switch (static_cast<VertexField>(field)) {
+        case VertexField::Position: return frame.positions[i][v];
+        case VertexField::LogScale: return frame.logScales[i][v];
+        case VertexField::RotQuat: return frame.rotQuats[i][v];
+        case VertexField::OpacityLogit: return frame.opacityLogits[i];
+        case VertexField::ShCoeff: return frame.shCoeff(static_cast<int>(i), v / 3, v % 3);
+        }
+        return 0.0f;
+    };
+
+    // Changed splats and the largest change of every field, per slice.
+    std::vector<std::vector<uint32_t>> sliceChanged(nSlices);
+    std::vector<std::array<float, 5>> sliceMaxima(nSlices, { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f });
+    parallelFor(n, options.nThreads, [&](int slice, size_t begin, size_t end) {
+        std::array<float, 5> splatMaxima;
+        for (size_t i = begin; i < end; ++i) {
+            float largest = 0.0f;
+            for (int field = 0; field < 5; ++field) {
+                const float* previous = fieldValues(decoded, field) + i * widths[field];
+                splatMaxima[field] = 0.0f;
+                for (int v = 0; v < widths[field]; ++v) {
+                    splatMaxima[field] = std::max(splatMaxima[field], std::abs(frameValue(field, i, v) - previous[v]));
+                }
+                largest = std::max(largest, splatMaxima[field]);
+            }
+            if (largest > options.changeThreshold) {
+                sliceChanged[slice].push_back(static_cast<uint32_t>(i));
+                for (int field = 0; field < 5; ++field) {
+                    sliceMaxima[slice][field] = std::max(sliceMaxima[slice][field], splatMaxima[field]);
+                }
+            }
+        }
+    });
+
+    std::vector<size_t> sliceOffsets(nSlices + 1, 0);
+    std::array<float, 5> scales = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int slice = 0; slice < nSlices; ++slice) {
+        sliceOffsets[slice + 1] = sliceOffsets[slice] + sliceChanged[slice].size();
+        for (int field = 0; field < 5; ++field) {
+            scales[field] = std::max(scales[field], sliceMaxima[slice][field]);
+        }
+    }
+    const size_t count = sliceOffsets[nSlices];
+    delta.fields = 0;
+    for (int field = 0; field < 5; ++field) {
+        if (scales[field] > 0.0f) {
+            delta.fields |= 1u << field;
+            scales[field] /= quantizationRange(field);
+        }
+    }
+    resizeDelta(delta, count, decoded.sphericalHarmonicsDegree);
+    for (int slice = 0; slice < nSlices; ++slice) {
+        std::copy(sliceChanged[slice].begin(), sliceChanged[slice].end(), delta.indices.begin() + sliceOffsets[slice]);
+    }
+
+    // Quantize every field into its block of the payload and keep the
+    // dequantized deltas to advance `decoded` exactly as a player will.
+    std::vector<uint8_t> payload(deltaSize(delta.fields, count, decoded.sphericalHarmonicsDegree));
+    const uint32_t header[2] = { delta.fields, static_cast<uint32_t>(count) };
+    std::memcpy(payload.data(), header, sizeof(header));
+    std::memcpy(payload.data() + sizeof(header), scales.data(), sizeof(scales));
+    std::memcpy(payload.data() + deltaHeaderSize, delta.indices.data(), count * sizeof(uint32_t));
+    size_t blockOffset = deltaHeaderSize + count * sizeof(uint32_t);
+    for (int field = 0; field < 5; ++field) {
+        if (!(delta.fields & (1u << field))) {
+            continue;
+        }
+        const int width = widths[field];
+        const float range = quantizationRange(field);
+        uint8_t* block = payload.data() + blockOffset;
+        float* dequantized = fieldValues(delta, field);
+        const float* previous = fieldValues(decoded, field);
+        parallelFor(count, options.nThreads, [&](int, size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                const size_t i = delta.indices[k];
+                for (int v = 0; v < width; ++v) {
+                    const float change = frameValue(field, i, v) - previous[i * width + v];
+                    const float q = std::clamp(std::round(change / scales[field]), -range, range);
+                    const size_t value = k * width + v;
+                    if (quantizedSize(field) == 1) {
+                        block[value] = static_cast<uint8_t>(static_cast<int8_t>(q));
+                    }
+                    else {
+                        const int16_t q16 = static_cast<int16_t>(q);
+                        std::memcpy(block + value * 2, &q16, 2);
+                    }
+                    dequantized[value] = q * scales[field];
+                }
+            }
+        });
+        blockOffset += count * width * quantizedSize(field);
+    }
+    delta.apply(decoded, options.nThreads);
+
+    writeValues(file, payload.data(), payload.size());
+    position += payload.size();
+}
+
+void SequenceWriter::finish() {
+    const uint64_t indexOffset = position;
+    for (const auto& frame : frames) {
+        const uint64_t location[2] = { frame.offset, frame.byteSize };
+        const uint32_t flags[2] = { frame.keyframe, frame.changed };
+        writeValues(file, location, 2);
+        writeValues(file, flags, 2);
+    }
+    position += frames.size() * frameEntrySize;
+
+    file.seekp(0);
+    const uint64_t counts[3] = { static_cast<uint64_t>(decoded.numGaussians), static_cast<uint64_t>(decoded.sphericalHarmonicsDegree), frames.size() };
+    const float rate[2] = { options.frameRate, 0.0f };
+    writeValues(file, sequenceMagic, 4);
+    writeValues(file, &sequenceVersion, 1);
+    writeValues(file, counts, 3);
+    writeValues(file, rate, 2);
+    writeValues(file, &indexOffset, 1);
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
+
+SequencePlayer::SequencePlayer(const std::string& filePath, const PlayerOptions& options)
+    : options(options), file(filePath), counters{} {
+    if (options.ringFrames <= 0) {
+        throw std::invalid_argument("ringFrames must be positive");
+    }
+    const auto data = file.data();
+    if (data.size() < sequenceHeaderSize || std::memcmp(data.data(), sequenceMagic, 4) != 0) {
+        throw std::runtime_error("Not a sequence file");
+    }
+    uint32_t version;
+    uint64_t counts[3];
+    float rates[2];
+    uint64_t indexOffset;
+    std::memcpy(&version, data.data() + 4, sizeof(version));
+    std::memcpy(counts, data.data() + 8, sizeof(counts));
+    std::memcpy(rates, data.data() + 32, sizeof(rates));
+    std::memcpy(&indexOffset, data.data() + 40, sizeof(indexOffset));
+    if (version != sequenceVersion) {
+        throw std::runtime_error("Unsupported sequence version");
+    }
+    if (counts[0] > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) || counts[1] > 3 || counts[2] == 0
+        || indexOffset > data.size() || counts[2] > (data.size() - indexOffset) / frameEntrySize || !(rates[0] > 0.0f)) {
+        throw std::runtime_error("Invalid sequence header");
+    }
+    splatCount = static_cast<int>(counts[0]);
+    shDegree = static_cast<int>(counts[1]);
+    rate = rates[0];
+
+    frames.resize(counts[2]);
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const uint8_t* entry = data.data() + indexOffset + f * frameEntrySize;
+        uint32_t flags[2];
+        std::memcpy(&frames[f].offset, entry, sizeof(uint64_t));
+        std::memcpy(&frames[f].byteSize, entry + 8, sizeof(uint64_t));
+        std::memcpy(flags, entry + 16, sizeof(flags));
+        frames[f].keyframe = flags[0] != 0;
+        bool valid = frames[f].offset <= indexOffset && frames[f].byteSize <= indexOffset - frames[f].offset;
+        if (valid && frames[f].keyframe) {
+            valid = frames[f].byteSize == keyframeSize(splatCount, shDegree);
+        }
+        else if (valid) {
+            uint32_t header[2];
+            valid = frames[f].byteSize >= deltaHeaderSize;
+            if (valid) {
+                std::memcpy(header, data.data() + frames[f].offset, sizeof(header));
+                valid = header[0] <= allVertexFields && header[1] <= static_cast<uint32_t>(splatCount)
+                    && frames[f].byteSize == deltaSize(header[0], header[1], shDegree);
+            }
+        }
+        if (!valid) {
+            throw std::runtime_error("Invalid sequence frame index");
+        }
+    }
+    if (!frames[0].keyframe) {
+        throw std::runtime_error("Sequence does not start with a keyframe");
+    }
+
+    gaussians.numGaussians = splatCount;
+    gaussians.sphericalHarmonicsDegree = shDegree;
+    gaussians.shLayout = ShLayout::Interleaved;
+    gaussians.positions.resize(splatCount);
+    gaussians.logScales.resize(splatCount);
+    gaussians.rotQuats.resize(splatCount);
+    gaussians.opacityLogits.resize(splatCount);
+    gaussians.shCoeffs.resize(static_cast<size_t>(splatCount) * gaussians.nShCoeffs() * 3);
+    slots.resize(options.ringFrames);
+    seek(0);
+    decoder = std::thread(&SequencePlayer::decodeLoop, this);
+}
+
+SequencePlayer::~SequencePlayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    readyChanged.notify_all();
+    if (decoder.joinable()) {
+        decoder.join();
+    }
+}
+
+int SequencePlayer::frameCount() const {
+    return static_cast<int>(frames.size());
+}
+
+float SequencePlayer::frameRate() const {
+    return rate;
+}
+
+int SequencePlayer::frame() const {
+    return currentFrame;
+}
+
+const PackedGaussians& SequencePlayer::scene() const {
+    return gaussians;
+}
+
+const std::vector<uint32_t>& SequencePlayer::changedSplats() const {
+    return changed;
+}
+
+VertexFieldMask SequencePlayer::changedFields() const {
+    return changedMask;
+}
+
+PlayerStats SequencePlayer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void SequencePlayer::decodeFrame(int frame, SequenceDelta& delta, bool& keyframe) const {
+    ScopedTimer timer("decodeFrame");
+    const auto& entry = frames[frame];
+    keyframe = entry.keyframe;
+    if (keyframe) {
+        return;
+    }
+    const uint8_t* payload = file.data().data() + entry.offset;
+    uint32_t header[2];
+    std::array<float, 5> scales;
+    std::memcpy(header, payload, sizeof(header));
+    std::memcpy(scales.data(), payload + sizeof(header), sizeof(scales));
+    const size_t count = header[1];
+    delta.fields = header[0];
+    resizeDelta(delta, count, shDegree);
+    std::memcpy(delta.indices.data(), payload + deltaHeaderSize, count * sizeof(uint32_t));
+    for (uint32_t index : delta.indices) {
+        if (index >= static_cast<uint32_t>(splatCount)) {
+            throw std::runtime_error("Invalid splat index in sequence frame " + std::to_string(frame));
+        }
+    }
+
+    const auto widths = fieldWidths(shDegree);
+    size_t blockOffset = deltaHeaderSize + count * sizeof(uint32_t);
+    for (int field = 0; field < 5; ++field) {
+        if (!(delta.fields & (1u << field))) {
+            continue;
+        }
+        const size_t nValues = count * widths[field];
+        const uint8_t* block = payload + blockOffset;
+        float* values = fieldValues(delta, field);
+        const float scale = scales[field];
+        parallelFor(nValues, options.nThreads, [&](int, size_t begin, size_t end) {
+            if (quantizedSize(field) == 1) {
+                for (size_t v = begin; v < end; ++v) {
+                    values[v] = static_cast<float>(static_cast<int8_t>(block[v])) * scale;
+                }
+            }
+            else {
+                for (size_t v = begin; v < end; ++v) {
+                    int16_t q;
+                    std::memcpy(&q, block + v * 2, 2);
+                    values[v] = static_cast<float>(q) * scale;
+                }
+            }
+        });
+        blockOffset += nValues * quantizedSize(field);
+    }
+    timer.addBytes(entry.byteSize);
+}
+
+void SequencePlayer::applyKeyframe(int frame) {
+    const uint8_t* payload = file.data().data() + frames[frame].offset;
+    auto copyColumn = [&](void* destination, size_t bytes) {
+        std::memcpy(destination, payload, bytes);
+        payload += bytes;
+    };
+    copyColumn(gaussians.positions.data(), gaussians.positions.size() * sizeof(gaussians.positions[0]));
+    copyColumn(gaussians.logScales.data(), gaussians.logScales.size() * sizeof(gaussians.logScales[0]));
+    copyColumn(gaussians.rotQuats.data(), gaussians.rotQuats.size() * sizeof(gaussians.rotQuats[0]));
+    copyColumn(gaussians.opacityLogits.data(), gaussians.opacityLogits.size() * sizeof(float));
+    copyColumn(gaussians.shCoeffs.data(), gaussians.shCoeffs.size() * sizeof(float));
+}
+
+void SequencePlayer::applySlot(const Slot& slot) {
+    if (slot.keyframe) {
+        applyKeyframe(slot.frame);
+        changed.clear();
+        changedMask = allVertexFields;
+    }
+    else {
+        slot.delta.apply(gaussians, options.nThreads);
+        changed.assign(slot.delta.indices.begin(), slot.delta.indices.end());
+        changedMask = slot.delta.fields;
+    }
+    currentFrame = slot.frame;
+}
+
+bool SequencePlayer::advance() {
+    return advanceFrame(true);
+}
+
+bool SequencePlayer::tryAdvance() {
+    return advanceFrame(false);
+}
+
+bool SequencePlayer::advanceFrame(bool wait) {
+    if (!options.loop && currentFrame + 1 >= frameCount()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ready == 0) {
+        ++counters.stalls;
+        if (!wait) {
+            return false;
+        }
+        readyChanged.wait(lock, [&] { return ready > 0; });
+    }
+    const Slot& slot = slots[head];
+    lock.unlock();
+
+    const auto start = Clock::now();
+    applySlot(slot);
+    const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    lock.lock();
+    head = (head + 1) % slots.size();
+    --ready;
+    ++counters.appliedFrames;
+    counters.applyMilliseconds += milliseconds;
+    lock.unlock();
+    readyChanged.notify_all();
+    return true;
+}
+
+void SequencePlayer::seek(int frame) {
+    if (frame < 0 || frame >= frameCount()) {
+        throw std::out_of_range("Sequence frame out of range");
+    }
+    int keyframe = frame;
+    while (!frames[keyframe].keyframe) {
+        --keyframe;
+    }
+    applyKeyframe(keyframe);
+    for (int f = keyframe + 1; f <= frame; ++f) {
+        bool isKeyframe;
+        decodeFrame(f, seekDelta, isKeyframe);
+        seekDelta.apply(gaussians, options.nThreads);
+    }
+    currentFrame = frame;
+    changed.clear();
+    changedMask = allVertexFields;
+    restartDecoder(frame + 1);
+}
+
+void SequencePlayer::restartDecoder(int firstFrame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++generation;
+        head = 0;
+        ready = 0;
+        if (firstFrame >= frameCount()) {
+            firstFrame = options.loop ? 0 : -1;
+        }
+        nextDecode = firstFrame;
+    }
+    readyChanged.notify_all();
+}
+
+void SequencePlayer::decodeLoop() {
+    const double budgetMilliseconds = 1000.0 / rate;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        readyChanged.wait(lock, [&] { return stopping || (nextDecode >= 0 && ready < slots.size()); });
+        if (stopping) {
+            return;
+        }
+        const int frame = nextDecode;
+        const uint64_t decodeGeneration = generation;
+        Slot& slot = slots[(head + ready) % slots.size()];
+        lock.unlock();
+
+        const auto start = Clock::now();
+        try {
+            decodeFrame(frame, slot.delta, slot.keyframe);
+        }
+        catch (const std::exception& e) {
+            // The frame index was validated up front; only corrupt indices
+            // get here. Play on without the frame's changes.
+            logMessage(LogLevel::Error, e.what());
+            slot.keyframe = false;
+            slot.delta.fields = 0;
+            slot.delta.indices.clear();
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        lock.lock();
+        ++counters.decodedFrames;
+        counters.decodeMilliseconds += milliseconds;
+        if (milliseconds > budgetMilliseconds) {
+            ++counters.overBudget;
+        }
+        if (decodeGeneration != generation) {
+            continue;
+        }
+        slot.frame = frame;
+        ++ready;
+        nextDecode = frame + 1 < frameCount() ? frame + 1 : (options.loop ? 0 : -1);
+        readyChanged.notify_all();
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include "ply.h"
+#include "scene_buffer.h"
+#include "mapped_file.h"
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+// Changes of one frame of a sequence: the splats that changed and, for every
+// field in `fields`, the amount to add to each of them. SH is interleaved.
+struct SequenceDelta {
+    VertexFieldMask fields = 0;
+    std::vector<uint32_t> indices;
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 3>> logScales;
+    std::vector<std::array<float, 4>> rotQuats;
+    std::vector<float> opacityLogits;
+    std::vector<float> shCoeffs;
+
+    // Adds the deltas to `scene`, which must use the interleaved SH layout.
+    void apply(PackedGaussians& scene, int nThreads) const;
+};
+
+struct SequenceWriteOptions {
+    float frameRate = 30.0f;
+    // Every this many frames the whole scene is stored again, so players can
+    // seek without replaying from the start. 0 stores only frame 0 whole.
+    int keyframeInterval = 0;
+    // Splats whose values all stay within this of the previous frame are left
+    // out of the frame.
+    float changeThreshold = 1e-6f;
+    int nThreads = 1;
+};
+
+// Writes a sequence of scenes with the same splats as one file: frame 0 and
+// every keyframeInterval-th frame whole, the others as deltas against the
+// frame before. A delta lists the changed splats and quantizes the changes of
+// each field with one scale per frame, to 16 bits for positions, scales,
+// rotations and opacities and to 8 bits for SH. Deltas are taken against the
+// frame as a player will decode it, so quantization errors do not add up.
+class SequenceWriter {
+public:
+    SequenceWriter(const std::string& filePath, const SequenceWriteOptions& options = {});
+
+    SequenceWriter(const SequenceWriter&) = delete;
+    SequenceWriter& operator=(const SequenceWriter&) = delete;
+
+    void addFrame(const PackedGaussians& frame);
+    // Writes the frame index. The file is unusable until this is called.
+    void finish();
+
+    int frameCount() const;
+    size_t bytesWritten() const;
+
+private:
+    struct FrameEntry {
+        uint64_t offset;
+        uint64_t byteSize;
+        uint32_t keyframe;
+        uint32_t changed;
+    };
+
+    std::string filePath;
+    SequenceWriteOptions options;
+    std::ofstream file;
+    std::vector<FrameEntry> frames;
+    // The last frame as a player decodes it.
+    PackedGaussians decoded;
+    SequenceDelta delta;
+    uint64_t position;
+
+    void writeKeyframe(const PackedGaussians& frame);
+    void writeDelta(const PackedGaussians& frame);
+};
+
+struct PlayerOptions {
+    // Frames decoded ahead of the one shown.
+    int ringFrames = 4;
+    // Threads used to decode and to apply each frame.
+    int nThreads = 1;
+    // Continue with frame 0 after the last frame.
+    bool loop = false;
+};
+
+struct PlayerStats {
+    uint64_t decodedFrames;
+    uint64_t appliedFrames;
+    // advance() calls that had to wait for the decoder, and tryAdvance()
+    // calls that found no frame ready.
+    uint64_t stalls;
+    // Frames that took longer to decode than one frame period.
+    uint64_t overBudget;
+    double decodeMilliseconds;
+    double applyMilliseconds;
+};
+
+// Plays a file written by SequenceWriter. A background thread decodes the
+// frames after the current one into a ring of reusable buffers, and advance()
+// applies the next one to scene() in place. advance(), tryAdvance() and
+// seek() must be called from one thread.
+class SequencePlayer {
+public:
+    explicit SequencePlayer(const std::string& filePath, const PlayerOptions& options = {});
+    ~SequencePlayer();
+
+    SequencePlayer(const SequencePlayer&) = delete;
+    SequencePlayer& operator=(const SequencePlayer&) = delete;
+
+    int frameCount() const;
+    float frameRate() const;
+    // Frame scene() currently shows. SH is interleaved.
+    int frame() const;
+    const PackedGaussians& scene() const;
+
+    // Shows the next frame, waiting for the decoder if needed. Returns false
+    // after the last frame unless looping.
+    bool advance();
+    // Shows the next frame if it has been decoded already.
+    bool tryAdvance();
+    // Rebuilds the frame from the keyframe at or before it.
+    void seek(int frame);
+
+    // What the last advance() or seek() changed, for updating packed
+    // buffers and invalidating SplatRasterizer caches: all fields of every splat after a keyframe, with
+    // changedSplats() empty, and the listed splats' changedFields() otherwise.
+    const std::vector<uint32_t>& changedSplats() const;
+    VertexFieldMask changedFields() const;
+
+    PlayerStats stats() const;
+
+private:
+    struct FrameEntry {
+        uint64_t offset;
+        uint64_t byteSize;
+        bool keyframe;
+    };
+
+    struct Slot {
+        int frame;
+        bool keyframe;
+        SequenceDelta delta;
+    };
+
+    PlayerOptions options;
+    MappedFile file;
+    int splatCount;
+    int shDegree;
+    float rate;
+    std::vector<FrameEntry> frames;
+    PackedGaussians gaussians;
+    int currentFrame = 0;
+    std::vector<uint32_t> changed;
+    VertexFieldMask changedMask = 0;
+    SequenceDelta seekDelta;
+
+    mutable std::mutex mutex;
+    std::condition_variable readyChanged;
+    // Slots [head, head + ready) of the ring are decoded; the one at head is
+    // applied next and stays owned by the player until it has been applied.
+    std::vector<Slot> slots;
+    size_t head = 0;
+    size_t ready = 0;
+    int nextDecode = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+    PlayerStats counters;
+    std::thread decoder;
+
+    void decodeFrame(int frame, SequenceDelta& delta, bool& keyframe) const;
+    void applyKeyframe(int frame);
+    void applySlot(const Slot& slot);
+    bool advanceFrame(bool wait);
+    void restartDecoder(int firstFrame);
+    void decodeLoop();
+};
+
+#endif // SEQUENCE_H
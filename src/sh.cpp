@@ -0,0 +1,254 @@
+#include "sh.h"
+#include "sh_codebook.h"
+#include "parallel.h"
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+static const float shC0 = 0.28209479177387814f;
+static const float shC1 = 0.4886025119029199f;
+static const float shC2[] = { 1.0925484305920792f, -1.0925484305920792f, 0.31539156525252005f, -1.0925484305920792f, 0.5462742152960396f };
+static const float shC3[] = { -0.5900435899266435f, 2.890611442640554f, -0.4570457994644658f, 0.3731763325901154f, -0.4570457994644658f, 1.445305721320277f, -0.5900435899266435f };
+
+// Splats are evaluated in blocks of this many lanes. Every loop over lanes is
+// a fixed-length loop over stack arrays, which the compiler vectorizes for
+// whichever target the calling kernel below was compiled for.
+static constexpr int shLanes = 16;
+
+// Evaluates splats [begin, end), writing colors[i - begin]. With directions,
+// a block is skipped unless some splat's direction moved below minCosine
+// against directions[i - begin], and the directions of evaluated blocks are
+// updated. Returns the number of splats evaluated.
+template <int Degree>
+__attribute__((always_inline)) inline size_t evaluateShBlocks(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+    constexpr int nCoeffs = (Degree + 1) * (Degree + 1);
+    const bool planar = gaussians.shLayout == ShLayout::Planar;
+    const size_t n = gaussians.numGaussians;
+    const float* shCoeffs = gaussians.shCoeffs.data();
+    const float* positions = gaussians.positions.data()->data();
+
+    alignas(64) size_t splats[shLanes];
+    alignas(64) float x[shLanes], y[shLanes], z[shLanes];
+    alignas(64) float coeffs[nCoeffs * 3][shLanes];
+    alignas(64) float basis[nCoeffs][shLanes];
+    alignas(64) float rgb[3][shLanes];
+    size_t nEvaluated = 0;
+
+    for (size_t first = begin; first < end; first += shLanes) {
+        // A partial last block repeats its final splat in the unused lanes.
+        const int count = static_cast<int>(std::min<size_t>(shLanes, end - first));
+        for (int lane = 0; lane < shLanes; ++lane) {
+            splats[lane] = first + std::min(lane, count - 1);
+        }
+        for (int lane = 0; lane < shLanes; ++lane) {
+            x[lane] = positions[splats[lane] * 3] - cameraPosition[0];
+            y[lane] = positions[splats[lane] * 3 + 1] - cameraPosition[1];
+            z[lane] = positions[splats[lane] * 3 + 2] - cameraPosition[2];
+        }
+        for (int lane = 0; lane < shLanes; ++lane) {
+            const float inverseLength = 1.0f / std::sqrt(x[lane] * x[lane] + y[lane] * y[lane] + z[lane] * z[lane] + 1e-24f);
+            x[lane] *= inverseLength;
+            y[lane] *= inverseLength;
+            z[lane] *= inverseLength;
+        }
+
+        if (directions) {
+            std::array<float, 3>* previous = directions + (first - begin);
+            int changed = 0;
+            for (int lane = 0; lane < count; ++lane) {
+                changed |= x[lane] * previous[lane][0] + y[lane] * previous[lane][1] + z[lane] * previous[lane][2] < minCosine;
+            }
+            if (!changed) {
+                continue;
+            }
+            for (int lane = 0; lane < count; ++lane) {
+                previous[lane] = { x[lane], y[lane], z[lane] };
+            }
+        }
+
+        if (codebook) {
+            // DC from the scene, the higher bands from each splat's codeword.
+            const size_t dcStride = static_cast<size_t>(gaussians.nShCoeffs()) * 3;
+            const float* codewords = codebook->codewords.data();
+            const uint16_t* indices = codebook->indices.data();
+            for (int lane = 0; lane < shLanes; ++lane) {
+                for (int c = 0; c < 3; ++c) {
+                    coeffs[c][lane] = planar ? shCoeffs[c * n + splats[lane]] : shCoeffs[splats[lane] * dcStride + c];
+                }
+                const float* source = codewords + static_cast<size_t>(indices[splats[lane]]) * (nCoeffs * 3 - 3);
+                for (int k = 3; k < nCoeffs * 3; ++k) {
+                    coeffs[k][lane] = source[k - 3];
+                }
+            }
+        }
+        else if (planar) {
+            for (int k = 0; k < nCoeffs * 3; ++k) {
+                for (int lane = 0; lane < shLanes; ++lane) {
+                    coeffs[k][lane] = shCoeffs[k * n + splats[lane]];
+                }
+            }
+        }
+        else {
+            for (int lane = 0; lane < shLanes; ++lane) {
+                const float* source = shCoeffs + splats[lane] * (nCoeffs * 3);
+                for (int k = 0; k < nCoeffs * 3; ++k) {
+                    coeffs[k][lane] = source[k];
+                }
+            }
+        }
+
+        for (int lane = 0; lane < shLanes; ++lane) {
+            const float dx = x[lane], dy = y[lane], dz = z[lane];
+            basis[0][lane] = shC0;
+            if constexpr (Degree >= 1) {
+                basis[1][lane] = -shC1 * dy;
+                basis[2][lane] = shC1 * dz;
+                basis[3][lane] = -shC1 * dx;
+            }
+            if constexpr (Degree >= 2) {
+                const float xx = dx * dx, yy = dy * dy, zz = dz * dz;
+                basis[4][lane] = shC2[0] * dx * dy;
+                basis[5][lane] = shC2[1] * dy * dz;
+                basis[6][lane] = shC2[2] * (2.0f * zz - xx - yy);
+                basis[7][lane] = shC2[3] * dx * dz;
+                basis[8][lane] = shC2[4] * (xx - yy);
+                if constexpr (Degree >= 3) {
+                    basis[9][lane] = shC3[0] * dy * (3.0f * xx - yy);
+                    basis[10][lane] = shC3[1] * dx * dy * dz;
+                    basis[11][lane] = shC3[2] * dy * (4.0f * zz - xx - yy);
+                    basis[12][lane] = shC3[3] * dz * (2.0f * zz - 3.0f * xx - 3.0f * yy);
+                    basis[13][lane] = shC3[4] * dx * (4.0f * zz - xx - yy);
+                    basis[14][lane] = shC3[5] * dz * (xx - yy);
+                    basis[15][lane] = shC3[6] * dx * (xx - 3.0f * yy);
+                }
+            }
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            for (int lane = 0; lane < shLanes; ++lane) {
+                rgb[c][lane] = 0.5f;
+            }
+        }
+        for (int k = 0; k < nCoeffs; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                for (int lane = 0; lane < shLanes; ++lane) {
+                    rgb[c][lane] += basis[k][lane] * coeffs[k * 3 + c][lane];
+                }
+            }
+        }
+
+        Color* out = colors + (first - begin);
+        for (int lane = 0; lane < count; ++lane) {
+            out[lane] = { std::max(rgb[0][lane], 0.0f), std::max(rgb[1][lane], 0.0f), std::max(rgb[2][lane], 0.0f) };
+        }
+        nEvaluated += count;
+    }
+    return nEvaluated;
+}
+
+template <int Degree>
+static size_t evaluateShScalar(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+    return evaluateShBlocks<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+}
+
+#if HAS_X86_SIMD
+template <int Degree>
+__attribute__((target("avx2,fma"))) static size_t evaluateShAvx2(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+    return evaluateShBlocks<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+}
+
+template <int Degree>
+__attribute__((target("avx512f"))) static size_t evaluateShAvx512(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+    return evaluateShBlocks<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+}
+#endif
+
+template <int Degree>
+static size_t evaluateShLevel(SimdLevel level, const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+#if HAS_X86_SIMD
+    if (level == SimdLevel::Avx512) {
+        return evaluateShAvx512<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    }
+    if (level == SimdLevel::Avx2) {
+        return evaluateShAvx2<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    }
+#endif
+    return evaluateShScalar<Degree>(gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+}
+
+static size_t evaluateSh(SimdLevel level, const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* colors, std::array<float, 3>* directions, float minCosine, const ShCodebook* codebook) {
+    if (codebook && codebook->numGaussians != gaussians.numGaussians) {
+        throw std::invalid_argument("SH codebook was built for a scene of different size");
+    }
+    switch (codebook ? codebook->sphericalHarmonicsDegree : gaussians.sphericalHarmonicsDegree) {
+    case 0: return evaluateShLevel<0>(level, gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    case 1: return evaluateShLevel<1>(level, gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    case 2: return evaluateShLevel<2>(level, gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    case 3: return evaluateShLevel<3>(level, gaussians, cameraPosition, begin, end, colors, directions, minCosine, codebook);
+    default: throw std::invalid_argument("Unsupported SH degree");
+    }
+}
+
+void evaluateShColors(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* out, SimdLevel level) {
+    evaluateSh(level, gaussians, cameraPosition, begin, end, out, nullptr, 0.0f, nullptr);
+}
+
+void evaluateShColors(const PackedGaussians& dcScene, const ShCodebook& codebook, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* out, SimdLevel level) {
+    evaluateSh(level, dcScene, cameraPosition, begin, end, out, nullptr, 0.0f, &codebook);
+}
+
+ShColorCache::ShColorCache(const ShColorOptions& options) : options(options) {}
+
+const std::vector<Color>& ShColorCache::update(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, const ShCodebook* codebook) {
+    return update(gaussians, cameraPosition, 0, gaussians.numGaussians, codebook);
+}
+
+const std::vector<Color>& ShColorCache::update(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, const ShCodebook* codebook) {
+    const size_t n = gaussians.numGaussians;
+    const void* codewords = codebook ? codebook->codewords.data() : nullptr;
+    const void* indices = codebook ? codebook->indices.data() : nullptr;
+    if (gaussians.positions.data() != positionsSource || gaussians.shCoeffs.data() != shCoeffsSource || cache.size() != n
+        || gaussians.sphericalHarmonicsDegree != degree || gaussians.shLayout != layout || codewords != codewordsSource || indices != indicesSource) {
+        cache.assign(n, { 0.0f, 0.0f, 0.0f });
+        directions.assign(n, { 0.0f, 0.0f, 0.0f });
+        positionsSource = gaussians.positions.data();
+        shCoeffsSource = gaussians.shCoeffs.data();
+        codewordsSource = codewords;
+        indicesSource = indices;
+        degree = gaussians.sphericalHarmonicsDegree;
+        layout = gaussians.shLayout;
+    }
+
+    // Unit directions have a dot product of at most 1 with a stored one and 0
+    // with the zero direction, so the threshold is capped below 90 degrees to
+    // keep invalidated splats from being skipped.
+    const float minCosine = std::max(std::cos(std::min(options.angleThreshold, 1.5f)), 0.01f);
+    begin = std::min(begin, n);
+    end = std::min(end, n);
+    std::atomic<size_t> nEvaluated = 0;
+    parallelFor(end - begin, options.nThreads, [&](int, size_t sliceBegin, size_t sliceEnd) {
+        nEvaluated += evaluateSh(options.simdLevel, gaussians, cameraPosition, begin + sliceBegin, begin + sliceEnd, cache.data() + begin + sliceBegin, directions.data() + begin + sliceBegin, minCosine, codebook);
+    });
+    evaluated = nEvaluated;
+    return cache;
+}
+
+void ShColorCache::invalidate() {
+    std::fill(directions.begin(), directions.end(), std::array<float, 3> { 0.0f, 0.0f, 0.0f });
+}
+
+void ShColorCache::invalidate(size_t begin, size_t end) {
+    end = std::min(end, directions.size());
+    for (size_t i = begin; i < end; ++i) {
+        directions[i] = { 0.0f, 0.0f, 0.0f };
+    }
+}
+
+const std::vector<Color>& ShColorCache::colors() const {
+    return cache;
+}
+
+size_t ShColorCache::lastEvaluated() const {
+    return evaluated;
+}
@@ -0,0 +1,65 @@
+#ifndef SH_H
+#define SH_H
+
+#include "ply.h"
+#include "simd.h"
+#include <vector>
+#include <array>
+#include <cstddef>
+
+using Color = std::array<float, 3>;
+
+class ShCodebook;
+
+// View-dependent colors of splats [begin, end) into out[0, end - begin): the
+// SH expansion in the direction from the camera to each splat, plus 0.5 and
+// clamped at zero, as in the reference 3DGS renderer. Works with both
+// ShLayouts.
+void evaluateShColors(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* out, SimdLevel level = detectSimdLevel());
+// Same for a scene whose bands above DC are held by `codebook`: the DC terms
+// are read from `dcScene` and the rest gathered from each splat's codeword.
+void evaluateShColors(const PackedGaussians& dcScene, const ShCodebook& codebook, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, Color* out, SimdLevel level = detectSimdLevel());
+
+struct ShColorOptions {
+    int nThreads = 0;
+    // A splat whose view direction turned by less than this many radians
+    // since its color was last evaluated keeps the cached color.
+    float angleThreshold = 0.0f;
+    SimdLevel simdLevel = detectSimdLevel();
+};
+
+// Per-splat colors kept across frames. Everything is re-evaluated when the
+// positions or shCoeffs columns were reallocated or resized, or the SH degree
+// or layout or the codebook changed; edits made in place must be reported
+// through invalidate(). With a codebook, `gaussians` supplies the DC terms as
+// in evaluateShColors.
+class ShColorCache {
+public:
+    explicit ShColorCache(const ShColorOptions& options = {});
+
+    const std::vector<Color>& update(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, const ShCodebook* codebook = nullptr);
+    // Only refreshes splats [begin, end); colors outside it are left as they are.
+    const std::vector<Color>& update(const PackedGaussians& gaussians, const std::array<float, 3>& cameraPosition, size_t begin, size_t end, const ShCodebook* codebook = nullptr);
+
+    void invalidate();
+    void invalidate(size_t begin, size_t end);
+
+    const std::vector<Color>& colors() const;
+    // Number of splats evaluated by the last update().
+    size_t lastEvaluated() const;
+
+private:
+    ShColorOptions options;
+    std::vector<Color> cache;
+    // Direction each cached color was evaluated for; zero forces a refresh.
+    std::vector<std::array<float, 3>> directions;
+    const void* positionsSource = nullptr;
+    const void* shCoeffsSource = nullptr;
+    const void* codewordsSource = nullptr;
+    const void* indicesSource = nullptr;
+    int degree = -1;
+    ShLayout layout = ShLayout::Interleaved;
+    size_t evaluated = 0;
+};
+
+#endif // SH_H
@@ -0,0 +1,517 @@
+#include "sh_codebook.h"
+#include "binary_io.h"
+#include "parallel.h"
+#include "trace.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <fstream>
+#include <numbers>
+
+// Codewords are scored in blocks of this many, stored one dimension after the
+// other, so every step of the distance loop is a fixed-length loop over lanes
+// that the compiler vectorizes for the target of the calling kernel below.
+static constexpr int codeLanes = 16;
+// Splats scored against a block together, so every codeword load feeds this many.
+static constexpr int splatGroup = 8;
+// Floats per codeword at degree 3.
+static constexpr int maxRestSize = 45;
+
+namespace {
+
+struct CodewordBlocks {
+    int dims = 0;
+    int nBlocks = 0;
+    // values[(block * dims + dim) * codeLanes + lane]
+    std::vector<float> values;
+    // Half the squared norm of every codeword, infinite for the padding lanes
+    // of the last block so they are never nearest.
+    std::vector<float> halfNorms;
+};
+
+}
+
+static CodewordBlocks blockCodewords(const std::vector<float>& codewords, int count, int dims) {
+    CodewordBlocks blocks;
+    blocks.dims = dims;
+    blocks.nBlocks = (count + codeLanes - 1) / codeLanes;
+    blocks.values.assign(static_cast<size_t>(blocks.nBlocks) * dims * codeLanes, 0.0f);
+    blocks.halfNorms.assign(static_cast<size_t>(blocks.nBlocks) * codeLanes, std::numeric_limits<float>::infinity());
+    for (int code = 0; code < count; ++code) {
+        const int block = code / codeLanes, lane = code % codeLanes;
+        const float* codeword = codewords.data() + static_cast<size_t>(code) * dims;
+        float squaredNorm = 0.0f;
+        for (int dim = 0; dim < dims; ++dim) {
+            blocks.values[(static_cast<size_t>(block) * dims + dim) * codeLanes + lane] = codeword[dim];
+            squaredNorm += codeword[dim] * codeword[dim];
+        }
+        blocks.halfNorms[code] = squaredNorm * 0.5f;
+    }
+    return blocks;
+}
+
+// Nearest codeword of each of the `count` (at most splatGroup) rows of
+// `points`. Codewords are ranked by |c|^2 / 2 - x.c, which orders them like
+// the squared distance and needs one multiply-add per dimension and codeword.
+__attribute__((always_inline)) inline void nearestCodewordsGroup(const CodewordBlocks& blocks, const float* points, int count, uint32_t* nearest) {
+    const int dims = blocks.dims;
+    const float* rows[splatGroup];
+    for (int p = 0; p < splatGroup; ++p) {
+        rows[p] = points + std::min(p, count - 1) * dims;
+    }
+
+    alignas(64) float score[splatGroup][codeLanes];
+    alignas(64) float best[splatGroup][codeLanes];
+    alignas(64) int bestBlock[splatGroup][codeLanes];
+    for (int p = 0; p < splatGroup; ++p) {
+        for (int lane = 0; lane < codeLanes; ++lane) {
+            best[p][lane] = std::numeric_limits<float>::infinity();
+            bestBlock[p][lane] = 0;
+        }
+    }
+
+    for (int block = 0; block < blocks.nBlocks; ++block) {
+        const float* values = blocks.values.data() + static_cast<size_t>(block) * dims * codeLanes;
+        const float* halfNorms = blocks.halfNorms.data() + static_cast<size_t>(block) * codeLanes;
+        for (int p = 0; p < splatGroup; ++p) {
+            for (int lane = 0; lane < codeLanes; ++lane) {
+                score[p][lane] = halfNorms[lane];
+            }
+        }
+        for (int dim = 0; dim < dims; ++dim) {
+            const float* column = values + dim * codeLanes;
+            // Unrolled so the scores of the whole group stay in registers.
+            // The lane loop is kept whole so it is what gets vectorized:
+            // at -O3 it would otherwise be unrolled first and the dimension
+            // loop vectorized instead, with strided loads, four times slower.
+#pragma GCC unroll 8
+            for (int p = 0; p < splatGroup; ++p) {
+                const float x = rows[p][dim];
+#pragma GCC unroll 1
+                for (int lane = 0; lane < codeLanes; ++lane) {
+                    score[p][lane] -= x * column[lane];
+                }
+            }
+        }
+        for (int p = 0; p < splatGroup; ++p) {
+            for (int lane = 0; lane < codeLanes; ++lane) {
+                const bool better = score[p][lane] < best[p][lane];
+                best[p][lane] = better ? score[p][lane] : best[p][lane];
+                bestBlock[p][lane] = better ? block : bestBlock[p][lane];
+            }
+        }
+    }
+
+    for (int p = 0; p < count; ++p) {
+        int bestLane = 0;
+        for (int lane = 1; lane < codeLanes; ++lane) {
+            if (best[p][lane] < best[p][bestLane]) {
+                bestLane = lane;
+            }
+        }
+        nearest[p] = static_cast<uint32_t>(bestBlock[p][bestLane] * codeLanes + bestLane);
+    }
+}
+
+static void nearestCodewordsScalar(const CodewordBlocks& blocks, const float* points, int count, uint32_t* nearest) {
+    nearestCodewordsGroup(blocks, points, count, nearest);
+}
+
+#if HAS_X86_SIMD
+__attribute__((target("avx2,fma"))) static void nearestCodewordsAvx2(const CodewordBlocks& blocks, const float* points, int count, uint32_t* nearest) {
+    nearestCodewordsGroup(blocks, points, count, nearest);
+}
+
+__attribute__((target("avx512f"))) static void nearestCodewordsAvx512(const CodewordBlocks& blocks, const float* points, int count, uint32_t* nearest) {
+    nearestCodewordsGroup(blocks, points, count, nearest);
+}
+#endif
+
+static void nearestCodewords(SimdLevel level, const CodewordBlocks& blocks, const float* points, int count, uint32_t* nearest) {
+#if HAS_X86_SIMD
+    if (level == SimdLevel::Avx512) {
+        return nearestCodewordsAvx512(blocks, points, count, nearest);
+    }
+    if (level == SimdLevel::Avx2) {
+        return nearestCodewordsAvx2(blocks, points, count, nearest);
+    }
+#endif
+    nearestCodewordsScalar(blocks, points, count, nearest);
+}
+
+// Coefficients 1 onward of splat i, channels interleaved.
+static void readRest(const PackedGaussians& gaussians, size_t i, int nCoeffs, float* out) {
+    if (gaussians.shLayout == ShLayout::Interleaved) {
+        std::memcpy(out, gaussians.shCoeffs.data() + i * nCoeffs * 3 + 3, (nCoeffs - 1) * 3 * sizeof(float));
+        return;
+    }
+    const size_t n = gaussians.numGaussians;
+    for (int k = 3; k < nCoeffs * 3; ++k) {
+        out[k - 3] = gaussians.shCoeffs[k * n + i];
+    }
+}
+
+// Nearest codeword of splat splats[k], or of splat k when `splats` is empty,
+// for every k in [0, count).
+static void assignSplats(const PackedGaussians& gaussians, const std::vector<uint32_t>& splats, size_t count, const CodewordBlocks& blocks, const ShCodebookOptions& options, uint32_t* nearest) {
+    const int nCoeffs = gaussians.nShCoeffs();
+    parallelFor(count, options.nThreads, [&](int, size_t begin, size_t end) {
+        float points[splatGroup * maxRestSize];
+        for (size_t first = begin; first < end; first += splatGroup) {
+            const int groupSize = static_cast<int>(std::min<size_t>(splatGroup, end - first));
+            for (int p = 0; p < groupSize; ++p) {
+                readRest(gaussians, splats.empty() ? first + p : splats[first + p], nCoeffs, points + p * blocks.dims);
+            }
+            nearestCodewords(options.simdLevel, blocks, points, groupSize, nearest + first);
+        }
+    });
+}
+
+// `count` splats drawn at random with replacement, sorted so they are read in
+// memory order.
+static std::vector<uint32_t> drawSplats(size_t n, size_t count, std::mt19937& rng) {
+    std::vector<uint32_t> splats(count);
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(n - 1));
+    for (auto& splat : splats) {
+        splat = pick(rng);
+    }
+    std::sort(splats.begin(), splats.end());
+    return splats;
+}
+
+// k-means++ seeding over `sampleSize` splats, all of them when that is every
+// splat: each codeword after the first is a sampled splat drawn with
+// probability proportional to its squared distance to the nearest codeword so
+// far, so small clusters get codewords too. The sample is held one dimension
+// after the other, padded to whole tiles, so the distance loop runs over
+// splats. Tiles are updated in parallel and their sums kept apart, so the
+// draw does not depend on the thread count and can skip whole tiles.
+static void seedCodewords(const PackedGaussians& gaussians, size_t sampleSize, int nCodes, int nThreads, std::mt19937& rng, std::vector<float>& codewords) {
+    constexpr size_t tile = 64;
+    const size_t n = gaussians.numGaussians;
+    const int nCoeffs = gaussians.nShCoeffs();
+    const int dims = (nCoeffs - 1) * 3;
+    std::vector<uint32_t> sample;
+    if (sampleSize < n) {
+        sample = drawSplats(n, sampleSize, rng);
+    }
+    const size_t nTiles = (sampleSize + tile - 1) / tile;
+    const size_t padded = nTiles * tile;
+    std::vector<float> columns(padded * dims, 0.0f);
+    parallelFor(sampleSize, nThreads, [&](int, size_t begin, size_t end) {
+        float rest[maxRestSize];
+        for (size_t j = begin; j < end; ++j) {
+            readRest(gaussians, sample.empty() ? j : sample[j], nCoeffs, rest);
+            for (int dim = 0; dim < dims; ++dim) {
+                columns[dim * padded + j] = rest[dim];
+            }
+        }
+    });
+
+    std::vector<float> nearestDistances(sampleSize, std::numeric_limits<float>::infinity());
+    std::vector<double> tileTotals(nTiles);
+    size_t chosen = std::uniform_int_distribution<size_t>(0, sampleSize - 1)(rng);
+    for (int code = 0; code < nCodes; ++code) {
+        float* codeword = codewords.data() + static_cast<size_t>(code) * dims;
+        for (int dim = 0; dim < dims; ++dim) {
+            codeword[dim] = columns[dim * padded + chosen];
+        }
+        if (code + 1 == nCodes) {
+            break;
+        }
+
+        const float* columnData = columns.data();
+        parallelFor(nTiles, nThreads, [&, codeword, columnData](int, size_t tileBegin, size_t tileEnd) {
+            for (size_t t = tileBegin; t < tileEnd; ++t) {
+                const size_t first = t * tile;
+                alignas(64) float distances[tile] = {};
+                for (int dim = 0; dim < dims; ++dim) {
+                    const float value = codeword[dim];
+                    const float* column = columnData + dim * padded + first;
+                    for (size_t j = 0; j < tile; ++j) {
+                        const float difference = column[j] - value;
+                        distances[j] += difference * difference;
+                    }
+                }
+                const size_t count = std::min(tile, sampleSize - first);
+                double tileTotal = 0.0;
+                for (size_t j = 0; j < count; ++j) {
+                    nearestDistances[first + j] = std::min(nearestDistances[first + j], distances[j]);
+                    tileTotal += nearestDistances[first + j];
+                }
+                tileTotals[t] = tileTotal;
+            }
+        });
+        double total = 0.0;
+        for (double tileTotal : tileTotals) {
+            total += tileTotal;
+        }
+        if (total <= 0.0) {
+            // Every sampled splat sits on a codeword already.
+            chosen = std::uniform_int_distribution<size_t>(0, sampleSize - 1)(rng);
+            continue;
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+        chosen = sampleSize - 1;
+        for (size_t t = 0; t < nTiles; ++t) {
+            if (target >= tileTotals[t]) {
+                target -= tileTotals[t];
+                continue;
+            }
+            const size_t first = t * tile;
+            const size_t last = std::min(first + tile, sampleSize);
+            chosen = last - 1;
+            for (size_t j = first; j < last; ++j) {
+                target -= nearestDistances[j];
+                if (target < 0.0) {
+                    chosen = j;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+ShCodebook::ShCodebook() : numGaussians(0), sphericalHarmonicsDegree(0) {}
+
+ShCodebook::ShCodebook(const PackedGaussians& gaussians, const ShCodebookOptions& options)
+    : numGaussians(gaussians.numGaussians), sphericalHarmonicsDegree(gaussians.sphericalHarmonicsDegree) {
+    ScopedTimer timer("shCodebook");
+    if (sphericalHarmonicsDegree < 1) {
+        throw std::invalid_argument("SH codebooks need a scene with bands above DC");
+    }
+    if (options.codebookSize < 1 || options.codebookSize > 65536 || options.iterations < 0 || options.batchSize < 1) {
+        throw std::invalid_argument("Invalid SH codebook options");
+    }
+    const size_t n = numGaussians;
+    const int nCoeffs = gaussians.nShCoeffs();
+    const int dims = restSize();
+    const int nCodes = static_cast<int>(std::min<size_t>(options.codebookSize, n));
+    timer.addBytes(n * dims * sizeof(float));
+
+    std::mt19937 rng(options.seed);
+    codewords.resize(static_cast<size_t>(nCodes) * dims);
+    if (nCodes > 0) {
+        seedCodewords(gaussians, std::min<size_t>(n, options.batchSize), nCodes, options.nThreads, rng, codewords);
+    }
+
+    const bool miniBatch = n > static_cast<size_t>(options.batchSize);
+    const size_t batchSize = miniBatch ? options.batchSize : n;
+    std::vector<uint32_t> batch;
+    std::vector<uint32_t> nearest(batchSize), previous;
+    std::vector<uint32_t> clusterOffsets(nCodes + 1), members(batchSize);
+    // Splats each codeword has been moved toward; codewords move to the mean of
+    // everything they were assigned so far, which for full k-means is only the
+    // current iteration.
+    std::vector<uint64_t> weights(nCodes, 0);
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration) {
+        if (miniBatch) {
+            batch = drawSplats(n, batchSize, rng);
+        }
+        else {
+            std::fill(weights.begin(), weights.end(), 0);
+        }
+        const CodewordBlocks blocks = blockCodewords(codewords, nCodes, dims);
+        assignSplats(gaussians, batch, batchSize, blocks, options, nearest.data());
+        if (!miniBatch) {
+            if (nearest == previous) {
+                break;
+            }
+            previous = nearest;
+        }
+
+        // Group the batch by codeword, then move every codeword independently.
+        std::fill(clusterOffsets.begin(), clusterOffsets.end(), 0);
+        for (uint32_t code : nearest) {
+            clusterOffsets[code + 1]++;
+        }
+        std::partial_sum(clusterOffsets.begin(), clusterOffsets.end(), clusterOffsets.begin());
+        {
+            std::vector<uint32_t> cursor(clusterOffsets.begin(), clusterOffsets.end() - 1);
+            for (size_t k = 0; k < batchSize; ++k) {
+                members[cursor[nearest[k]]++] = static_cast<uint32_t>(k);
+            }
+        }
+        parallelFor(nCodes, options.nThreads, [&](int, size_t begin, size_t end) {
+            double sums[maxRestSize];
+            float rest[maxRestSize];
+            for (size_t code = begin; code < end; ++code) {
+                const uint32_t first = clusterOffsets[code], last = clusterOffsets[code + 1];
+                if (first == last) {
+                    continue;
+                }
+                std::fill(sums, sums + dims, 0.0);
+                for (uint32_t m = first; m < last; ++m) {
+                    readRest(gaussians, miniBatch ? batch[members[m]] : members[m], nCoeffs, rest);
+                    for (int dim = 0; dim < dims; ++dim) {
+                        sums[dim] += rest[dim];
+                    }
+                }
+                const uint64_t count = last - first;
+                weights[code] += count;
+                float* codeword = codewords.data() + code * dims;
+                for (int dim = 0; dim < dims; ++dim) {
+                    codeword[dim] += static_cast<float>((sums[dim] - count * static_cast<double>(codeword[dim])) / weights[code]);
+                }
+            }
+        });
+    }
+
+    const CodewordBlocks blocks = blockCodewords(codewords, nCodes, dims);
+    std::vector<uint32_t> assigned(n);
+    assignSplats(gaussians, {}, n, blocks, options, assigned.data());
+    indices.assign(assigned.begin(), assigned.end());
+}
+
+int ShCodebook::codeCount() const {
+    const int dims = restSize();
+    return dims ? static_cast<int>(codewords.size() / dims) : 0;
+}
+
+int ShCodebook::restSize() const {
+    return ((sphericalHarmonicsDegree + 1) * (sphericalHarmonicsDegree + 1) - 1) * 3;
+}
+
+size_t ShCodebook::byteSize() const {
+    return codewords.size() * sizeof(float) + indices.size() * sizeof(uint16_t);
+}
+
+void ShCodebook::gather(const PackedGaussians& dcScene, size_t begin, size_t end, float* out) const {
+    if (dcScene.numGaussians != numGaussians || end > indices.size() || begin > end) {
+        throw std::invalid_argument("Scene or splat range does not match the SH codebook");
+    }
+    const int dims = restSize();
+    const size_t stride = dims + 3;
+    const size_t dcStride = static_cast<size_t>(dcScene.nShCoeffs()) * 3;
+    const float* dc = dcScene.shCoeffs.data();
+    const size_t n = numGaussians;
+    for (size_t i = begin; i < end; ++i) {
+        float* splat = out + (i - begin) * stride;
+        for (int channel = 0; channel < 3; ++channel) {
+            splat[channel] = dcScene.shLayout == ShLayout::Planar ? dc[channel * n + i] : dc[i * dcStride + channel];
+        }
+        std::memcpy(splat + 3, codewords.data() + static_cast<size_t>(indices[i]) * dims, dims * sizeof(float));
+    }
+}
+
+PackedGaussians ShCodebook::decode(const PackedGaussians& dcScene, ShLayout shLayout) const {
+    PackedGaussians gaussians;
+    gaussians.numGaussians = dcScene.numGaussians;
+    gaussians.sphericalHarmonicsDegree = sphericalHarmonicsDegree;
+    gaussians.shLayout = ShLayout::Interleaved;
+    gaussians.positions = dcScene.positions;
+    gaussians.logScales = dcScene.logScales;
+    gaussians.rotQuats = dcScene.rotQuats;
+    gaussians.opacityLogits = dcScene.opacityLogits;
+    gaussians.sourceIndices = dcScene.sourceIndices;
+    gaussians.shCoeffs.resize(static_cast<size_t>(numGaussians) * (restSize() + 3));
+    gather(dcScene, 0, numGaussians, gaussians.shCoeffs.data());
+    gaussians.setShLayout(shLayout);
+    return gaussians;
+}
+
+static const char codebookMagic[4] = { 'G', 'S', 'V', 'Q' };
+static const uint32_t codebookVersion = 1;
+static const char codebookFileKind[] = "SH codebook file";
+
+void ShCodebook::save(const std::string& filePath) const {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+
+    const int32_t header[3] = { numGaussians, sphericalHarmonicsDegree, codeCount() };
+    writeValues(file, codebookMagic, 4);
+    writeValues(file, &codebookVersion, 1);
+    writeValues(file, header, 3);
+    writeValues(file, codewords.data(), codewords.size());
+    writeValues(file, indices.data(), indices.size());
+
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
+
+ShCodebook ShCodebook::load(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to load file");
+    }
+
+    char magic[4];
+    uint32_t version;
+    int32_t header[3];
+    readValues(file, magic, 4, codebookFileKind);
+    readValues(file, &version, 1, codebookFileKind);
+    if (std::memcmp(magic, codebookMagic, 4) != 0 || version != codebookVersion) {
+        throw std::runtime_error("Not an SH codebook file, or unsupported version");
+    }
+    readValues(file, header, 3, codebookFileKind);
+
+    ShCodebook codebook;
+    codebook.numGaussians = header[0];
+    codebook.sphericalHarmonicsDegree = header[1];
+    const int nCodes = header[2];
+    if (codebook.numGaussians < 0 || codebook.sphericalHarmonicsDegree < 1 || codebook.sphericalHarmonicsDegree > 3 || nCodes < 0 || nCodes > 65536
+        || (nCodes == 0 && codebook.numGaussians > 0)) {
+        throw std::runtime_error("Invalid SH codebook file header");
+    }
+    codebook.codewords.resize(static_cast<size_t>(nCodes) * codebook.restSize());
+    codebook.indices.resize(codebook.numGaussians);
+    readValues(file, codebook.codewords.data(), codebook.codewords.size(), codebookFileKind);
+    readValues(file, codebook.indices.data(), codebook.indices.size(), codebookFileKind);
+    for (uint16_t index : codebook.indices) {
+        if (index >= nCodes) {
+            throw std::runtime_error("Invalid SH codebook index");
+        }
+    }
+    return codebook;
+}
+
+ShCodebookReport measureShCodebookError(const PackedGaussians& reference, const ShCodebook& codebook, int nThreads) {
+    if (reference.numGaussians != codebook.numGaussians || reference.sphericalHarmonicsDegree != codebook.sphericalHarmonicsDegree) {
+        throw std::invalid_argument("SH codebook was built for a scene of different size or SH degree");
+    }
+    const size_t n = reference.numGaussians;
+    const int nCoeffs = reference.nShCoeffs();
+    const int dims = codebook.restSize();
+
+    struct Partial {
+        double sumSquares = 0.0;
+        double max = 0.0;
+    };
+    std::vector<Partial> partials(parallelSlices(n, nThreads));
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        float rest[maxRestSize];
+        Partial partial;
+        for (size_t i = begin; i < end; ++i) {
+            readRest(reference, i, nCoeffs, rest);
+            const float* codeword = codebook.codewords.data() + static_cast<size_t>(codebook.indices[i]) * dims;
+            for (int dim = 0; dim < dims; ++dim) {
+                const double error = rest[dim] - codeword[dim];
+                partial.sumSquares += error * error;
+                partial.max = std::max(partial.max, std::abs(error));
+            }
+        }
+        partials[slice] = partial;
+    });
+
+    ShCodebookReport report = {};
+    for (const auto& partial : partials) {
+        report.coefficient.rms += partial.sumSquares;
+        report.coefficient.max = std::max(report.coefficient.max, partial.max);
+    }
+    const double sumSquares = report.coefficient.rms;
+    report.coefficient.rms = n ? std::sqrt(sumSquares / (n * dims)) : 0.0;
+    // Per channel: the three channels share the sum, each over its own bands.
+    const double colorMse = n ? sumSquares / (n * 3) / (4.0 * std::numbers::pi) : 0.0;
+    report.colorPsnr = colorMse > 0.0 ? -10.0 * std::log10(colorMse) : std::numeric_limits<double>::infinity();
+    report.sourceBytes = n * dims * sizeof(float);
+    report.compressedBytes = codebook.byteSize();
+    return report;
+}
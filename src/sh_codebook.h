@@ -0,0 +1,76 @@
+#ifndef SH_CODEBOOK_H
+#define SH_CODEBOOK_H
+
+#include "ply.h"
+#include "simd.h"
+#include "compact.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+struct ShCodebookOptions {
+    // Codewords to cluster into, at most 65536 so indices fit 16 bits. This is
+    // the quality / size trade-off: the codebook costs codebookSize times the
+    // higher-band size of one splat, and error falls as it grows.
+    int codebookSize = 4096;
+    int iterations = 16;
+    // Scenes with more splats than this are clustered by mini-batch k-means,
+    // each iteration moving the codewords toward this many randomly drawn
+    // splats; smaller scenes by full k-means.
+    int batchSize = 1 << 16;
+    int nThreads = 0;
+    uint32_t seed = 1;
+    SimdLevel simdLevel = detectSimdLevel();
+};
+
+// Vector-quantized SH bands above DC. The coefficients 1 onward of a splat,
+// all three channels interleaved as in PackedGaussians, are replaced by the
+// index of the nearest of a shared set of codewords found by k-means. The DC
+// terms stay with the scene, which can then be cut to degree 0 with
+// PackedGaussians::truncateShDegree so that only the codebook and the indices
+// hold the higher bands, about 2 bytes per splat instead of 180 at degree 3.
+class ShCodebook {
+public:
+    int numGaussians;
+    int sphericalHarmonicsDegree;
+    // codeCount() codewords of restSize() floats each.
+    std::vector<float> codewords;
+    // Codeword of every splat.
+    std::vector<uint16_t> indices;
+
+    ShCodebook();
+    ShCodebook(const PackedGaussians& gaussians, const ShCodebookOptions& options = {});
+
+    int codeCount() const;
+    // Floats per codeword: (nShCoeffs - 1) x 3.
+    int restSize() const;
+    size_t byteSize() const;
+
+    // Writes the SH coefficients of splats [begin, end) of `dcScene`, which
+    // holds the DC terms of the scene the codebook was built for, to
+    // out[0, (end - begin) x nShCoeffs x 3], interleaved.
+    void gather(const PackedGaussians& dcScene, size_t begin, size_t end, float* out) const;
+    // The scene with its higher bands restored from the codebook.
+    PackedGaussians decode(const PackedGaussians& dcScene, ShLayout shLayout = ShLayout::Interleaved) const;
+
+    void save(const std::string& filePath) const;
+    static ShCodebook load(const std::string& filePath);
+};
+
+struct ShCodebookReport {
+    // Error of the individual coefficients above DC.
+    AttributeError coefficient;
+    // Peak signal-to-noise ratio in dB, with a peak of 1, of the view-dependent
+    // color averaged over all view directions. The SH basis is orthonormal, so
+    // that mean squared error is the squared coefficient error summed over the
+    // bands and divided by 4 pi; no view has to be rendered.
+    double colorPsnr;
+    // Higher bands held as floats, and as codebook plus indices.
+    size_t sourceBytes;
+    size_t compressedBytes;
+};
+
+ShCodebookReport measureShCodebookError(const PackedGaussians& reference, const ShCodebook& codebook, int nThreads = 0);
+
+#endif // SH_CODEBOOK_H
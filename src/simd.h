@@ -0,0 +1,24 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// x86-64 kernels are compiled with per-function target attributes, so the rest
+// of the build needs no -mavx2 / -mavx512f and the binary still runs anywhere.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define HAS_X86_SIMD 1
+#else
+#define HAS_X86_SIMD 0
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// Widest level that is both compiled in and supported by the running CPU.
+// Each level implies the ones below it, and Avx2 also implies FMA.
+SimdLevel detectSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+#endif // SIMD_H
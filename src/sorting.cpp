@@ -0,0 +1,216 @@
+#include "sorting.h"
+#include "parallel.h"
+#include "trace.h"
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+
+static inline float viewDepth(const ViewMatrix& view, const std::array<float, 3>& position) {
+    return view[0][2] * position[0] + view[1][2] * position[1] + view[2][2] * position[2] + view[3][2];
+}
+
+uint64_t expandBits21(uint64_t value) {
+    value &= 0x1fffffull;
+    value = (value | (value << 32)) & 0x1f00000000ffffull;
+    value = (value | (value << 16)) & 0x1f0000ff0000ffull;
+    value = (value | (value << 8)) & 0x100f00f00f00f00full;
+    value = (value | (value << 4)) & 0x10c30c30c30c30c3ull;
+    value = (value | (value << 2)) & 0x1249249249249249ull;
+    return value;
+}
+
+uint64_t mortonCode63(const std::array<float, 3>& position, const std::array<float, 3>& origin, const std::array<float, 3>& cellScale) {
+    uint64_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float cell = (position[axis] - origin[axis]) * cellScale[axis];
+        code |= expandBits21(static_cast<uint64_t>(std::clamp(cell, 0.0f, 2097151.0f))) << (2 - axis);
+    }
+    return code;
+}
+
+std::vector<uint32_t> mortonOrder(std::span<const std::array<float, 3>> positions, int nThreads) {
+    ScopedTimer timer("mortonOrder");
+    const size_t n = positions.size();
+    const int nSlices = parallelSlices(n, nThreads);
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<std::array<float, 6>> sliceBounds(nSlices, { inf, inf, inf, -inf, -inf, -inf });
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        auto& bounds = sliceBounds[slice];
+        for (size_t i = begin; i < end; ++i) {
+            for (int axis = 0; axis < 3; ++axis) {
+                bounds[axis] = std::min(bounds[axis], positions[i][axis]);
+                bounds[axis + 3] = std::max(bounds[axis + 3], positions[i][axis]);
+            }
+        }
+    });
+    std::array<float, 3> origin = { inf, inf, inf };
+    std::array<float, 3> upper = { -inf, -inf, -inf };
+    for (const auto& bounds : sliceBounds) {
+        for (int axis = 0; axis < 3; ++axis) {
+            origin[axis] = std::min(origin[axis], bounds[axis]);
+            upper[axis] = std::max(upper[axis], bounds[axis + 3]);
+        }
+    }
+    std::array<float, 3> cellScale;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = upper[axis] - origin[axis];
+        cellScale[axis] = extent > 0.0f ? 2097151.0f / extent : 0.0f;
+    }
+
+    std::vector<uint64_t> codes(n);
+    std::vector<uint32_t> order(n);
+    parallelFor(n, nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            codes[i] = mortonCode63(positions[i], origin, cellScale);
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+    std::vector<uint64_t> scratchCodes;
+    std::vector<uint32_t> scratchOrder;
+    radixSortPairs<uint64_t>(codes, order, scratchCodes, scratchOrder, 63, nThreads);
+    return order;
+}
+
+DepthSorter::DepthSorter(const DepthSortOptions& options) : options(options), lastStats({ false, 0 }) {
+    if (options.keyBits != 16 && options.keyBits != 24 && options.keyBits != 32) {
+        throw std::invalid_argument("Depth keys must have 16, 24 or 32 bits");
+    }
+}
+
+void DepthSorter::computeDepths(std::span<const std::array<float, 3>> positions, const ViewMatrix& view) {
+    splatDepths.resize(positions.size());
+    parallelFor(positions.size(), options.nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            splatDepths[i] = viewDepth(view, positions[i]);
+        }
+    });
+}
+
+const std::vector<uint32_t>& DepthSorter::sort(std::span<const std::array<float, 3>> positions, const ViewMatrix& view) {
+    computeDepths(positions, view);
+    sortByDepth();
+    return order;
+}
+
+void DepthSorter::sortByDepth() {
+    const size_t n = splatDepths.size();
+    const int nSlices = parallelSlices(n, options.nThreads);
+    order.resize(n);
+    keys.resize(n);
+
+    std::vector<std::pair<float, float>> sliceRanges(nSlices, { std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() });
+    parallelFor(n, options.nThreads, [&](int slice, size_t begin, size_t end) {
+        auto& [minDepth, maxDepth] = sliceRanges[slice];
+        for (size_t i = begin; i < end; ++i) {
+            minDepth = std::min(minDepth, splatDepths[i]);
+            maxDepth = std::max(maxDepth, splatDepths[i]);
+        }
+    });
+
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = std::numeric_limits<float>::lowest();
+    for (const auto& range : sliceRanges) {
+        minDepth = std::min(minDepth, range.first);
+        maxDepth = std::max(maxDepth, range.second);
+    }
+
+    const double maxKey = options.keyBits == 32 ? 4294967295.0 : static_cast<double>((1u << options.keyBits) - 1);
+    const double scale = maxDepth > minDepth ? maxKey / (static_cast<double>(maxDepth) - minDepth) : 0.0;
+    parallelFor(n, options.nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            keys[i] = static_cast<uint32_t>(std::min(maxKey, (static_cast<double>(splatDepths[i]) - minDepth) * scale));
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+
+    radixSortPairs(keys, order, scratchKeys, scratchOrder, options.keyBits, options.nThreads);
+    lastStats = { false, 0 };
+}
+
+const std::vector<uint32_t>& DepthSorter::sort(const PackedGaussians& gaussians, const ViewMatrix& view) {
+    return sort(gaussians.positions, view);
+}
+
+// Insertion sort of depths/order over [begin, end). Returns the number of
+// element moves, or stops early once it exceeds `budget`.
+static size_t insertionSort(std::vector<float>& depths, std::vector<uint32_t>& order, size_t begin, size_t end, size_t budget) {
+    size_t moves = 0;
+    for (size_t i = begin + 1; i < end && moves <= budget; ++i) {
+        const float depth = depths[i];
+        if (depths[i - 1] <= depth) {
+            continue;
+        }
+        const uint32_t index = order[i];
+        size_t j = i;
+        while (j > begin && depths[j - 1] > depth) {
+            depths[j] = depths[j - 1];
+            order[j] = order[j - 1];
+            --j;
+        }
+        depths[j] = depth;
+        order[j] = index;
+        moves += i - j;
+    }
+    return moves;
+}
+
+bool DepthSorter::repairOrder(size_t budget, int nThreads) {
+    const size_t n = order.size();
+    const int nSlices = parallelSlices(n, nThreads);
+    std::vector<size_t> sliceMoves(nSlices, 0);
+
+    // Slices are repaired independently first; the serial pass afterwards only
+    // has to move splats across slice boundaries.
+    parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+        sliceMoves[slice] = insertionSort(depths, order, begin, end, budget / nSlices);
+    });
+
+    size_t moves = 0;
+    for (size_t sliceMove : sliceMoves) {
+        moves += sliceMove;
+    }
+    if (moves > budget) {
+        return false;
+    }
+    moves += insertionSort(depths, order, 0, n, budget - moves);
+    if (moves > budget) {
+        return false;
+    }
+
+    lastStats = { true, moves };
+    return true;
+}
+
+const std::vector<uint32_t>& DepthSorter::sortIncremental(std::span<const std::array<float, 3>> positions, const ViewMatrix& view) {
+    const size_t n = positions.size();
+    computeDepths(positions, view);
+    if (order.size() != n) {
+        sortByDepth();
+        return order;
+    }
+
+    depths.resize(n);
+    parallelFor(n, options.nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            depths[i] = splatDepths[order[i]];
+        }
+    });
+
+    const size_t budget = static_cast<size_t>(options.maxRepairMovesPerSplat * static_cast<float>(n));
+    if (!repairOrder(budget, options.nThreads)) {
+        sortByDepth();
+    }
+    return order;
+}
+
+const std::vector<uint32_t>& DepthSorter::sortIncremental(const PackedGaussians& gaussians, const ViewMatrix& view) {
+    return sortIncremental(gaussians.positions, view);
+}
+
+const std::vector<uint32_t>& DepthSorter::indices() const {
+    return order;
+}
+
+const DepthSortStats& DepthSorter::stats() const {
+    return lastStats;
+}
@@ -0,0 +1,129 @@
+#ifndef SORTING_H
+#define SORTING_H
+
+#include "ply.h"
+#include "parallel.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <cstdint>
+
+// Stable parallel LSD radix sort of (key, value) pairs on the low `keyBits`
+// bits of the keys, one pass per byte. Passes in which every key has the same
+// digit are skipped. The scratch vectors are resized as needed.
+template <typename Key>
+void radixSortPairs(std::vector<Key>& keys, std::vector<uint32_t>& values, std::vector<Key>& scratchKeys, std::vector<uint32_t>& scratchValues, int keyBits, int nThreads) {
+    const size_t n = keys.size();
+    const int nSlices = parallelSlices(n, nThreads);
+    std::vector<std::array<size_t, 256>> histograms(nSlices);
+    scratchKeys.resize(n);
+    scratchValues.resize(n);
+
+    for (int shift = 0; shift < keyBits; shift += 8) {
+        parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+            auto& histogram = histograms[slice];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; ++i) {
+                histogram[(keys[i] >> shift) & 0xff]++;
+            }
+        });
+
+        bool trivial = false;
+        for (int digit = 0; digit < 256 && !trivial; ++digit) {
+            size_t total = 0;
+            for (const auto& histogram : histograms) {
+                total += histogram[digit];
+            }
+            trivial = total == n;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        // Exclusive prefix sum in (digit, slice) order gives every slice its own
+        // output range per digit, which keeps the scatter stable.
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            for (auto& histogram : histograms) {
+                const size_t count = histogram[digit];
+                histogram[digit] = offset;
+                offset += count;
+            }
+        }
+
+        parallelFor(n, nThreads, [&](int slice, size_t begin, size_t end) {
+            auto& histogram = histograms[slice];
+            for (size_t i = begin; i < end; ++i) {
+                const size_t destination = histogram[(keys[i] >> shift) & 0xff]++;
+                scratchKeys[destination] = keys[i];
+                scratchValues[destination] = values[i];
+            }
+        });
+        keys.swap(scratchKeys);
+        values.swap(scratchValues);
+    }
+}
+
+// Spreads the low 21 bits of `value` out to every third bit.
+uint64_t expandBits21(uint64_t value);
+
+// 63-bit Morton code of the cell (position - origin) * cellScale, clamped to
+// 21 bits per axis. x takes the highest bit of every triple.
+uint64_t mortonCode63(const std::array<float, 3>& position, const std::array<float, 3>& origin, const std::array<float, 3>& cellScale);
+
+// Indices of `positions` sorted by their 63-bit Morton code within their
+// bounding box. Equal codes keep index order.
+std::vector<uint32_t> mortonOrder(std::span<const std::array<float, 3>> positions, int nThreads);
+
+// Column-major 4x4 matrix, the value layout packed by mat4x4.
+using ViewMatrix = std::array<std::array<float, 4>, 4>;
+
+struct DepthSortOptions {
+    int nThreads = 0;
+    // Depth is quantized to this many bits (16, 24 or 32), one radix pass per byte.
+    int keyBits = 24;
+    // sortIncremental repairs the previous order with insertion sort while the
+    // total number of element moves stays below this many per splat, and falls
+    // back to a full radix sort otherwise.
+    float maxRepairMovesPerSplat = 4.0f;
+};
+
+struct DepthSortStats {
+    bool repaired;
+    size_t moves;
+};
+
+// Back-to-front ordering of splats for a camera. Depth is view-space z with
+// the camera looking down -z, so the farthest splat comes first.
+class DepthSorter {
+public:
+    explicit DepthSorter(const DepthSortOptions& options = {});
+
+    const std::vector<uint32_t>& sort(std::span<const std::array<float, 3>> positions, const ViewMatrix& view);
+    const std::vector<uint32_t>& sort(const PackedGaussians& gaussians, const ViewMatrix& view);
+
+    // Starts from the previous order, which is usually almost sorted when the
+    // camera moved only a little since the last call.
+    const std::vector<uint32_t>& sortIncremental(std::span<const std::array<float, 3>> positions, const ViewMatrix& view);
+    const std::vector<uint32_t>& sortIncremental(const PackedGaussians& gaussians, const ViewMatrix& view);
+
+    const std::vector<uint32_t>& indices() const;
+    const DepthSortStats& stats() const;
+
+private:
+    DepthSortOptions options;
+    DepthSortStats lastStats;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> scratchOrder;
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> scratchKeys;
+    // View-space depth per splat, and per position of `order` while repairing.
+    std::vector<float> splatDepths;
+    std::vector<float> depths;
+
+    void computeDepths(std::span<const std::array<float, 3>> positions, const ViewMatrix& view);
+    void sortByDepth();
+    bool repairOrder(size_t budget, int nThreads);
+};
+
+#endif // SORTING_H
@@ -0,0 +1,211 @@
+#include "streaming.h"
+#include "parallel.h"
+#include "sorting.h"
+#include <algorithm>
+#include <cmath>
+#include <bit>
+
+StreamingLoader::StreamingLoader(std::span<const uint8_t> arrayBuffer, const StreamingOptions& options) : options(options) {
+    open(arrayBuffer);
+}
+
+StreamingLoader::StreamingLoader(const std::string& filePath, const StreamingOptions& options) : options(options) {
+    try {
+        mapped.emplace(filePath);
+    }
+    catch (const std::runtime_error&) {
+        buffer = loadFileAsArrayBuffer(filePath);
+        open(buffer);
+        return;
+    }
+    if (!options.importanceOrder) {
+        mapped->adviseSequential();
+    }
+    open(mapped->data());
+}
+
+void StreamingLoader::open(std::span<const uint8_t> arrayBuffer) {
+    if (options.batchSize <= 0) {
+        throw std::invalid_argument("Streaming batch size must be positive");
+    }
+
+    header = PackedGaussians::decodeHeader(arrayBuffer, options.maxShDegree);
+    const int vertexCount = header.vertexCount;
+    if (header.format != PlyFormat::Ascii && header.vertexData.size() < static_cast<size_t>(vertexCount) * header.layout.stride) {
+        throw std::runtime_error("Vertex data is shorter than the header declares");
+    }
+
+    // Columns are reserved here and grown batch by batch, so the first batch
+    // does not wait for the whole scene to be zeroed. SH coefficients stay
+    // interleaved until the last batch because planar offsets depend on the
+    // final splat count.
+    gaussians.numGaussians = 0;
+    gaussians.sphericalHarmonicsDegree = header.layout.sphericalHarmonicsDegree;
+    gaussians.shLayout = ShLayout::Interleaved;
+    gaussians.positions.reserve(vertexCount);
+    gaussians.logScales.reserve(vertexCount);
+    gaussians.rotQuats.reserve(vertexCount);
+    gaussians.opacityLogits.reserve(vertexCount);
+    gaussians.shCoeffs.reserve(static_cast<size_t>(vertexCount) * gaussians.nShCoeffs() * 3);
+
+    if (options.importanceOrder && header.format != PlyFormat::Ascii) {
+        computeImportanceOrder();
+    }
+}
+
+// One strided pass over the opacity, scale and (with a viewpoint) position
+// properties only, followed by a radix sort on the inverted score bits.
+void StreamingLoader::computeImportanceOrder() {
+    const auto& layout = header.layout;
+    const VertexSlot* opacitySlot = nullptr;
+    const VertexSlot* scaleSlots[3] = {};
+    const VertexSlot* positionSlots[3] = {};
+    for (const auto& slot : layout.slots) {
+        switch (slot.field) {
+        case VertexField::OpacityLogit: opacitySlot = &slot; break;
+        case VertexField::LogScale: scaleSlots[slot.component] = &slot; break;
+        case VertexField::Position: positionSlots[slot.component] = &slot; break;
+        default: break;
+        }
+    }
+
+    const size_t n = header.vertexCount;
+    std::vector<uint32_t> keys(n);
+    order.resize(n);
+    parallelFor(n, options.nThreads, [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint8_t* vertex = header.vertexData.data() + i * layout.stride;
+            auto read = [&](const VertexSlot* slot) {
+                return slot ? readVertexScalar(vertex, *slot, layout.byteSwapped) : 0.0f;
+            };
+
+            const float s0 = read(scaleSlots[0]);
+            const float s1 = read(scaleSlots[1]);
+            const float s2 = read(scaleSlots[2]);
+            // Area of the two largest axes, a proxy for the projected size.
+            float score = std::exp(s0 + s1 + s2 - std::min({s0, s1, s2})) / (1.0f + std::exp(-read(opacitySlot)));
+            if (options.viewpoint) {
+                float distanceSquared = 0.0f;
+                for (int k = 0; k < 3; ++k) {
+                    const float d = read(positionSlots[k]) - (*options.viewpoint)[k];
+                    distanceSquared += d * d;
+                }
+                score /= std::max(distanceSquared, 1e-6f);
+            }
+            if (!(score >= 0.0f)) {
+                score = 0.0f;
+            }
+            // Scores are non-negative, so their bits order like the floats. The
+            // top 16 bits keep 7 mantissa bits, plenty to rank by.
+            keys[i] = ~std::bit_cast<uint32_t>(score) >> 16;
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+
+    std::vector<uint32_t> scratchKeys;
+    std::vector<uint32_t> scratchValues;
+    radixSortPairs<uint32_t>(keys, order, scratchKeys, scratchValues, 16, options.nThreads);
+
+    // Bucket the file indices by the batch their rank falls in, in file order,
+    // so every batch reads the file forward.
+    std::vector<uint32_t>& batchOf = scratchKeys;
+    batchOf.resize(n);
+    for (size_t rank = 0; rank < n; ++rank) {
+        batchOf[order[rank]] = static_cast<uint32_t>(rank / options.batchSize);
+    }
+    std::vector<size_t> batchStarts((n + options.batchSize - 1) / options.batchSize);
+    for (size_t batch = 0; batch < batchStarts.size(); ++batch) {
+        batchStarts[batch] = batch * options.batchSize;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        order[batchStarts[batchOf[i]]++] = static_cast<uint32_t>(i);
+    }
+}
+
+bool StreamingLoader::next(SplatBatch& batch) {
+    const int total = header.vertexCount;
+    if (position >= total) {
+        return false;
+    }
+
+    const auto& layout = header.layout;
+    if (header.format == PlyFormat::Ascii) {
+        resizeScene(total);
+        gaussians.decodeAsciiVertices(layout, std::string_view(reinterpret_cast<const char*>(header.vertexData.data()), header.vertexData.size()), options.nThreads);
+        gaussians.setShLayout(options.shLayout);
+        batch = {0, total, total};
+        position = total;
+        return true;
+    }
+
+    const int begin = position;
+    const int end = static_cast<int>(std::min<int64_t>(total, static_cast<int64_t>(begin) + options.batchSize));
+    resizeScene(end);
+    if (!order.empty()) {
+        parallelFor(end - begin, options.nThreads, [&](int, size_t sliceBegin, size_t sliceEnd) {
+            gaussians.decodeVertexList(layout, header.vertexData, std::span(order).subspan(begin + sliceBegin, sliceEnd - sliceBegin), begin + static_cast<int>(sliceBegin));
+        });
+    }
+    else {
+        gaussians.decodeVerticesParallel(layout, header.vertexData, begin, end, options.nThreads);
+        if (mapped) {
+            mapped->release(header.vertexData.subspan(begin * layout.stride, (end - begin) * layout.stride));
+        }
+    }
+
+    if (end == total) {
+        gaussians.setShLayout(options.shLayout);
+    }
+    batch = {begin, end, total};
+    position = end;
+    return true;
+}
+
+// Stays within the capacity reserved by open(), so nothing is reallocated.
+void StreamingLoader::resizeScene(int count) {
+    gaussians.numGaussians = count;
+    gaussians.positions.resize(count);
+    gaussians.logScales.resize(count);
+    gaussians.rotQuats.resize(count);
+    gaussians.opacityLogits.resize(count);
+    gaussians.shCoeffs.resize(static_cast<size_t>(count) * gaussians.nShCoeffs() * 3);
+}
+
+const PackedGaussians& StreamingLoader::scene() const {
+    return gaussians;
+}
+
+PackedGaussians& StreamingLoader::scene() {
+    return gaussians;
+}
+
+int StreamingLoader::decoded() const {
+    return position;
+}
+
+int StreamingLoader::total() const {
+    return header.vertexCount;
+}
+
+const std::vector<uint32_t>& StreamingLoader::sourceIndices() const {
+    return order;
+}
+
+PackedGaussians streamPackedGaussians(const std::string& filePath, const StreamingOptions& options, const std::function<void(const SplatBatch&, const PackedGaussians&)>& onBatch) {
+    StreamingLoader loader(filePath, options);
+    SplatBatch batch;
+    while (loader.next(batch)) {
+        if (onBatch) {
+            onBatch(batch, loader.scene());
+        }
+    }
+    PackedGaussians gaussians = std::move(loader.scene());
+    const std::vector<uint32_t>& order = loader.sourceIndices();
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (order[i] != i) {
+            gaussians.sourceIndices = order;
+            break;
+        }
+    }
+    return gaussians;
+}
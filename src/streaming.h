@@ -0,0 +1,78 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "ply.h"
+#include "mapped_file.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <string>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+struct StreamingOptions {
+    // Worker threads used to decode each batch; 0 picks the hardware concurrency.
+    int nThreads = 1;
+    // Splats decoded per batch.
+    int batchSize = 1 << 18;
+    int maxShDegree = 3;
+    ShLayout shLayout = ShLayout::Interleaved;
+    // Emit the most important splats first instead of in file order. Importance
+    // is sigmoid(opacity) times the area of the two largest axes, divided by
+    // the squared distance to `viewpoint` when one is given.
+    bool importanceOrder = false;
+    std::optional<std::array<float, 3>> viewpoint;
+};
+
+// Splats [begin, end) of the scene were decoded by this batch, and with the
+// earlier batches, splats [0, end) are ready to draw.
+struct SplatBatch {
+    int begin;
+    int end;
+    int total;
+};
+
+// Decodes a binary PLY in batches. After each next(), scene() holds the
+// splats decoded so far, so a viewer can start drawing it while later batches
+// are decoded. Its columns are reserved for the whole file and never move,
+// but SH coefficients are only switched to a planar shLayout once the last
+// batch is in. ASCII files are decoded as a single batch.
+class StreamingLoader {
+public:
+    // `arrayBuffer` must outlive the loader.
+    explicit StreamingLoader(std::span<const uint8_t> arrayBuffer, const StreamingOptions& options = {});
+    // Maps the file, falling back to reading it whole when it cannot be mapped.
+    explicit StreamingLoader(const std::string& filePath, const StreamingOptions& options = {});
+
+    // Decodes the next batch. Returns false once every splat has been decoded.
+    bool next(SplatBatch& batch);
+
+    const PackedGaussians& scene() const;
+    PackedGaussians& scene();
+    int decoded() const;
+    int total() const;
+
+    // File index of every splat of the scene when importance ordering is on,
+    // empty otherwise. Within a batch splats are in file order.
+    const std::vector<uint32_t>& sourceIndices() const;
+
+private:
+    StreamingOptions options;
+    std::optional<MappedFile> mapped;
+    std::vector<uint8_t> buffer;
+    PlyHeader header;
+    PackedGaussians gaussians;
+    std::vector<uint32_t> order;
+    int position = 0;
+
+    void open(std::span<const uint8_t> arrayBuffer);
+    void computeImportanceOrder();
+    void resizeScene(int count);
+};
+
+// Loads a whole scene through StreamingLoader, calling onBatch after each
+// batch. An importance-ordered scene keeps the file order in sourceIndices.
+PackedGaussians streamPackedGaussians(const std::string& filePath, const StreamingOptions& options, const std::function<void(const SplatBatch&, const PackedGaussians&)>& onBatch);
+
+#endif // STREAMING_H
@@ -0,0 +1,194 @@
+#include "synthetic_ply.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+
+static const int syntheticClusters = 256;
+
+namespace {
+
+// xorshift64* with Box-Muller normals, fast enough for scenes of tens of
+// millions of splats.
+class SplatRandom {
+public:
+    explicit SplatRandom(uint32_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1) {}
+
+    // In [0, 1).
+    float uniform() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<float>((state * 0x2545f4914f6cdd1dull) >> 40) * (1.0f / 16777216.0f);
+    }
+
+    float normal() {
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        const float radius = std::sqrt(-2.0f * std::log(1.0f - uniform()));
+        const float angle = 2.0f * std::numbers::pi_v<float> * uniform();
+        spare = radius * std::sin(angle);
+        hasSpare = true;
+        return radius * std::cos(angle);
+    }
+
+private:
+    uint64_t state;
+    float spare = 0.0f;
+    bool hasSpare = false;
+};
+
+struct SyntheticLayout {
+    std::string header;
+    size_t stride;
+    // Bytes of extra properties after x, y and z.
+    size_t extraBytes;
+    int nRest;
+};
+
+}
+
+static const char* plyTypeName(PlyScalarType type) {
+    switch (type) {
+    case PlyScalarType::Char: return "char";
+    case PlyScalarType::UChar: return "uchar";
+    case PlyScalarType::Short: return "short";
+    case PlyScalarType::UShort: return "ushort";
+    case PlyScalarType::Int: return "int";
+    case PlyScalarType::UInt: return "uint";
+    case PlyScalarType::Float: return "float";
+    default: return "double";
+    }
+}
+
+static SyntheticLayout syntheticLayout(const SyntheticPlyOptions& options) {
+    if (options.splatCount < 0 || options.shDegree < 0 || options.shDegree > 3 || options.format == PlyFormat::Ascii) {
+        throw std::invalid_argument("Invalid synthetic PLY options");
+    }
+    SyntheticLayout layout;
+    layout.nRest = ((options.shDegree + 1) * (options.shDegree + 1) - 1) * 3;
+    layout.extraBytes = 0;
+
+    std::string& header = layout.header;
+    header = "ply\nformat ";
+    header += options.format == PlyFormat::BinaryBigEndian ? "binary_big_endian" : "binary_little_endian";
+    header += " 1.0\nelement vertex " + std::to_string(options.splatCount) + "\n";
+    header += "property float x\nproperty float y\nproperty float z\n";
+    for (const auto& [name, type] : options.extraProperties) {
+        header += std::string("property ") + plyTypeName(type) + " " + name + "\n";
+        layout.extraBytes += plyScalarSize(type);
+    }
+    for (int i = 0; i < 3; ++i) {
+        header += "property float f_dc_" + std::to_string(i) + "\n";
+    }
+    for (int i = 0; i < layout.nRest; ++i) {
+        header += "property float f_rest_" + std::to_string(i) + "\n";
+    }
+    header += "property float opacity\n";
+    for (int i = 0; i < 3; ++i) {
+        header += "property float scale_" + std::to_string(i) + "\n";
+    }
+    for (int i = 0; i < 4; ++i) {
+        header += "property float rot_" + std::to_string(i) + "\n";
+    }
+    header += "end_header\n";
+    layout.stride = (3 + 3 + layout.nRest + 1 + 3 + 4) * sizeof(float) + layout.extraBytes;
+    return layout;
+}
+
+namespace {
+
+class SplatGenerator {
+public:
+    SplatGenerator(const SyntheticPlyOptions& options, const SyntheticLayout& layout)
+        : options(options), layout(layout), random(options.seed) {
+        for (auto& center : clusters) {
+            for (float& value : center) {
+                value = (random.uniform() * 2.0f - 1.0f) * options.extent;
+            }
+        }
+    }
+
+    // Writes the next `count` records to `out`.
+    void generate(size_t count, uint8_t* out) {
+        const bool swap = options.format == PlyFormat::BinaryBigEndian;
+        const float spread = options.extent / 16.0f;
+        float values[3 + 3 + 45 + 1 + 3 + 4];
+        for (size_t i = 0; i < count; ++i) {
+            const auto& center = clusters[std::min(static_cast<int>(random.uniform() * syntheticClusters), syntheticClusters - 1)];
+            int k = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                values[k++] = center[axis] + random.normal() * spread;
+            }
+            for (int c = 0; c < 3; ++c) {
+                values[k++] = random.normal() * 0.5f;
+            }
+            for (int r = 0; r < layout.nRest; ++r) {
+                values[k++] = random.normal() * 0.05f;
+            }
+            values[k++] = random.normal() * 2.0f;
+            for (int axis = 0; axis < 3; ++axis) {
+                values[k++] = random.normal() * 0.7f - 4.0f;
+            }
+            for (int c = 0; c < 4; ++c) {
+                values[k++] = random.normal();
+            }
+
+            uint8_t* record = out + i * layout.stride;
+            if (swap) {
+                for (int v = 0; v < k; ++v) {
+                    uint32_t bits;
+                    std::memcpy(&bits, &values[v], sizeof(bits));
+                    bits = __builtin_bswap32(bits);
+                    std::memcpy(&values[v], &bits, sizeof(bits));
+                }
+            }
+            std::memcpy(record, values, 3 * sizeof(float));
+            std::memset(record + 3 * sizeof(float), 0, layout.extraBytes);
+            std::memcpy(record + 3 * sizeof(float) + layout.extraBytes, values + 3, (k - 3) * sizeof(float));
+        }
+    }
+
+private:
+    const SyntheticPlyOptions& options;
+    const SyntheticLayout& layout;
+    SplatRandom random;
+    std::array<float, 3> clusters[syntheticClusters];
+};
+
+}
+
+std::vector<uint8_t> makeSyntheticPly(const SyntheticPlyOptions& options) {
+    const SyntheticLayout layout = syntheticLayout(options);
+    std::vector<uint8_t> bytes(layout.header.size() + static_cast<size_t>(options.splatCount) * layout.stride);
+    std::memcpy(bytes.data(), layout.header.data(), layout.header.size());
+    SplatGenerator generator(options, layout);
+    generator.generate(options.splatCount, bytes.data() + layout.header.size());
+    return bytes;
+}
+
+void writeSyntheticPly(const std::string& filePath, const SyntheticPlyOptions& options) {
+    const SyntheticLayout layout = syntheticLayout(options);
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing");
+    }
+    file.write(layout.header.data(), static_cast<std::streamsize>(layout.header.size()));
+
+    const size_t chunkSplats = 1 << 16;
+    std::vector<uint8_t> chunk(chunkSplats * layout.stride);
+    SplatGenerator generator(options, layout);
+    for (size_t first = 0; first < static_cast<size_t>(options.splatCount); first += chunkSplats) {
+        const size_t count = std::min(chunkSplats, options.splatCount - first);
+        generator.generate(count, chunk.data());
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(count * layout.stride));
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef SYNTHETIC_PLY_H
+#define SYNTHETIC_PLY_H
+
+#include "ply.h"
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+struct SyntheticPlyOptions {
+    int splatCount = 100000;
+    int shDegree = 3;
+    // BinaryLittleEndian or BinaryBigEndian.
+    PlyFormat format = PlyFormat::BinaryLittleEndian;
+    // Properties the loader skips, written after x, y and z like the normals
+    // the reference trainer exports. They are all zero.
+    std::vector<std::pair<std::string, PlyScalarType>> extraProperties = {
+        { "nx", PlyScalarType::Float }, { "ny", PlyScalarType::Float }, { "nz", PlyScalarType::Float }
+    };
+    // Splat centers are drawn around clusters spread over a cube of this half-size.
+    float extent = 50.0f;
+    uint32_t seed = 1;
+};
+
+// Binary PLY of random splats with the property order of the reference 3DGS
+// trainer: x, y, z, the extra properties, f_dc_*, f_rest_* (channel-major),
+// opacity, scale_* and rot_*, all float. Values follow the distributions of
+// trained scenes closely enough for loading, sorting and rendering to behave
+// as they would on real data. The same options always give the same bytes.
+std::vector<uint8_t> makeSyntheticPly(const SyntheticPlyOptions& options);
+
+// Writes the same file in chunks, for scenes too large to build in memory.
+void writeSyntheticPly(const std::string& filePath, const SyntheticPlyOptions& options);
+
+#endif // SYNTHETIC_PLY_H
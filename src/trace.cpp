@@ -0,0 +1,370 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_map>
+
+static std::atomic<bool> tracing{ false };
+static std::atomic<uint64_t> tracingGeneration{ 0 };
+static std::atomic<int64_t> tracingEpoch{ 0 };
+static std::atomic<uint32_t> nextThreadId{ 0 };
+
+static uint64_t nanosecondsSinceStart() {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint64_t>(std::max<int64_t>(0, now - tracingEpoch.load(std::memory_order_relaxed)));
+}
+
+// Events are kept in malloc'd chunks so that tracing never shows up in the
+// allocation counts it reports.
+struct TraceChunk {
+    static constexpr size_t capacity = 1024;
+    TraceChunk* next;
+    uint64_t generation;
+    size_t count;
+    TraceEvent events[capacity];
+};
+
+static std::atomic<TraceChunk*> flushedChunks{ nullptr };
+
+static void pushChunk(TraceChunk* chunk) {
+    chunk->next = flushedChunks.load(std::memory_order_relaxed);
+    while (!flushedChunks.compare_exchange_weak(chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+static TraceChunk* takeChunks() {
+    return flushedChunks.exchange(nullptr, std::memory_order_acquire);
+}
+
+struct ThreadTraceBuffer {
+    uint32_t id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    TraceChunk* chunk = nullptr;
+
+    ~ThreadTraceBuffer() {
+        flush();
+    }
+
+    void append(const TraceEvent& event, uint64_t generation) {
+        if (chunk && chunk->generation != generation) {
+            flush();
+        }
+        if (!chunk) {
+            chunk = static_cast<TraceChunk*>(std::malloc(sizeof(TraceChunk)));
+            if (!chunk) {
+                return;
+            }
+            chunk->generation = generation;
+            chunk->count = 0;
+        }
+        chunk->events[chunk->count++] = event;
+        if (chunk->count == TraceChunk::capacity) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (chunk && chunk->count > 0) {
+            pushChunk(chunk);
+        }
+        else {
+            std::free(chunk);
+        }
+        chunk = nullptr;
+    }
+};
+
+static ThreadTraceBuffer& threadBuffer() {
+    static thread_local ThreadTraceBuffer buffer;
+    return buffer;
+}
+
+static std::mutex logMutex;
+static std::function<void(LogLevel, const std::string&)> logHandler;
+static std::vector<LogRecord> logRecords;
+
+#if ENABLE_TRACING
+
+static thread_local uint64_t allocationCount = 0;
+// Allocation counts of threads that have exited, added by each thread's tally
+// as it exits. The tally is registered on a thread's first allocation, so
+// threads that never allocate cost nothing.
+static std::atomic<uint64_t> exitedThreadAllocations{ 0 };
+
+namespace {
+
+struct ExitedThreadTally {
+    ~ExitedThreadTally() {
+        exitedThreadAllocations.fetch_add(allocationCount, std::memory_order_relaxed);
+    }
+};
+
+}
+
+void countAllocation() {
+    if (allocationCount++ == 0) {
+        static thread_local ExitedThreadTally tally;
+        (void)tally;
+    }
+}
+
+static void recordEvent(const TraceEvent& event, uint64_t generation) {
+    if (tracing.load(std::memory_order_relaxed) && tracingGeneration.load(std::memory_order_relaxed) == generation) {
+        threadBuffer().append(event, generation);
+    }
+}
+
+void startTracing() {
+    std::lock_guard<std::mutex> lock(logMutex);
+    for (TraceChunk* chunk = takeChunks(); chunk;) {
+        TraceChunk* next = chunk->next;
+        std::free(chunk);
+        chunk = next;
+    }
+    logRecords.clear();
+    tracingEpoch.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    tracingGeneration.fetch_add(1, std::memory_order_relaxed);
+    tracing.store(true, std::memory_order_release);
+}
+
+TraceCapture stopTracing() {
+    tracing.store(false, std::memory_order_release);
+    threadBuffer().flush();
+
+    TraceCapture capture;
+    const uint64_t generation = tracingGeneration.load(std::memory_order_relaxed);
+    for (TraceChunk* chunk = takeChunks(); chunk;) {
+        if (chunk->generation == generation) {
+            capture.events.insert(capture.events.end(), chunk->events, chunk->events + chunk->count);
+        }
+        TraceChunk* next = chunk->next;
+        std::free(chunk);
+        chunk = next;
+    }
+    std::stable_sort(capture.events.begin(), capture.events.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.begin < b.begin; });
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    capture.logs.swap(logRecords);
+    return capture;
+}
+
+bool tracingActive() {
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void flushTraceBuffer() {
+    threadBuffer().flush();
+}
+
+uint64_t threadAllocationCount() {
+    return allocationCount;
+}
+
+uint64_t processAllocationCount() {
+    return exitedThreadAllocations.load(std::memory_order_relaxed) + allocationCount;
+}
+
+void traceCounter(const char* name, int64_t value) {
+    if (tracingActive()) {
+        const uint64_t generation = tracingGeneration.load(std::memory_order_relaxed);
+        recordEvent({ name, 'C', threadBuffer().id, nanosecondsSinceStart(), 0, 0, 0, value }, generation);
+    }
+}
+
+ScopedTimer::ScopedTimer(const char* name) : name(name), active(name && tracingActive()), begin(0), allocationsAtBegin(0), bytes(0) {
+    if (active) {
+        allocationsAtBegin = allocationCount;
+        begin = nanosecondsSinceStart();
+    }
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (active) {
+        const uint64_t end = nanosecondsSinceStart();
+        const uint64_t generation = tracingGeneration.load(std::memory_order_relaxed);
+        recordEvent({ name, 'X', threadBuffer().id, begin, end - begin, bytes, allocationCount - allocationsAtBegin, 0 }, generation);
+    }
+}
+
+void ScopedTimer::addBytes(uint64_t count) {
+    bytes += count;
+}
+
+OutermostTimer::OutermostTimer(const char* name, int& depth) : depth(depth), timer(depth++ == 0 ? name : nullptr) {}
+
+OutermostTimer::~OutermostTimer() {
+    --depth;
+}
+
+void OutermostTimer::addBytes(uint64_t bytes) {
+    timer.addBytes(bytes);
+}
+
+#else
+
+void startTracing() {}
+
+TraceCapture stopTracing() {
+    return {};
+}
+
+bool tracingActive() {
+    return false;
+}
+
+void flushTraceBuffer() {}
+
+uint64_t threadAllocationCount() {
+    return 0;
+}
+
+uint64_t processAllocationCount() {
+    return 0;
+}
+
+void countAllocation() {}
+
+void traceCounter(const char*, int64_t) {}
+
+#endif
+
+void setLogHandler(std::function<void(LogLevel, const std::string&)> handler) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    logHandler = std::move(handler);
+}
+
+void logMessage(LogLevel level, const std::string& message) {
+    std::function<void(LogLevel, const std::string&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        handler = logHandler;
+        if (tracingActive()) {
+            logRecords.push_back({ level, threadBuffer().id, nanosecondsSinceStart(), message });
+        }
+    }
+    // Called outside the lock so a handler may log in turn.
+    if (handler) {
+        handler(level, message);
+    }
+}
+
+static const char* logLevelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    }
+    return "info";
+}
+
+static void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+std::string formatChromeTrace(const TraceCapture& capture) {
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char buffer[256];
+    bool first = true;
+    auto separate = [&] {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        out += "\n";
+    };
+
+    for (const auto& event : capture.events) {
+        separate();
+        out += "{\"name\":";
+        appendJsonString(out, event.name);
+        if (event.phase == 'X') {
+            std::snprintf(buffer, sizeof(buffer), ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%llu,\"allocations\":%llu}}",
+                event.thread, event.begin / 1e3, event.duration / 1e3, static_cast<unsigned long long>(event.bytes), static_cast<unsigned long long>(event.allocations));
+        }
+        else {
+            std::snprintf(buffer, sizeof(buffer), ",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                event.thread, event.begin / 1e3, static_cast<long long>(event.value));
+        }
+        out += buffer;
+    }
+    for (const auto& log : capture.logs) {
+        separate();
+        out += "{\"name\":";
+        appendJsonString(out, log.message);
+        std::snprintf(buffer, sizeof(buffer), ",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"level\":\"%s\"}}",
+            log.thread, log.time / 1e3, logLevelName(log.level));
+        out += buffer;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+std::string formatTraceSummary(const TraceCapture& capture) {
+    struct Totals {
+        const char* name;
+        uint64_t count = 0;
+        uint64_t nanoseconds = 0;
+        uint64_t bytes = 0;
+        uint64_t allocations = 0;
+    };
+    std::vector<Totals> totals;
+    std::unordered_map<std::string, size_t> index;
+    std::vector<std::pair<const char*, int64_t>> counters;
+    for (const auto& event : capture.events) {
+        if (event.phase == 'C') {
+            counters.emplace_back(event.name, event.value);
+            continue;
+        }
+        auto [entry, inserted] = index.emplace(event.name, totals.size());
+        if (inserted) {
+            totals.push_back({ event.name });
+        }
+        Totals& total = totals[entry->second];
+        total.count++;
+        total.nanoseconds += event.duration;
+        total.bytes += event.bytes;
+        total.allocations += event.allocations;
+    }
+    std::sort(totals.begin(), totals.end(), [](const Totals& a, const Totals& b) { return a.nanoseconds > b.nanoseconds; });
+
+    std::string out;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-28s %8s %12s %12s %14s %10s %12s\n", "scope", "count", "total ms", "mean ms", "bytes", "MB/s", "allocations");
+    out += line;
+    for (const auto& total : totals) {
+        const double milliseconds = total.nanoseconds / 1e6;
+        const double throughput = total.nanoseconds > 0 ? total.bytes / (total.nanoseconds / 1e9) / 1e6 : 0.0;
+        std::snprintf(line, sizeof(line), "%-28s %8llu %12.3f %12.3f %14llu %10.1f %12llu\n", total.name, static_cast<unsigned long long>(total.count), milliseconds,
+            milliseconds / total.count, static_cast<unsigned long long>(total.bytes), throughput, static_cast<unsigned long long>(total.allocations));
+        out += line;
+    }
+    for (const auto& [name, value] : counters) {
+        std::snprintf(line, sizeof(line), "counter %-20s %lld\n", name, static_cast<long long>(value));
+        out += line;
+    }
+    for (const auto& log : capture.logs) {
+        out += "[" + std::string(logLevelName(log.level)) + "] " + log.message + "\n";
+    }
+    return out;
+}
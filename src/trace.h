@@ -0,0 +1,134 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+// Build with -DENABLE_TRACING=0 to compile timers, counters and the
+// allocation counting out. The functions below stay available and return empty
+// captures, so callers need no #ifs of their own. Logging is not affected.
+#ifndef ENABLE_TRACING
+#define ENABLE_TRACING 1
+#endif
+
+// One timed scope ('X'), counter sample ('C') or log record ('i'). Times are
+// in nanoseconds since startTracing(). Names are string literals.
+struct TraceEvent {
+    const char* name;
+    char phase;
+    uint32_t thread;
+    uint64_t begin;
+    uint64_t duration;
+    // Bytes the scope processed, as reported through ScopedTimer::addBytes.
+    uint64_t bytes;
+    // Heap allocations made by the scope's thread while it was open.
+    uint64_t allocations;
+    int64_t value;
+};
+
+enum class LogLevel { Debug, Info, Warning, Error };
+
+struct LogRecord {
+    LogLevel level;
+    uint32_t thread;
+    uint64_t time;
+    std::string message;
+};
+
+struct TraceCapture {
+    // Sorted by begin time.
+    std::vector<TraceEvent> events;
+    std::vector<LogRecord> logs;
+};
+
+// Events are recorded only between startTracing() and stopTracing(). Every
+// thread writes to its own buffer, which is handed to a lock-free list when
+// it fills up, when the thread exits and, for the calling thread, in
+// stopTracing(). Long-lived threads that are still running when tracing
+// stops should call flushTraceBuffer() first.
+void startTracing();
+TraceCapture stopTracing();
+bool tracingActive();
+void flushTraceBuffer();
+
+// Heap allocations made through operator new by the calling thread since it
+// started. Counted only in executables that link allocation_hooks.cpp, and
+// always 0 when tracing is compiled out.
+uint64_t threadAllocationCount();
+// The calling thread's count plus those of every thread that has exited, so
+// counts taken around work that joins its threads include theirs. Threads
+// still running are not included.
+uint64_t processAllocationCount();
+// Counts one allocation of the calling thread; called by the operator new
+// replacements in allocation_hooks.cpp.
+void countAllocation();
+
+void traceCounter(const char* name, int64_t value);
+
+// Chrome trace event JSON, loadable in chrome://tracing and Perfetto.
+std::string formatChromeTrace(const TraceCapture& capture);
+// One line per scope name: count, total and mean time, bytes, throughput and allocations.
+std::string formatTraceSummary(const TraceCapture& capture);
+
+// Log records go to the handler, if one is set, and into the trace while
+// tracing is active. Without a handler nothing is printed.
+void setLogHandler(std::function<void(LogLevel, const std::string&)> handler);
+void logMessage(LogLevel level, const std::string& message);
+
+#if ENABLE_TRACING
+
+// Records the time from construction to destruction as one event.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    void addBytes(uint64_t bytes);
+
+private:
+    const char* name;
+    bool active;
+    uint64_t begin;
+    uint64_t allocationsAtBegin;
+    uint64_t bytes;
+};
+
+// A ScopedTimer for recursive code: only the outermost of the nested scopes
+// that share `depth` is recorded.
+class OutermostTimer {
+public:
+    OutermostTimer(const char* name, int& depth);
+    ~OutermostTimer();
+
+    OutermostTimer(const OutermostTimer&) = delete;
+    OutermostTimer& operator=(const OutermostTimer&) = delete;
+
+    void addBytes(uint64_t bytes);
+
+private:
+    int& depth;
+    ScopedTimer timer;
+};
+
+#else
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char*) {}
+    void addBytes(uint64_t) {}
+};
+
+class OutermostTimer {
+public:
+    OutermostTimer(const char*, int&) {}
+    void addBytes(uint64_t) {}
+};
+
+#endif
+
+#endif // TRACE_H
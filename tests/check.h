@@ -0,0 +1,42 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// Minimal assertions for the test executables: CHECK reports a failed
+// condition and carries on, and main returns checkResult().
+inline int checkFailures = 0;
+
+inline void checkCondition(bool passed, const char* expression, const char* file, int line) {
+    if (!passed) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+        ++checkFailures;
+    }
+}
+
+#define CHECK(condition) checkCondition(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+// True when `run` throws an Exception.
+template <typename Exception, typename Function>
+bool throws(Function&& run) {
+    try {
+        run();
+    }
+    catch (const Exception&) {
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+    return false;
+}
+
+inline int checkResult() {
+    if (checkFailures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", checkFailures);
+        return 1;
+    }
+    return 0;
+}
+
+#endif // CHECK_H
@@ -0,0 +1,104 @@
+// Quantizes a synthetic scene with fp16 and 8-bit SH and checks every
+// attribute against its error bound, then round-trips both through a file
+// and checks that an unknown SH encoding is rejected.
+#include "compact.h"
+#include "synthetic_ply.h"
+#include "check.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+
+// Angle between the rotations of two unit quaternions.
+static double rotationAngle(const std::array<float, 4>& a, const std::array<float, 4>& b) {
+    double dot = 0.0;
+    for (int k = 0; k < 4; ++k) {
+        dot += static_cast<double>(a[k]) * b[k];
+    }
+    return 2.0 * std::acos(std::min(1.0, std::abs(dot)));
+}
+
+static bool sameCompact(const CompactGaussians& a, const CompactGaussians& b) {
+    return a.numGaussians == b.numGaussians && a.sphericalHarmonicsDegree == b.sphericalHarmonicsDegree && a.shEncoding == b.shEncoding
+        && a.positionOrigin == b.positionOrigin && a.positions == b.positions && a.logScales == b.logScales && a.rotQuats == b.rotQuats
+        && a.opacities == b.opacities && a.shCoeffs == b.shCoeffs && a.shRanges.size() == b.shRanges.size();
+}
+
+int main() {
+    // fp16 keeps 11 significant bits, so rounding is within 2^-11 of the value.
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> real(-1000.0f, 1000.0f);
+    for (int k = 0; k < 100000; ++k) {
+        const float value = real(random) * std::pow(2.0f, -static_cast<float>(k % 20));
+        CHECK(std::abs(halfToFloat(floatToHalf(value)) - value) <= std::abs(value) / 2048.0f + 1e-7f);
+    }
+    CHECK(halfToFloat(floatToHalf(0.0f)) == 0.0f);
+    CHECK(std::isinf(halfToFloat(floatToHalf(1e6f))));
+
+    // Smallest-three: three 10-bit components over [-1/sqrt(2), 1/sqrt(2)].
+    std::normal_distribution<float> normal;
+    double maxAngle = 0.0;
+    for (int k = 0; k < 100000; ++k) {
+        std::array<float, 4> quat = { normal(random), normal(random), normal(random), normal(random) };
+        const float norm = std::sqrt(quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+        for (float& value : quat) {
+            value /= norm;
+        }
+        maxAngle = std::max(maxAngle, rotationAngle(quat, unpackQuaternion(packQuaternion(quat))));
+    }
+    CHECK(maxAngle < 5e-3);
+
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 20000;
+    LoadOptions loadOptions;
+    loadOptions.nThreads = 2;
+    const PackedGaussians source(makeSyntheticPly(sceneOptions), loadOptions);
+    const std::string path = (std::filesystem::temp_directory_path() / ("compact_test_" + std::to_string(getpid()) + ".bin")).string();
+
+    for (ShEncoding encoding : { ShEncoding::Float16, ShEncoding::Uint8 }) {
+        const CompactGaussians compact(source, encoding);
+        CHECK(compact.byteSize() < source.numGaussians * sizeof(float) * (3 + 3 + 4 + 1 + 48) / 2);
+        const PackedGaussians decoded = compact.decode();
+        CHECK(decoded.numGaussians == source.numGaussians);
+
+        bool positionsWithinBound = true, shWithinBound = true;
+        for (int i = 0; i < source.numGaussians; ++i) {
+            for (int axis = 0; axis < 3; ++axis) {
+                const float offset = source.positions[i][axis] - compact.positionOrigin[axis];
+                positionsWithinBound &= std::abs(decoded.positions[i][axis] - source.positions[i][axis]) <= std::abs(offset) / 2048.0f + 1e-5f;
+            }
+            for (int coeff = 0; coeff < source.nShCoeffs(); ++coeff) {
+                const QuantizationRange& range = compact.shRanges[coeff];
+                for (int rgb = 0; rgb < 3; ++rgb) {
+                    const float value = source.shCoeff(i, coeff, rgb);
+                    const float bound = encoding == ShEncoding::Float16 ? std::abs(value) / 2048.0f + 1e-7f : (range.max - range.min) / 510.0f + 1e-6f;
+                    shWithinBound &= std::abs(decoded.shCoeff(i, coeff, rgb) - value) <= bound;
+                }
+            }
+        }
+        CHECK(positionsWithinBound);
+        CHECK(shWithinBound);
+
+        // 8-bit values are within half a step of their range.
+        const QuantizationReport report = measureQuantizationError(source, decoded);
+        CHECK(report.logScale.max <= (compact.logScaleRange.max - compact.logScaleRange.min) / 510.0 + 1e-5);
+        CHECK(report.opacityLogit.max <= (compact.opacityRange.max - compact.opacityRange.min) / 510.0 + 1e-5);
+        CHECK(report.rotationRadians.max < 5e-3);
+
+        compact.save(path);
+        CHECK(sameCompact(CompactGaussians::load(path), compact));
+    }
+
+    // An SH encoding the format does not define is rejected, not read as 8-bit.
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        const int32_t unknownEncoding = 7;
+        file.seekp(4 + sizeof(uint32_t) + 2 * sizeof(int32_t));
+        file.write(reinterpret_cast<const char*>(&unknownEncoding), sizeof(unknownEncoding));
+    }
+    CHECK(throws<std::runtime_error>([&] { CompactGaussians::load(path); }));
+    std::filesystem::remove(path);
+    return checkResult();
+}
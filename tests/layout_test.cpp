@@ -0,0 +1,104 @@
+// Packs SplatRecord and CameraUniform through the layout templates and
+// through the equivalent runtime Struct, and compares the bytes.
+#include "layout.h"
+#include "packing.h"
+#include "check.h"
+#include <random>
+
+static std::mt19937 generator(11);
+
+static float randomFloat() {
+    return std::uniform_real_distribution<float>(-10.0f, 10.0f)(generator);
+}
+
+template <size_t N>
+static std::array<float, N> randomArray() {
+    std::array<float, N> values;
+    for (float& value : values) {
+        value = randomFloat();
+    }
+    return values;
+}
+
+template <size_t N>
+static NestedData values(const std::array<float, N>& array) {
+    std::vector<NestedData> list;
+    for (float value : array) {
+        list.emplace_back(value);
+    }
+    return list;
+}
+
+static NestedData matrixValues(const std::array<std::array<float, 4>, 4>& matrix) {
+    std::vector<NestedData> columns;
+    for (const auto& column : matrix) {
+        columns.push_back(values(column));
+    }
+    return columns;
+}
+
+static void testSplatRecords() {
+    vec3 position(f32), logScale(f32);
+    vec4 rotQuat(f32);
+    f32Type opacityLogit;
+    Struct record({ { "position", &position }, { "logScale", &logScale }, { "rotQuat", &rotQuat }, { "opacityLogit", &opacityLogit } });
+    CHECK(record.size == layout::SplatRecord::size);
+    CHECK(record.alignment == layout::SplatRecord::alignment);
+
+    const int count = 64;
+    StaticArray records(record, count);
+    CHECK(records.size == count * layout::arrayStride<layout::SplatRecord>());
+
+    std::vector<layout::SplatRecord::value_type> splats(count);
+    std::vector<NestedData> elements;
+    for (auto& splat : splats) {
+        splat = { randomArray<3>(), randomArray<3>(), randomArray<4>(), randomFloat() };
+        elements.emplace_back(std::unordered_map<std::string, NestedData> { { "position", values(std::get<0>(splat)) },
+            { "logScale", values(std::get<1>(splat)) }, { "rotQuat", values(std::get<2>(splat)) }, { "opacityLogit", std::get<3>(splat) } });
+    }
+
+    std::vector<uint8_t> expected(records.size);
+    records.pack(0, NestedData(std::move(elements)), expected);
+    std::vector<uint8_t> packed(records.size);
+    layout::packArray<layout::SplatRecord>(splats, packed);
+    CHECK(packed == expected);
+
+    std::vector<layout::SplatRecord::value_type> unpacked(count);
+    layout::unpackArray<layout::SplatRecord>(packed, unpacked);
+    CHECK(unpacked == splats);
+}
+
+static void testCameraUniform() {
+    mat4x4 view(f32), projection(f32);
+    vec3 position(f32);
+    vec2 viewport(f32), focal(f32);
+    Struct camera({ { "view", &view }, { "projection", &projection }, { "position", &position }, { "viewport", &viewport }, { "focal", &focal } });
+    CHECK(camera.size == layout::CameraUniform::size);
+    CHECK(camera.alignment == layout::CameraUniform::alignment);
+
+    std::array<std::array<float, 4>, 4> viewMatrix, projectionMatrix;
+    for (int i = 0; i < 4; ++i) {
+        viewMatrix[i] = randomArray<4>();
+        projectionMatrix[i] = randomArray<4>();
+    }
+    const layout::CameraUniform::value_type uniform = { viewMatrix, projectionMatrix, randomArray<3>(), randomArray<2>(), randomArray<2>() };
+
+    std::vector<uint8_t> expected(camera.size);
+    camera.pack(0, std::unordered_map<std::string, NestedData> { { "view", matrixValues(viewMatrix) }, { "projection", matrixValues(projectionMatrix) },
+        { "position", values(std::get<2>(uniform)) }, { "viewport", values(std::get<3>(uniform)) }, { "focal", values(std::get<4>(uniform)) } }, expected);
+    std::vector<uint8_t> packed(layout::CameraUniform::size);
+    layout::CameraUniform::pack(uniform, packed.data());
+    CHECK(packed == expected);
+    CHECK(layout::CameraUniform::unpack(packed.data()) == uniform);
+
+    // The offsets agree with the runtime member lookup.
+    CHECK(camera.member(0, "position").first == layout::CameraUniform::offsetOf<"position">());
+    CHECK(camera.member(0, "viewport").first == layout::CameraUniform::offsetOf<"viewport">());
+    CHECK(camera.member(0, "focal").first == layout::CameraUniform::offsetOf<"focal">());
+}
+
+int main() {
+    testSplatRecords();
+    testCameraUniform();
+    return checkResult();
+}
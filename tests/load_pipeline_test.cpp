@@ -0,0 +1,156 @@
+// Loads little-endian, big-endian and ASCII PLYs through a LoadPool and
+// compares the scenes and packed records with PackedGaussians and packArray,
+// then checks concurrent loads, cancellation and error propagation.
+#include "load_pipeline.h"
+#include "scene_buffer.h"
+#include "synthetic_ply.h"
+#include "ply_writer.h"
+#include "check.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+static std::string temporaryPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("load_pipeline_test_" + std::to_string(getpid()) + "_" + name)).string();
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+static std::vector<uint8_t> packAll(const PackingType& recordType, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians) {
+    const PackingPlan plan = compilePackingPlan(recordType);
+    const auto fieldColumns = vertexFieldColumns(gaussians, bindVertexFields(plan, fields, gaussians));
+    std::unordered_map<std::string, PackingColumn> columns;
+    for (size_t i = 0; i < plan.fields.size(); ++i) {
+        columns[plan.fields[i]] = fieldColumns[i];
+    }
+    std::vector<uint8_t> packed(gaussians.numGaussians * plan.stride);
+    packArray(plan, columns, gaussians.numGaussians, packed);
+    return packed;
+}
+
+// Whether wait() rethrows an error other than LoadCancelled.
+static bool failed(PipelinedLoad& load) {
+    try {
+        load.wait();
+    }
+    catch (const LoadCancelled&) {
+        return false;
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    vec3 position(f32);
+    vec4 rotation(f32);
+    f32Type opacity;
+    StaticArray sh(f32, 12);
+    Struct record({ { "position", &position }, { "rotation", &rotation }, { "opacity", &opacity }, { "sh", &sh } });
+    PipelineOptions options;
+    options.chunkVertices = 1000;
+    options.chunkBuffers = 4;
+    options.recordType = &record;
+    options.fields = { { "position", VertexField::Position }, { "rotation", VertexField::RotQuat }, { "opacity", VertexField::OpacityLogit },
+        { "sh", VertexField::ShCoeff } };
+
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 30000;
+    sceneOptions.shDegree = 1;
+    const std::vector<uint8_t> littleEndian = makeSyntheticPly(sceneOptions);
+    const PackedGaussians expected(littleEndian);
+    const std::vector<uint8_t> expectedPacked = packAll(record, options.fields, expected);
+    sceneOptions.format = PlyFormat::BinaryBigEndian;
+    const std::vector<std::pair<std::string, std::vector<uint8_t>>> files = { { "le.ply", littleEndian }, { "be.ply", makeSyntheticPly(sceneOptions) },
+        { "ascii.ply", writePly(PlyFormat::Ascii, gaussianProperties(1), gaussianValues(expected), true) } };
+    for (const auto& [name, bytes] : files) {
+        writeFile(temporaryPath(name), bytes);
+    }
+
+    // Every format, with and without the pack stage.
+    {
+        LoadPool pool(3);
+        for (const auto& [name, bytes] : files) {
+            LoadedScene scene = pool.load(temporaryPath(name), options)->wait();
+            CHECK(sameGaussians(scene.gaussians, expected));
+            CHECK(scene.packed == expectedPacked);
+        }
+        PipelineOptions decodeOnly = options;
+        decodeOnly.recordType = nullptr;
+        decodeOnly.shLayout = ShLayout::Planar;
+        const auto load = pool.load(temporaryPath("be.ply"), decodeOnly);
+        LoadedScene scene = load->wait();
+        CHECK(scene.gaussians.shLayout == ShLayout::Planar);
+        CHECK(sameGaussians(scene.gaussians, expected));
+        CHECK(scene.packed.empty());
+        CHECK(load->decoded() == expected.numGaussians && load->total() == expected.numGaussians);
+    }
+
+    // Many loads at once on fewer workers than loads.
+    {
+        LoadPool pool(2);
+        std::vector<std::shared_ptr<PipelinedLoad>> loads;
+        for (int k = 0; k < 12; ++k) {
+            loads.push_back(pool.load(temporaryPath(files[k % files.size()].first), options));
+        }
+        for (const auto& load : loads) {
+            LoadedScene scene = load->wait();
+            CHECK(sameGaussians(scene.gaussians, expected));
+            CHECK(scene.packed == expectedPacked);
+        }
+    }
+
+    // Cancelled before any chunk was read and partway through.
+    {
+        LoadPool pool(1);
+        const auto before = pool.load(temporaryPath("le.ply"), options);
+        before->cancel();
+        CHECK(throws<LoadCancelled>([&] { before->wait(); }));
+
+        PipelineOptions smallChunks = options;
+        smallChunks.chunkVertices = 64;
+        const auto during = pool.load(temporaryPath("le.ply"), smallChunks);
+        while (during->decoded() == 0 && !during->finished()) {
+            std::this_thread::yield();
+        }
+        // The worker may still finish the load before cancel() lands; then
+        // the cancel is a no-op and the scene is complete.
+        during->cancel();
+        try {
+            CHECK(during->wait().packed == expectedPacked);
+        }
+        catch (const LoadCancelled&) {
+            CHECK(during->packed() < expected.numGaussians);
+        }
+        CHECK(during->finished());
+
+        // The pool goes on with the next load.
+        CHECK(pool.load(temporaryPath("le.ply"), options)->wait().packed == expectedPacked);
+    }
+
+    // Errors stop the load and are rethrown by wait().
+    {
+        const std::string truncated = temporaryPath("truncated.ply");
+        writeFile(truncated, std::vector<uint8_t>(littleEndian.begin(), littleEndian.begin() + littleEndian.size() / 2));
+        const std::string noHeaderEnd = temporaryPath("no_header_end.ply");
+        writeFile(noHeaderEnd, std::vector<uint8_t>(littleEndian.begin(), littleEndian.begin() + 200));
+        LoadPool pool(2);
+        const auto missing = pool.load(temporaryPath("missing.ply"), options);
+        const auto shorter = pool.load(truncated, options);
+        const auto unterminated = pool.load(noHeaderEnd, options);
+        CHECK(failed(*missing));
+        CHECK(failed(*shorter));
+        CHECK(failed(*unterminated));
+        std::filesystem::remove(truncated);
+        std::filesystem::remove(noHeaderEnd);
+    }
+
+    for (const auto& [name, bytes] : files) {
+        std::filesystem::remove(temporaryPath(name));
+    }
+    return checkResult();
+}
@@ -0,0 +1,95 @@
+// Reads a packed array of structs through PackedView and PackedColumn and
+// compares every value with StaticArray::unpack, then checks that reading a
+// column of a 1M-element array allocates nothing.
+#include "packing.h"
+#include "trace.h"
+#include "check.h"
+#include <random>
+#include <memory>
+
+int main() {
+    vec3 position(f32);
+    vec4 color(f32);
+    u32Type id;
+    mat4x4 transform(f32);
+    Struct splat({ { "position", &position }, { "color", &color }, { "id", &id }, { "transform", &transform } });
+    const PackingPlan plan = compilePackingPlan(splat);
+
+    const size_t count = 1000000;
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> real(-100.0f, 100.0f);
+    std::vector<std::array<float, 3>> positions(count);
+    std::vector<std::array<float, 4>> colors(count);
+    std::vector<uint32_t> ids(count);
+    std::vector<std::array<float, 16>> transforms(count);
+    for (size_t i = 0; i < count; ++i) {
+        positions[i] = { real(random), real(random), real(random) };
+        colors[i] = { real(random), real(random), real(random), real(random) };
+        ids[i] = random();
+        for (float& value : transforms[i]) {
+            value = real(random);
+        }
+    }
+
+    StaticArray splats(splat, static_cast<int>(count));
+    CHECK(splats.stride == plan.stride);
+    std::vector<uint8_t> buffer(count * plan.stride);
+    packArray(plan, { { "position", makeColumn(positions) }, { "color", makeColumn(colors) }, { "id", makeColumn(ids) }, { "transform", makeColumn(transforms) } },
+        count, buffer, 4);
+
+    // The first elements against the NestedData tree of unpack().
+    const int nUnpacked = 500;
+    StaticArray head(splat, nUnpacked);
+    const std::vector<uint8_t> headBuffer(buffer.begin(), buffer.begin() + static_cast<size_t>(nUnpacked) * plan.stride);
+    const NestedData unpackedHead = head.unpack(0, headBuffer).second;
+    const auto& unpacked = std::get<std::vector<NestedData>>(unpackedHead);
+    const PackedView view(splats, buffer);
+    CHECK(view.size() == static_cast<int>(count));
+    bool elementsMatch = true;
+    for (int i = 0; i < nUnpacked; ++i) {
+        const auto& record = std::get<std::unordered_map<std::string, NestedData>>(unpacked[i]);
+        const auto& expectedPosition = std::get<std::vector<NestedData>>(record.at("position"));
+        const auto& expectedColor = std::get<std::vector<NestedData>>(record.at("color"));
+        const auto& expectedTransform = std::get<std::vector<NestedData>>(record.at("transform"));
+        for (int k = 0; k < 3; ++k) {
+            elementsMatch &= view[i]["position"][k].as<float>() == std::get<float>(expectedPosition[k]);
+        }
+        for (int k = 0; k < 4; ++k) {
+            elementsMatch &= view[i]["color"][k].as<float>() == std::get<float>(expectedColor[k]);
+            const auto& expectedColumn = std::get<std::vector<NestedData>>(expectedTransform[k]);
+            for (int r = 0; r < 4; ++r) {
+                elementsMatch &= view[i]["transform"][k][r].as<float>() == std::get<float>(expectedColumn[r]);
+            }
+        }
+        elementsMatch &= view[i]["id"].as<uint32_t>() == std::get<uint32_t>(record.at("id"));
+    }
+    CHECK(elementsMatch);
+    CHECK(throws<PackingError>([&] { view[0]["id"].as<float>(); }));
+    CHECK(throws<PackingError>([&] { view[0]["missing"]; }));
+    CHECK(throws<PackingError>([&] { view[static_cast<int>(count)]; }));
+    CHECK(throws<PackingError>([&] { view.column<std::array<float, 4>>("position"); }));
+
+    // Columns over the whole array, read without building any NestedData.
+    const uint64_t allocationsBefore = threadAllocationCount();
+    const PackedColumn<std::array<float, 3>> positionColumn = view.column<std::array<float, 3>>("position");
+    const PackedColumn<uint32_t> idColumn = view.column<uint32_t>("id");
+    bool columnsMatch = positionColumn.size() == static_cast<int>(count) && idColumn.size() == static_cast<int>(count);
+    size_t i = 0;
+    for (const auto& value : positionColumn) {
+        columnsMatch &= value == positions[i++];
+    }
+    i = 0;
+    for (uint32_t value : idColumn) {
+        columnsMatch &= value == ids[i++];
+    }
+    columnsMatch &= view[123456]["color"].column<float>()[3] == colors[123456][3];
+    CHECK(threadAllocationCount() == allocationsBefore);
+    CHECK(columnsMatch);
+
+#if ENABLE_TRACING
+    // The allocation hooks are linked in, so a zero count above is meaningful.
+    auto counted = std::make_unique<int>(0);
+    CHECK(threadAllocationCount() > allocationsBefore);
+#endif
+    return checkResult();
+}
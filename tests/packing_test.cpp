@@ -0,0 +1,120 @@
+// Packs random records with packArray and with Struct::pack and compares the
+// bytes, then checks that mismatched columns are rejected.
+#include "packing.h"
+#include "check.h"
+#include <random>
+
+static NestedData values(const float* first, int count) {
+    std::vector<NestedData> list;
+    for (int i = 0; i < count; ++i) {
+        list.emplace_back(first[i]);
+    }
+    return list;
+}
+
+int main() {
+    vec3 position(f32);
+    u32Type id;
+    mat4x4 transform(f32);
+    i32Type flags;
+    vec4 color(f32);
+    Struct camera({ { "flags", &flags }, { "color", &color } });
+    f32Type opacity;
+    Struct record({ { "position", &position }, { "id", &id }, { "transform", &transform }, { "camera", &camera }, { "opacity", &opacity } });
+    const PackingPlan plan = compilePackingPlan(record);
+    CHECK(plan.fields.size() == 6);
+
+    const size_t count = 1000;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> real(-100.0f, 100.0f);
+    std::vector<std::array<float, 3>> positions(count);
+    std::vector<uint32_t> ids(count);
+    std::vector<std::array<float, 16>> transforms(count);
+    std::vector<int32_t> cameraFlags(count);
+    std::vector<std::array<float, 4>> colors(count);
+    std::vector<float> opacities(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (float& value : positions[i]) {
+            value = real(random);
+        }
+        ids[i] = random();
+        for (float& value : transforms[i]) {
+            value = real(random);
+        }
+        cameraFlags[i] = static_cast<int32_t>(random());
+        for (float& value : colors[i]) {
+            value = real(random);
+        }
+        opacities[i] = real(random);
+    }
+
+    // Struct::pack needs the records as NestedData; matrices are lists of columns.
+    std::vector<uint8_t> expected(count * plan.stride);
+    for (size_t i = 0; i < count; ++i) {
+        std::vector<NestedData> columns;
+        for (int c = 0; c < 4; ++c) {
+            columns.push_back(values(transforms[i].data() + c * 4, 4));
+        }
+        std::unordered_map<std::string, NestedData> cameraValue = { { "flags", cameraFlags[i] }, { "color", values(colors[i].data(), 4) } };
+        std::unordered_map<std::string, NestedData> recordValue = { { "position", values(positions[i].data(), 3) }, { "id", ids[i] },
+            { "transform", NestedData(std::move(columns)) }, { "camera", NestedData(std::move(cameraValue)) }, { "opacity", opacities[i] } };
+        record.pack(static_cast<int>(i * plan.stride), NestedData(std::move(recordValue)), expected);
+    }
+
+    const std::unordered_map<std::string, PackingColumn> columns = { { "position", makeColumn(positions) }, { "id", makeColumn(ids) },
+        { "transform", makeColumn(transforms) }, { "camera.flags", makeColumn(cameraFlags) }, { "camera.color", makeColumn(colors) },
+        { "opacity", makeColumn(opacities) } };
+    for (int nThreads : { 1, 4 }) {
+        std::vector<uint8_t> packed(count * plan.stride);
+        packArray(plan, columns, count, packed, nThreads);
+        CHECK(packed == expected);
+    }
+
+    // A vec4 field bound to a three-float column would read past the last record.
+    Struct wide({ { "position", &color } });
+    const PackingPlan widePlan = compilePackingPlan(wide);
+    std::vector<uint8_t> wideBuffer(count * widePlan.stride);
+    CHECK(throws<PackingError>([&] { packArray(widePlan, { { "position", makeColumn(positions) } }, count, wideBuffer); }));
+
+    // mat3 columns are stored back to back, so the plan and views step 12 bytes per column.
+    MatrixType rotation(f32, 3, 3);
+    Struct rotated({ { "rotation", &rotation }, { "opacity", &opacity } });
+    const PackingPlan rotatedPlan = compilePackingPlan(rotated);
+    std::vector<std::array<float, 9>> rotations(count);
+    for (auto& matrix : rotations) {
+        for (float& value : matrix) {
+            value = real(random);
+        }
+    }
+    std::vector<uint8_t> rotatedExpected(count * rotatedPlan.stride);
+    for (size_t i = 0; i < count; ++i) {
+        std::vector<NestedData> rotationColumns;
+        for (int c = 0; c < 3; ++c) {
+            rotationColumns.push_back(values(rotations[i].data() + c * 3, 3));
+        }
+        std::unordered_map<std::string, NestedData> recordValue = { { "rotation", NestedData(std::move(rotationColumns)) }, { "opacity", opacities[i] } };
+        rotated.pack(static_cast<int>(i * rotatedPlan.stride), NestedData(std::move(recordValue)), rotatedExpected);
+    }
+    std::vector<uint8_t> rotatedPacked(count * rotatedPlan.stride);
+    packArray(rotatedPlan, { { "rotation", makeColumn(rotations) }, { "opacity", makeColumn(opacities) } }, count, rotatedPacked, 4);
+    CHECK(rotatedPacked == rotatedExpected);
+    bool viewsMatch = true;
+    for (size_t i = 0; i < count; ++i) {
+        const PackedView matrix = PackedView(rotated, rotatedPacked, static_cast<int>(i * rotatedPlan.stride))["rotation"];
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                viewsMatch &= matrix[c][r].as<float>() == rotations[i][c * 3 + r];
+            }
+            viewsMatch &= matrix[c].column<float>()[2] == rotations[i][c * 3 + 2];
+        }
+    }
+    CHECK(viewsMatch);
+
+    auto mismatched = columns;
+    mismatched["id"] = makeColumn(opacities);
+    std::vector<uint8_t> packed(count * plan.stride);
+    CHECK(throws<PackingError>([&] { packArray(plan, mismatched, count, packed); }));
+    mismatched.erase("id");
+    CHECK(throws<PackingError>([&] { packArray(plan, mismatched, count, packed); }));
+    return checkResult();
+}
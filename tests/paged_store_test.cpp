@@ -0,0 +1,93 @@
+// Pages a synthetic scene four times larger than the memory budget and checks
+// the budget, the chunk contents against the source scene and the counters.
+#include "paged_store.h"
+#include "synthetic_ply.h"
+#include "check.h"
+#include <filesystem>
+#include <random>
+#include <unistd.h>
+
+// Whether splat `i` of `chunk` equals its source splat.
+static bool matchesSource(const SceneChunk& chunk, size_t i, const PackedGaussians& source) {
+    const uint32_t s = chunk.sourceIndices[i];
+    const PackedGaussians& g = chunk.gaussians;
+    if (s >= static_cast<uint32_t>(source.numGaussians) || g.positions[i] != source.positions[s] || g.logScales[i] != source.logScales[s]
+        || g.rotQuats[i] != source.rotQuats[s] || g.opacityLogits[i] != source.opacityLogits[s]) {
+        return false;
+    }
+    for (int k = 0; k < g.nShCoeffs(); ++k) {
+        for (int c = 0; c < 3; ++c) {
+            if (g.shCoeffs[g.shIndex(static_cast<int>(i), k, c)] != source.shCoeffs[source.shIndex(static_cast<int>(s), k, c)]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 200000;
+    sceneOptions.shDegree = 1;
+    LoadOptions loadOptions;
+    loadOptions.nThreads = 2;
+    const PackedGaussians source(makeSyntheticPly(sceneOptions), loadOptions);
+    const std::string path = (std::filesystem::temp_directory_path() / ("paged_store_test_" + std::to_string(getpid()) + ".bin")).string();
+    writePagedScene(path, source, { .chunkSplats = 4096 });
+
+    size_t sceneBytes = 0;
+    {
+        PagedScene whole(path, { .prefetch = false });
+        CHECK(whole.splatCount() == static_cast<size_t>(source.numGaussians));
+        for (uint32_t chunk = 0; chunk < whole.chunks().size(); ++chunk) {
+            sceneBytes += whole.acquire(chunk)->byteSize();
+        }
+    }
+
+    PagedSceneOptions options;
+    options.memoryBudget = sceneBytes / 4;
+    options.prefetchRadius = 20.0f;
+    PagedScene scene(path, options);
+    const size_t nChunks = scene.chunks().size();
+    CHECK(nChunks > 8);
+
+    std::mt19937 random(3);
+    size_t sampled = 0, mismatched = 0;
+    auto sample = [&](const SceneChunk& chunk) {
+        for (int k = 0; k < 16; ++k) {
+            const size_t i = random() % chunk.gaussians.numGaussians;
+            mismatched += !matchesSource(chunk, i, source);
+            ++sampled;
+        }
+    };
+
+    // Sweep the camera across the scene and back, twice.
+    for (int pass = 0; pass < 4; ++pass) {
+        for (int step = 0; step <= 40; ++step) {
+            const float x = (pass % 2 ? 50.0f - 2.5f * step : -50.0f + 2.5f * step);
+            const std::array<float, 3> camera = { x, 0.0f, 0.0f };
+            scene.updateCamera(camera, { pass % 2 ? -2.5f : 2.5f, 0.0f, 0.0f });
+            for (const auto& chunk : scene.acquireNear(camera, 15.0f)) {
+                sample(*chunk);
+            }
+        }
+    }
+    // Random access, each chunk twice in a row.
+    for (int k = 0; k < 200; ++k) {
+        const uint32_t chunk = random() % nChunks;
+        sample(*scene.acquire(chunk));
+        CHECK(scene.resident(chunk));
+        sample(*scene.acquire(chunk));
+    }
+
+    const PagedSceneStats stats = scene.stats();
+    CHECK(stats.peakResidentBytes <= options.memoryBudget);
+    CHECK(stats.residentBytes <= options.memoryBudget);
+    CHECK(stats.hits > 0);
+    CHECK(stats.misses > 0);
+    CHECK(stats.evictions > 0);
+    CHECK(sampled > 1000);
+    CHECK(mismatched == 0);
+    std::filesystem::remove(path);
+    return checkResult();
+}
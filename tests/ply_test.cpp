@@ -0,0 +1,101 @@
+// Decodes the same splats from big-endian, ASCII, mixed-type and multi-element
+// PLY files and checks them against the little-endian float decode, then
+// checks that malformed headers are rejected.
+#include "ply.h"
+#include "synthetic_ply.h"
+#include "ply_writer.h"
+#include "check.h"
+#include <cmath>
+
+static PackedGaussians decode(std::span<const uint8_t> bytes, int nThreads) {
+    LoadOptions options;
+    options.nThreads = nThreads;
+    return PackedGaussians(bytes, options);
+}
+
+// Replaces the first `from` in the header of `bytes` with `to`.
+static std::vector<uint8_t> editHeader(const std::vector<uint8_t>& bytes, const std::string& from, const std::string& to) {
+    std::string text(bytes.begin(), bytes.end());
+    text.replace(text.find(from), from.size(), to);
+    return { text.begin(), text.end() };
+}
+
+int main() {
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 20000;
+    sceneOptions.shDegree = 2;
+    const PackedGaussians reference = decode(makeSyntheticPly(sceneOptions), 1);
+    CHECK(reference.numGaussians == sceneOptions.splatCount);
+    CHECK(reference.sphericalHarmonicsDegree == 2);
+
+    sceneOptions.format = PlyFormat::BinaryBigEndian;
+    const std::vector<uint8_t> bigEndian = makeSyntheticPly(sceneOptions);
+    for (int nThreads : { 1, 4 }) {
+        CHECK(sameGaussians(decode(bigEndian, nThreads), reference));
+    }
+
+    // Every format, with and without elements around the vertices.
+    const auto properties = gaussianProperties(2);
+    const auto values = gaussianValues(reference);
+    for (PlyFormat format : { PlyFormat::BinaryLittleEndian, PlyFormat::BinaryBigEndian, PlyFormat::Ascii }) {
+        for (bool otherElements : { false, true }) {
+            const std::vector<uint8_t> bytes = writePly(format, properties, values, otherElements);
+            for (int nThreads : { 1, 4 }) {
+                CHECK(sameGaussians(decode(bytes, nThreads), reference));
+            }
+        }
+    }
+
+    // Positions and DC as double, rotations as short and opacity as uchar,
+    // with values that convert exactly, against the same values as float.
+    auto mixedProperties = properties;
+    auto mixedValues = values;
+    auto floatValues = values;
+    for (size_t p = 0; p < properties.size(); ++p) {
+        const std::string& name = properties[p].name;
+        if (name.size() == 1 || name.find("f_dc_") == 0) {
+            mixedProperties[p].type = PlyScalarType::Double;
+        }
+        else if (name.find("rot_") == 0) {
+            mixedProperties[p].type = PlyScalarType::Short;
+            for (size_t i = 0; i < values.size(); ++i) {
+                mixedValues[i][p] = floatValues[i][p] = std::round(values[i][p] * 1000.0);
+            }
+        }
+        else if (name == "opacity") {
+            mixedProperties[p].type = PlyScalarType::UChar;
+            for (size_t i = 0; i < values.size(); ++i) {
+                mixedValues[i][p] = static_cast<double>(i % 256);
+                floatValues[i][p] = static_cast<float>(i % 256) / 255.0f;
+            }
+        }
+    }
+    const PackedGaussians floatScene = decode(writePly(PlyFormat::BinaryLittleEndian, properties, floatValues), 1);
+    CHECK(floatScene.opacityLogits[255] == 1.0f);
+    for (PlyFormat format : { PlyFormat::BinaryLittleEndian, PlyFormat::BinaryBigEndian, PlyFormat::Ascii }) {
+        CHECK(sameGaussians(decode(writePly(format, mixedProperties, mixedValues, true), 4), floatScene));
+    }
+
+    // Malformed files.
+    const std::vector<PlyWriterProperty> small = gaussianProperties(0);
+    const std::vector<std::vector<double>> fewValues(values.begin(), values.begin() + 10);
+    std::vector<std::vector<double>> smallValues;
+    for (const auto& vertex : fewValues) {
+        std::vector<double> trimmed(vertex.begin(), vertex.begin() + 6);
+        trimmed.insert(trimmed.end(), vertex.end() - 8, vertex.end());
+        smallValues.push_back(trimmed);
+    }
+    for (PlyFormat format : { PlyFormat::BinaryLittleEndian, PlyFormat::Ascii }) {
+        const std::vector<uint8_t> bytes = writePly(format, small, smallValues, true);
+        CHECK(decode(bytes, 1).numGaussians == 10);
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "end_header\n", "end_head\n"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "end_header\n", "comment\n"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "element vertex 10", "element vertex 20"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "element camera 2", "element camera 99"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "property float opacity", "property float opaque"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "property float x", "property quad x"), 1); }));
+        CHECK(throws<std::runtime_error>([&] { decode(editHeader(bytes, "ply\n", "plx\n"), 1); }));
+    }
+    CHECK(throws<std::runtime_error>([&] { decode(editHeader(writePly(PlyFormat::Ascii, small, smallValues), "ascii", "utf8"), 1); }));
+    return checkResult();
+}
@@ -0,0 +1,170 @@
+#ifndef PLY_WRITER_H
+#define PLY_WRITER_H
+
+#include "ply.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Writes small PLY files of any format and property types for the tests, to
+// compare against the synthetic little-endian float files.
+struct PlyWriterProperty {
+    std::string name;
+    PlyScalarType type;
+};
+
+// Properties of a scene of SH degree `shDegree` in the reference trainer's
+// order, all float.
+inline std::vector<PlyWriterProperty> gaussianProperties(int shDegree) {
+    std::vector<PlyWriterProperty> properties = { { "x", PlyScalarType::Float }, { "y", PlyScalarType::Float }, { "z", PlyScalarType::Float } };
+    for (int i = 0; i < 3; ++i) {
+        properties.push_back({ "f_dc_" + std::to_string(i), PlyScalarType::Float });
+    }
+    const int nRest = ((shDegree + 1) * (shDegree + 1) - 1) * 3;
+    for (int i = 0; i < nRest; ++i) {
+        properties.push_back({ "f_rest_" + std::to_string(i), PlyScalarType::Float });
+    }
+    properties.push_back({ "opacity", PlyScalarType::Float });
+    for (int i = 0; i < 3; ++i) {
+        properties.push_back({ "scale_" + std::to_string(i), PlyScalarType::Float });
+    }
+    for (int i = 0; i < 4; ++i) {
+        properties.push_back({ "rot_" + std::to_string(i), PlyScalarType::Float });
+    }
+    return properties;
+}
+
+// The values of every splat in the order of gaussianProperties.
+inline std::vector<std::vector<double>> gaussianValues(const PackedGaussians& gaussians) {
+    const int nCoeffs = gaussians.nShCoeffs();
+    std::vector<std::vector<double>> vertices(gaussians.numGaussians);
+    for (int i = 0; i < gaussians.numGaussians; ++i) {
+        auto& values = vertices[i];
+        values.assign(gaussians.positions[i].begin(), gaussians.positions[i].end());
+        for (int rgb = 0; rgb < 3; ++rgb) {
+            values.push_back(gaussians.shCoeff(i, 0, rgb));
+        }
+        // f_rest_ is channel-major.
+        for (int rgb = 0; rgb < 3; ++rgb) {
+            for (int coeff = 1; coeff < nCoeffs; ++coeff) {
+                values.push_back(gaussians.shCoeff(i, coeff, rgb));
+            }
+        }
+        values.push_back(gaussians.opacityLogits[i]);
+        values.insert(values.end(), gaussians.logScales[i].begin(), gaussians.logScales[i].end());
+        values.insert(values.end(), gaussians.rotQuats[i].begin(), gaussians.rotQuats[i].end());
+    }
+    return vertices;
+}
+
+inline void appendPlyValue(std::vector<uint8_t>& bytes, PlyFormat format, PlyScalarType type, double value) {
+    if (format == PlyFormat::Ascii) {
+        char text[32];
+        if (type == PlyScalarType::Float) {
+            std::snprintf(text, sizeof(text), "%.9g", static_cast<double>(static_cast<float>(value)));
+        }
+        else if (type == PlyScalarType::Double) {
+            std::snprintf(text, sizeof(text), "%.17g", value);
+        }
+        else {
+            std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(std::llround(value)));
+        }
+        bytes.insert(bytes.end(), text, text + std::strlen(text));
+        bytes.push_back(' ');
+        return;
+    }
+
+    uint8_t raw[8];
+    const size_t size = plyScalarSize(type);
+    const long long integer = std::llround(value);
+    switch (type) {
+    case PlyScalarType::Char: { const int8_t v = static_cast<int8_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::UChar: { const uint8_t v = static_cast<uint8_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::Short: { const int16_t v = static_cast<int16_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::UShort: { const uint16_t v = static_cast<uint16_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::Int: { const int32_t v = static_cast<int32_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::UInt: { const uint32_t v = static_cast<uint32_t>(integer); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::Float: { const float v = static_cast<float>(value); std::memcpy(raw, &v, size); break; }
+    case PlyScalarType::Double: std::memcpy(raw, &value, size); break;
+    }
+    if (format == PlyFormat::BinaryBigEndian) {
+        std::reverse(raw, raw + size);
+    }
+    bytes.insert(bytes.end(), raw, raw + size);
+}
+
+inline void endPlyLine(std::vector<uint8_t>& bytes, PlyFormat format) {
+    if (format == PlyFormat::Ascii) {
+        bytes.back() = '\n';
+    }
+}
+
+// A PLY with one vertex per entry of `vertices`. With otherElements a
+// "camera" element with a list property comes before the vertices and a
+// "face" element after them, as some exporters write.
+inline std::vector<uint8_t> writePly(PlyFormat format, const std::vector<PlyWriterProperty>& properties, const std::vector<std::vector<double>>& vertices,
+    bool otherElements = false) {
+    static const char* const typeNames[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+    static const char* const formatNames[] = { "binary_little_endian", "binary_big_endian", "ascii" };
+    std::string header = std::string("ply\nformat ") + formatNames[static_cast<int>(format)] + " 1.0\ncomment written by ply_writer.h\n";
+    if (otherElements) {
+        header += "element camera 2\nproperty float fx\nproperty list uchar int ids\n";
+    }
+    header += "element vertex " + std::to_string(vertices.size()) + "\n";
+    for (const auto& property : properties) {
+        header += std::string("property ") + typeNames[static_cast<int>(property.type)] + " " + property.name + "\n";
+    }
+    if (otherElements) {
+        header += "element face 1\nproperty list uchar int vertex_indices\n";
+    }
+    header += "end_header\n";
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+
+    if (otherElements) {
+        for (int camera = 0; camera < 2; ++camera) {
+            appendPlyValue(bytes, format, PlyScalarType::Float, 500.0 + camera);
+            appendPlyValue(bytes, format, PlyScalarType::UChar, camera == 0 ? 3 : 0);
+            for (int id = 0; id < (camera == 0 ? 3 : 0); ++id) {
+                appendPlyValue(bytes, format, PlyScalarType::Int, id);
+            }
+            endPlyLine(bytes, format);
+        }
+    }
+    for (const auto& values : vertices) {
+        for (size_t p = 0; p < properties.size(); ++p) {
+            appendPlyValue(bytes, format, properties[p].type, values[p]);
+        }
+        endPlyLine(bytes, format);
+    }
+    if (otherElements) {
+        appendPlyValue(bytes, format, PlyScalarType::UChar, 3);
+        for (int index = 0; index < 3; ++index) {
+            appendPlyValue(bytes, format, PlyScalarType::Int, index);
+        }
+        endPlyLine(bytes, format);
+    }
+    return bytes;
+}
+
+// Whether two scenes hold exactly the same splats.
+inline bool sameGaussians(const PackedGaussians& a, const PackedGaussians& b) {
+    if (a.numGaussians != b.numGaussians || a.sphericalHarmonicsDegree != b.sphericalHarmonicsDegree || a.positions != b.positions
+        || a.logScales != b.logScales || a.rotQuats != b.rotQuats || a.opacityLogits != b.opacityLogits) {
+        return false;
+    }
+    for (int i = 0; i < a.numGaussians; ++i) {
+        for (int coeff = 0; coeff < a.nShCoeffs(); ++coeff) {
+            for (int rgb = 0; rgb < 3; ++rgb) {
+                if (a.shCoeff(i, coeff, rgb) != b.shCoeff(i, coeff, rgb)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif // PLY_WRITER_H
@@ -0,0 +1,79 @@
+// Edits the scales, rotations, colors and positions of a rendered scene in
+// place and checks that the next render after invalidate() matches a fresh
+// rasterizer's.
+#include "rasterizer.h"
+#include "synthetic_ply.h"
+#include "check.h"
+
+static Camera testCamera() {
+    Camera camera;
+    camera.width = 320;
+    camera.height = 240;
+    camera.fx = camera.fy = 250.0f;
+    camera.cx = camera.width * 0.5f;
+    camera.cy = camera.height * 0.5f;
+    camera.view = { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -125.0f, 1.0f } } };
+    return camera;
+}
+
+static std::vector<uint8_t> freshRender(const PackedGaussians& gaussians, const Camera& camera) {
+    SplatRasterizer rasterizer({ .nThreads = 2 });
+    return rasterizer.render(gaussians, camera);
+}
+
+int main() {
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 20000;
+    LoadOptions loadOptions;
+    loadOptions.nThreads = 2;
+    PackedGaussians gaussians(makeSyntheticPly(sceneOptions), loadOptions);
+    const Camera camera = testCamera();
+    // With an angle threshold the colors of a still camera are never re-evaluated by themselves.
+    SplatRasterizer rasterizer({ .nThreads = 2, .colorAngleThreshold = 0.05f });
+    const std::vector<uint8_t> before = rasterizer.render(gaussians, camera);
+
+    // Grow every splat, which keeps the columns where they are.
+    const void* logScales = gaussians.logScales.data();
+    for (auto& scale : gaussians.logScales) {
+        for (float& value : scale) {
+            value += 0.5f;
+        }
+    }
+    CHECK(gaussians.logScales.data() == logScales);
+    rasterizer.invalidate();
+    const std::vector<uint8_t> grown = rasterizer.render(gaussians, camera);
+    CHECK(grown != before);
+    CHECK(grown == freshRender(gaussians, camera));
+
+    // Rotate and shrink a range of splats.
+    const size_t begin = 5000, end = 12000;
+    for (size_t i = begin; i < end; ++i) {
+        gaussians.logScales[i][0] -= 1.0f;
+        gaussians.rotQuats[i] = { gaussians.rotQuats[i][1], gaussians.rotQuats[i][0], gaussians.rotQuats[i][3], gaussians.rotQuats[i][2] };
+    }
+    rasterizer.invalidate(begin, end);
+    const std::vector<uint8_t> edited = rasterizer.render(gaussians, camera);
+    CHECK(edited != grown);
+    CHECK(edited == freshRender(gaussians, camera));
+
+    // Recolor a range through the DC terms and move another one.
+    const int nCoefficients = gaussians.nShCoeffs() * 3;
+    for (size_t i = 0; i < 8000; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            gaussians.shCoeffs[i * nCoefficients + c] = c == 0 ? 2.0f : -2.0f;
+        }
+    }
+    rasterizer.invalidate(0, 8000);
+    const std::vector<uint8_t> recolored = rasterizer.render(gaussians, camera);
+    CHECK(recolored != edited);
+    CHECK(recolored == freshRender(gaussians, camera));
+
+    for (size_t i = 15000; i < 20000; ++i) {
+        gaussians.positions[i][0] += 5.0f;
+    }
+    rasterizer.invalidate();
+    const std::vector<uint8_t> moved = rasterizer.render(gaussians, camera);
+    CHECK(moved != recolored);
+    CHECK(moved == freshRender(gaussians, camera));
+    return checkResult();
+}
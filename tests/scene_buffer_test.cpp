@@ -0,0 +1,127 @@
+// Edits parts of a scene, repacks them with PackedSceneBuffer and checks the
+// bytes against a full packArray and the reported ranges against the dirty
+// ones, then checks the full repack on a count change and the SH check.
+#include "scene_buffer.h"
+#include "synthetic_ply.h"
+#include "check.h"
+
+static std::vector<uint8_t> packAll(const PackedSceneBuffer& sceneBuffer, const std::unordered_map<std::string, VertexField>& fields, const PackedGaussians& gaussians) {
+    const PackingPlan& plan = sceneBuffer.plan();
+    const auto planFields = bindVertexFields(plan, fields, gaussians);
+    const auto fieldColumns = vertexFieldColumns(gaussians, planFields);
+    std::unordered_map<std::string, PackingColumn> columns;
+    for (size_t i = 0; i < plan.fields.size(); ++i) {
+        columns[plan.fields[i]] = fieldColumns[i];
+    }
+    std::vector<uint8_t> packed(gaussians.numGaussians * plan.stride);
+    packArray(plan, columns, gaussians.numGaussians, packed);
+    return packed;
+}
+
+static bool sameBytes(std::span<const uint8_t> a, const std::vector<uint8_t>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Whether `ranges` are exactly the splat ranges `splats` of records of `stride` bytes.
+static bool coversExactly(const std::vector<BufferRange>& ranges, const std::vector<std::pair<size_t, size_t>>& splats, size_t stride) {
+    if (ranges.size() != splats.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges[i].offset != splats[i].first * stride || ranges[i].size != (splats[i].second - splats[i].first) * stride) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 5000;
+    LoadOptions loadOptions;
+    loadOptions.nThreads = 2;
+    PackedGaussians gaussians(makeSyntheticPly(sceneOptions), loadOptions);
+
+    vec3 position(f32);
+    f32Type opacity;
+    vec4 rotation(f32);
+    StaticArray sh(f32, 48);
+    Struct record({ { "position", &position }, { "opacity", &opacity }, { "rotation", &rotation }, { "sh", &sh } });
+    const std::unordered_map<std::string, VertexField> fields = { { "position", VertexField::Position }, { "opacity", VertexField::OpacityLogit },
+        { "rotation", VertexField::RotQuat }, { "sh", VertexField::ShCoeff } };
+
+    SceneBufferOptions options;
+    options.nThreads = 2;
+    PackedSceneBuffer sceneBuffer(record, fields, gaussians, options);
+    const size_t stride = sceneBuffer.plan().stride;
+    CHECK(sceneBuffer.lastRepacked() == gaussians.numGaussians);
+    CHECK(sameBytes(sceneBuffer.data(), packAll(sceneBuffer, fields, gaussians)));
+
+    // Sub-ranges of different fields, each repacked on its own.
+    for (size_t i = 100; i < 200; ++i) {
+        gaussians.positions[i][1] += 1.0f;
+    }
+    for (size_t i = 250; i < 300; ++i) {
+        gaussians.rotQuats[i][0] = -gaussians.rotQuats[i][0];
+    }
+    for (size_t i = 1000; i < 1010; ++i) {
+        gaussians.opacityLogits[i] = 3.0f;
+    }
+    sceneBuffer.markDirty(100, 200, vertexFieldBit(VertexField::Position));
+    sceneBuffer.markDirty(250, 300, vertexFieldBit(VertexField::RotQuat));
+    sceneBuffer.markDirty(1000, 1010, vertexFieldBit(VertexField::OpacityLogit));
+    // Fields the record does not hold are not repacked.
+    sceneBuffer.markDirty(3000, 3100, vertexFieldBit(VertexField::LogScale));
+    CHECK(coversExactly(sceneBuffer.flush(), { { 100, 200 }, { 250, 300 }, { 1000, 1010 } }, stride));
+    CHECK(sceneBuffer.lastRepacked() == 160);
+    CHECK(sameBytes(sceneBuffer.data(), packAll(sceneBuffer, fields, gaussians)));
+
+    // Edits that are not marked stay unpacked until they are.
+    gaussians.shCoeffs[gaussians.shIndex(4000, 5, 2)] = 7.0f;
+    gaussians.shCoeffs[gaussians.shIndex(4002, 0, 0)] = 7.0f;
+    CHECK(sceneBuffer.flush().empty());
+    CHECK(!sameBytes(sceneBuffer.data(), packAll(sceneBuffer, fields, gaussians)));
+    const uint32_t edited[] = { 4002, 4000 };
+    sceneBuffer.markDirty(edited, vertexFieldBit(VertexField::ShCoeff));
+    CHECK(coversExactly(sceneBuffer.flush(), { { 4000, 4001 }, { 4002, 4003 } }, stride));
+    CHECK(sameBytes(sceneBuffer.data(), packAll(sceneBuffer, fields, gaussians)));
+
+    // Ranges past the last splat are clipped.
+    sceneBuffer.markDirty(4990, 6000);
+    CHECK(coversExactly(sceneBuffer.flush(), { { 4990, 5000 } }, stride));
+
+    // With a merge gap, close ranges of any field are repacked and reported as one.
+    options.mergeGap = 10;
+    PackedSceneBuffer merging(record, fields, gaussians, options);
+    merging.markDirty(0, 10, vertexFieldBit(VertexField::Position));
+    merging.markDirty(15, 20, vertexFieldBit(VertexField::OpacityLogit));
+    merging.markDirty(40, 50);
+    merging.markDirty(60, 61, vertexFieldBit(VertexField::Position));
+    merging.markDirty(45, 55, vertexFieldBit(VertexField::Position));
+    CHECK(coversExactly(merging.flush(), { { 0, 20 }, { 40, 61 } }, stride));
+    CHECK(merging.lastRepacked() == 41);
+    CHECK(sameBytes(merging.data(), packAll(merging, fields, gaussians)));
+
+    // A changed splat count repacks everything, dirty or not.
+    const size_t n = gaussians.numGaussians;
+    gaussians.positions.push_back(gaussians.positions[0]);
+    gaussians.logScales.push_back(gaussians.logScales[0]);
+    gaussians.rotQuats.push_back(gaussians.rotQuats[0]);
+    gaussians.opacityLogits.push_back(gaussians.opacityLogits[0]);
+    const std::vector<float> firstSh(gaussians.shCoeffs.begin(), gaussians.shCoeffs.begin() + 48);
+    gaussians.shCoeffs.insert(gaussians.shCoeffs.end(), firstSh.begin(), firstSh.end());
+    gaussians.numGaussians++;
+    sceneBuffer.markDirty(10, 20);
+    CHECK(coversExactly(sceneBuffer.flush(), { { 0, n + 1 } }, stride));
+    CHECK(sceneBuffer.lastRepacked() == n + 1);
+    CHECK(sameBytes(sceneBuffer.data(), packAll(sceneBuffer, fields, gaussians)));
+    sceneBuffer.markAllDirty();
+    CHECK(coversExactly(sceneBuffer.flush(), { { 0, n + 1 } }, stride));
+
+    // Dropping SH bands under a bound 48-float SH field is caught, not read past.
+    gaussians.truncateShDegree(0);
+    sceneBuffer.markDirty(90, 100);
+    CHECK(throws<PackingError>([&] { sceneBuffer.flush(); }));
+    CHECK(throws<PackingError>([&] { PackedSceneBuffer rebound(record, fields, gaussians, options); }));
+    return checkResult();
+}
@@ -0,0 +1,85 @@
+// Loads a PLY through the scene cache cold, warm, after touching the source
+// and after changing it, and compares every result with a direct PLY load.
+#include "scene_cache.h"
+#include "synthetic_ply.h"
+#include "ply_writer.h"
+#include "check.h"
+#include <filesystem>
+#include <chrono>
+#include <unistd.h>
+
+static PackedGaussians loadDirect(const std::string& path, const SceneCacheOptions& options) {
+    LoadOptions loadOptions;
+    loadOptions.nThreads = options.nThreads;
+    loadOptions.maxShDegree = options.maxShDegree;
+    loadOptions.shLayout = options.shLayout;
+    return loadPackedGaussians(path, loadOptions);
+}
+
+int main() {
+    const auto directory = std::filesystem::temp_directory_path();
+    const std::string id = std::to_string(getpid());
+    const std::string sourcePath = (directory / ("scene_cache_test_" + id + ".ply")).string();
+    const std::string cachePath = (directory / ("scene_cache_test_" + id + ".cache")).string();
+
+    SyntheticPlyOptions sceneOptions;
+    sceneOptions.splatCount = 50000;
+    writeSyntheticPly(sourcePath, sceneOptions);
+    SceneCacheOptions options;
+    options.nThreads = 2;
+    options.maxShDegree = 2;
+    options.shLayout = ShLayout::Planar;
+    const PackedGaussians expected = loadDirect(sourcePath, options);
+    CHECK(expected.sphericalHarmonicsDegree == 2);
+
+    // Cold: no cache yet, so it is built.
+    CHECK(!openSceneCache(sourcePath, cachePath, options));
+    CHECK(sameGaussians(loadSceneCached(sourcePath, cachePath, options).toPackedGaussians(), expected));
+    CHECK(std::filesystem::exists(cachePath));
+
+    // Warm: the cache is mapped as it is, and only for the options it was built with.
+    auto warm = openSceneCache(sourcePath, cachePath, options);
+    CHECK(warm && sameGaussians(warm->toPackedGaussians(), expected));
+    CHECK(warm && warm->shLayout == ShLayout::Planar && warm->maxShDegree == 2);
+    SceneCacheOptions otherDegree = options;
+    otherDegree.maxShDegree = 3;
+    CHECK(!openSceneCache(sourcePath, cachePath, otherDegree));
+    warm.reset();
+
+    // Touched: same contents, new time. The content hash matches and the new
+    // time is stored, so the next open does not hash again.
+    const auto touched = std::filesystem::last_write_time(sourcePath) + std::chrono::hours(1);
+    std::filesystem::last_write_time(sourcePath, touched);
+    const int64_t touchedTime = static_cast<int64_t>(touched.time_since_epoch().count());
+    CHECK(MappedScene(cachePath).source.modifiedTime != touchedTime);
+    auto refreshed = openSceneCache(sourcePath, cachePath, options);
+    CHECK(refreshed && sameGaussians(refreshed->toPackedGaussians(), expected));
+    CHECK(refreshed && refreshed->source.modifiedTime == touchedTime);
+    refreshed.reset();
+    CHECK(MappedScene(cachePath).source.modifiedTime == touchedTime);
+    CHECK(MappedScene(cachePath).matches(sourcePath));
+
+    // Changed: same size, other splats. With the stored time kept only a
+    // content check notices; with a new time the cache is stale and rebuilt.
+    sceneOptions.seed = 2;
+    writeSyntheticPly(sourcePath, sceneOptions);
+    std::filesystem::last_write_time(sourcePath, touched);
+    const PackedGaussians changed = loadDirect(sourcePath, options);
+    CHECK(!sameGaussians(changed, expected));
+    SceneCacheOptions verify = options;
+    verify.verifyContent = true;
+    CHECK(!openSceneCache(sourcePath, cachePath, verify));
+    std::filesystem::last_write_time(sourcePath, touched + std::chrono::hours(1));
+    CHECK(!openSceneCache(sourcePath, cachePath, options));
+    CHECK(sameGaussians(loadSceneCached(sourcePath, cachePath, options).toPackedGaussians(), changed));
+    CHECK(sameGaussians(loadSceneCached(sourcePath, cachePath, options).toPackedGaussians(), changed));
+
+    // A file that is not a cache is rebuilt over.
+    std::filesystem::resize_file(cachePath, 16);
+    CHECK(!openSceneCache(sourcePath, cachePath, options));
+    CHECK(sameGaussians(loadSceneCached(sourcePath, cachePath, options).toPackedGaussians(), changed));
+
+    std::filesystem::remove(sourcePath);
+    std::filesystem::remove(cachePath);
+    return checkResult();
+}